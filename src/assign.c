@@ -42,6 +42,7 @@
 #include "lvalue.h"
 #include "statement.h"
 #include "assign.h"
+#include "iostate.h"
 #include "fileio.h"
 #include "mos.h"
 
@@ -802,6 +803,10 @@ static void assiplus_stringdol(pointers address) {
       error(ERR_STRINGLEN);
       return;
     }
+    if (result.stringaddr==lhstring->stringaddr) {      /* Got 'a$+=a$' - String might move */
+      memmove(basicvars.stringwork, result.stringaddr, extralen);
+      result.stringaddr = basicvars.stringwork;
+    }
     cp = resize_string(lhstring->stringaddr, lhstring->stringlen, newlen);
     memmove(cp+lhstring->stringlen, result.stringaddr, extralen);
     lhstring->stringlen = newlen;
@@ -3487,6 +3492,23 @@ void assign_floatvar(void) {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** 'appends_to_self' returns TRUE if the expression at 'p' being assigned
+** to the string variable at 'address' is of the form 'a$=a$+...' and
+** nothing after the '+' can run any Basic code (a function or 'EVAL')
+** that could change the variable. The assignment can then be carried
+** out as 'a$+=...', extending the string in place instead of copying it
+*/
+static boolean appends_to_self(byte *p, basicstring *address) {
+  if (*p!=BASTOKEN_STRINGVAR || GET_ADDRESS(p, basicstring *)!=address || *(p+1+LOFFSIZE)!='+') return FALSE;
+  p+=2+LOFFSIZE;
+  while (!ateol[*p]) {
+    if (*p==BASTOKEN_XFNPROCALL || *p==BASTOKEN_FNPROCALL || (*p==TYPE_FUNCTION && *(p+1)==BASTOKEN_EVAL)) return FALSE;
+    p = skip_token(p);
+  }
+  return TRUE;
+}
+
 /*
 ** 'assign_stringvar' handles assignments to string variables
 ** See 'assign_intval' for general comments
@@ -3504,8 +3526,16 @@ void assign_stringvar(void) {
   assignop = *basicvars.current;
   basicvars.current++;
   if (assignop=='=') {
-    expression();
-    assign_stringdol(address);
+    if (appends_to_self(basicvars.current, address.straddr)) {  /* Got 'a$=a$+...' */
+      basicvars.current+=2+LOFFSIZE;
+      expression();
+      check_ateol();
+      assiplus_stringdol(address);
+    }
+    else {
+      expression();
+      assign_stringdol(address);
+    }
   }
   else if (assignop==BASTOKEN_PLUSAB) {
     expression();
@@ -4024,6 +4054,8 @@ void assign_pseudovar(void) {
   token = *basicvars.current;
   if (token>=BASTOKEN_HIMEM && token<=BASTOKEN_TIME) {
     (*pseudovars[token])();           /* Dispatch an assignment to a pseudo variable */
+  } else if (token==BASTOKEN_BGET) {  /* 'BGET#' statement to read whole arrays */
+    exec_bget();
   } else if (token<=BASTOKEN_VPOS) {  /* Function call on left hand side of assignment */
     DEBUGFUNCMSGOUT;
     error(ERR_SYNTAX);
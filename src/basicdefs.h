@@ -210,9 +210,28 @@ typedef struct {
   byte *whenaddr;                       /* Pointer to the code for that 'WHEN' */
 } whenvalue;
 
+/*
+** 'casejump' is a hash table of the values in the 'WHEN' clauses of a 'CASE'
+** statement where they are all integer constants or all string constants
+*/
+
+typedef struct {
+  int64 jumpint;                        /* Integer value */
+  byte *jumpstring;                     /* Pointer to text of string value */
+  int32 jumplen;                        /* Length of string value */
+  int32 jumpwhen;                       /* Index of 'WHEN' with this value or -1 if entry is unused */
+} caseentry;
+
+typedef struct {
+  boolean stringkeys;                   /* TRUE if values are strings, FALSE if integers */
+  int32 jumpmask;                       /* Number of entries in table less one. Size is a power of two */
+  caseentry jumptable[1];               /* First entry in table */
+} casejump;
+
 typedef struct {
   int32 whencount;                      /* Number of 'WHEN' cases in table */
   byte *defaultaddr;                    /* Address of 'OTHERWISE' code */
+  casejump *jumps;                      /* Pointer to hash table of 'WHEN' values or NIL */
   whenvalue whentable[1];               /* First entry in table of WHEN cases */
 } casetable;
 
@@ -276,15 +295,30 @@ typedef struct {
   byte *stacktop;                       /* Value of the Basic stack pointer when restarting */
 } errorblock;
 
-/* 'libfnproc' entries are set up for each procedure or function in a library */
+/* 'defindex' is a hash table of the procedures and functions defined in a program or library */
+
+typedef struct {
+  int32 defhash;                        /* Hash value of PROC/FN's name */
+  int32 namelen;                        /* Length of name, including the PROC or FN token */
+  byte *defmarker;                      /* Pointer to XFNPROCALL token after DEF or NIL if entry is unused */
+} defentry;
+
+typedef struct {
+  int32 defmask;                        /* Number of entries in table less one. Size is a power of two */
+  defentry defs[1];                     /* First entry in table */
+} defindex;
+
+/* 'lineindex' is a table of the lines in a program or library sorted by line number */
 
-typedef struct libfnproc {
-  struct libfnproc *fpflink;            /* Pointer to next PROC/FN entry */
-  byte *fpline;                         /* Pointer to start of line containing DEF PROC/FN */
-  int32 fphash;                         /* Hash value of PROC/FN's name */
-  byte *fpname;                         /* Pointer to PROC/FN's name in source line */
-  byte *fpmarker;                       /* Pointer to XFNPROCALL token in executable line */
-} libfnproc;
+typedef struct {
+  int32 lineno;                         /* Line number */
+  byte *lineaddr;                       /* Pointer to start of line */
+} lineentry;
+
+typedef struct {
+  int32 linecount;                      /* Number of entries in table, including the end marker */
+  lineentry lines[1];                   /* First entry in table of lines */
+} lineindex;
 
 /* 'library' entries describe libraries loaded */
 
@@ -293,7 +327,9 @@ typedef struct library {
   char *libname;                        /* Library name */
   byte *libstart;                       /* Pointer to start of library in memory */
   int32 libsize;                        /* Size of library */
-  libfnproc *libfplist;                 /* Pointer to list of procedures and functions in library */
+  defindex *libdefs;                    /* Pointer to index of procedures and functions in library or NIL */
+  boolean libscanned;                   /* TRUE if library's private variables have been created */
+  lineindex *libindex;                  /* Pointer to line number index of library or NIL */
   variable *varlists[VARLISTS];         /* Pointers to lists of variables, procedures and functions in library */
 } library;
 
@@ -580,15 +616,27 @@ typedef struct {
   int32 printwidth;               /* Width of line (used by PRINT) */
   int32 recdepth;                 /* Record depth of FN and flood-fill recursion */
   int32 xtab;                     /* X value of TAB(X,Y) */
-  byte *lastsearch;               /* Place last proc/fn search reached */
+  byte *lastsearch;               /* Place last proc/fn search reached if there is no index */
   int32 linecount;                /* Used when reading a Basic program or library into memory */
   variable staticvars[STDVARS];   /* Static integer variables @%-Z% */
   variable *varlists[VARLISTS];   /* Pointers to lists of variables, procedures and functions */
-  int64 centiseconds;             /* Centisecond timer, populated by sub-thread */
+  int64 centiseconds;             /* Centisecond timer, as last read by mos_centiseconds() */
   int clocktype;                  /* Type of clock used in centisecond timer */
   int64 monotonictimebase;        /* Baseline for OS_ReadMonotonicTime */
   size_t memdump_lastaddr;        /* Last address used by LISTB/LISTW */
   int32 maxrecdepth;              /* Maximum FN recursion depth */
+  struct {
+    uint64 stringallocs;          /* Number of strings allocated */
+    uint64 stringfrees;           /* Number of strings freed */
+    uint64 stringbytes;           /* Bytes asked for when allocating strings */
+    uint64 collections;           /* Number of times free strings have been merged */
+    uint64 proccalls;             /* Number of PROC calls */
+    uint64 fncalls;               /* Number of FN calls */
+    uint64 evals;                 /* Number of calls to EVAL */
+    uint64 bytesread;             /* Bytes read from files */
+    uint64 byteswritten;          /* Bytes written to files */
+    size_t stackmax;              /* Most bytes seen in use on the Basic stack */
+  } stats;                        /* Statistics for '*STATS' and 'SYS "Brandy_Stats"' */
   char program[FNAMESIZE];        /* Name of program loaded */
   char filename[FNAMESIZE];       /* Name of last file read */
   cmdarg *arglist;                /* Pointer to list of Basic program command line arguments */
@@ -637,6 +685,8 @@ typedef struct {
   boolean neverfullscreen;    /* TRUE if -nofullscreen given on CLI */
 #endif
   int32 startupmode;          /* Screen mode to start in */
+  size_t outbufsize;          /* Size of the stdout buffer for text output, 0 = C library default */
+  size_t mmapsize;            /* Smallest file mapped into memory by OPENIN, 0 = never map files */
 #ifndef BRANDY_NOVERCHECK
   boolean checknewver;        /* TRUE if we try to check for a new version on startup */
 #endif
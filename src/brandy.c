@@ -36,6 +36,9 @@
 #ifndef TARGET_MINGW
 #include <sys/mman.h>
 #endif
+#ifdef TARGET_UNIX
+#include <signal.h>
+#endif
 #ifdef USE_SDL
 #include <SDL.h>
 #endif /* USE_SDL */
@@ -75,14 +78,7 @@ matrixbits matrixflags;         /* This contains flags used by Matrix Brandy ext
 static void init1(void);
 static void init2(void);
 static void gpio_init(void);
-#ifdef USE_SDL
-static void *escape_thread(void *);
-static void init_timer(void);
-#endif
 static void *run_interpreter(void *);
-#ifndef TARGET_RISCOS
-static void *timer_thread(void *);
-#endif
 static void init_clock(void);
 
 static char inputline[INPUTLEN];        /* Last line read */
@@ -125,9 +121,6 @@ int main(int argc, char *argv[]) {
 
 #else
 int main(int argc, char *argv[]) {
-#ifdef USE_SDL
-  pthread_t escape_thread_id;
-#endif
   pthread_t interp_thread_id;
   pthread_attr_t threadattrs, *threadattrp;
   init1();
@@ -167,23 +160,28 @@ int main(int argc, char *argv[]) {
     }
   }
 #ifdef USE_SDL
-  init_timer(); /* Initialise the timer thread */
   tmsg.bailout = -1;
-  if (pthread_create(&escape_thread_id, NULL, &escape_thread, NULL)) {
-    fprintf(stderr, "Unable to create Escape handler thread.\n");
-    exit(1);
-  }
   if (pthread_create(&interp_thread_id, threadattrp, &run_interpreter, NULL)) {
     fprintf(stderr, "Unable to create Interpreter thread\n");
     exit(1);
   }
+#ifdef TARGET_UNIX
+  {
+/* Keep the profiler's signal away from the screen update thread */
+    sigset_t profmask;
+    sigemptyset(&profmask);
+    sigaddset(&profmask, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &profmask, NULL);
+  }
+#endif
   videoupdatethread();
 #else
   if (pthread_create(&interp_thread_id, threadattrp, &run_interpreter, NULL)) {
     fprintf(stderr, "Unable to create Interpreter thread\n");
     exit(1);
   }
-  timer_thread(0);
+/* The interpreter ends the run by calling exit(), so this does not return */
+  pthread_join(interp_thread_id, NULL);
 #endif
   return EXIT_FAILURE;
 }
@@ -297,6 +295,8 @@ static void init1(void) {
   matrixflags.printer_ignore = 13;    /* By default, ignore carriage return characters */
   matrixflags.translatefname = 2;     /* 0 = Don't, 1 = Always, 2 = Attempt autodetect */
   matrixflags.startupmode = BRANDY_STARTUP_MODE;  /* Defaults to 0 */
+  matrixflags.outbufsize = BRANDY_OUTBUF_SIZE * 1024;
+  matrixflags.mmapsize = BRANDY_MMAP_SIZE * 1024;
 #ifndef BRANDY_NOVERCHECK
 #ifdef BRANDYAPP
   matrixflags.checknewver = 0;        /* By default, try to check for a new version */
@@ -362,6 +362,22 @@ static void init2(void) {
   init_interpreter();
 }
 
+/*
+** 'get_outbufsize' decodes the size given for the '-outbuf' and
+** '-mmap' options, which can have a suffix of 'k' or 'm'
+*/
+static size_t get_outbufsize(char *parameter) {
+  char *sp;
+  long value = strtol(parameter, &sp, 10);
+  size_t size = value>0 ? CAST(value, size_t) : 0;
+  if (tolower(*sp)=='k') {              /* Size is in kilobytes */
+    size = size*1024;
+  } else if (tolower(*sp)=='m') {       /* Size is in megabytes */
+    size = size*1024*1024;
+  }
+  return size;
+}
+
 /* 'check_configfile' is called to check the configuration file
  * (~/.brandyrc on UNIX-type systems) to override compiled defaults
  * before checking the command line.
@@ -457,6 +473,10 @@ static void check_configfile() {
           worksize = worksize*1024*1024*1024;
         }
       }
+    } else if(!strncmp(item, "outbuf", 7)) {
+      if(parameter) matrixflags.outbufsize = get_outbufsize(parameter);
+    } else if(!strncmp(item, "mmap", 5)) {
+      if(parameter) matrixflags.mmapsize = get_outbufsize(parameter);
 #ifndef BRANDY_MODE7ONLY
     } else if(!strncmp(item, "startupmode", 12)) {
       if(parameter) {
@@ -609,6 +629,16 @@ static void check_cmdline(int argc, char *argv[]) {
       }
       else if (optchar == 'n' && tolower(*(p+2))=='o' && tolower(*(p+3))=='s')  /* -nostar  Ignore '*' commands */
         basicvars.runflags.ignore_starcmd = TRUE;
+#ifdef TARGET_UNIX
+      else if (optchar=='p' && tolower(*(p+2))=='r') {      /* -profile */
+        n++;
+        if (n==argc)
+          cmderror(CMD_NOFILE, p);          /* File name missing */
+        else {
+          profile_atexit(argv[n]);
+        }
+      }
+#endif
       else if (optchar=='p') {              /* -path */
         n++;
         if (n==argc)
@@ -640,6 +670,22 @@ static void check_cmdline(int argc, char *argv[]) {
           }
         }
       }
+      else if (optchar=='o') {              /* -outbuf */
+        n++;
+        if (n==argc)
+          cmderror(CMD_NOBUFSIZE, p);       /* Buffer size missing */
+        else {
+          matrixflags.outbufsize = get_outbufsize(argv[n]);
+        }
+      }
+      else if (optchar=='m') {              /* -mmap */
+        n++;
+        if (n==argc)
+          cmderror(CMD_NOMAPSIZE, p);       /* File size missing */
+        else {
+          matrixflags.mmapsize = get_outbufsize(argv[n]);
+        }
+      }
       else if (optchar=='!')                /* -! - Don't initialise signal handlers */
         basicvars.misc_flags.trapexcp = FALSE;
       else if (optchar=='-' && *(p+2) == 0) /* -- - Pass all remaining options to the Basic program */
@@ -737,51 +783,6 @@ void init_clock() {
 #endif /* !TARGET_RISCOS */
 }
 
-#ifndef TARGET_RISCOS
-static void *timer_thread(void *data) {
-  struct timespec tv;
-  while(1) {
-    clock_gettime(basicvars.clocktype, &tv);
-
-    /* tv.tv_sec  = Seconds */
-    /* tv.tv_nsec = Nanoseconds */
-
-    basicvars.centiseconds = (((uint64)tv.tv_sec * 100) + ((uint64)tv.tv_nsec / 10000000));
-    usleep(5000);
-  }
-  return 0;
-}
-
-#ifdef USE_SDL
-/* This function starts a timer thread */
-static void init_timer() {
-  pthread_t timer_thread_id;
-  int err = pthread_create(&timer_thread_id,NULL,&timer_thread,NULL);
-  if(err) {
-    fprintf(stderr,"Unable to create timer thread\n");
-    exit(1);
-  }
-}
-#endif /* USE_SDL */
-#endif /* !TARGET_RISCOS */
-
-
-#ifdef USE_SDL
-static void *escape_thread(void *dummydata) {
-  while (1) {
-    kbd_escpoll();
-#ifndef BRANDY_NOBREAKONCTRLPRTSC
-    if ((kbd_inkey(-2) && kbd_inkey(-33))) {
-      tmsg.bailout = 0;
-      while(TRUE) sleep(10);
-    }
-#endif
-    usleep(10000);
-  }
-  return(0); /* Control never reaches here */
-}
-#endif
-
 /*
 ** 'run_interpreter' is the main command loop for the interpreter.
 ** It reads commands and executes then. Control is also returned
@@ -810,6 +811,9 @@ static void *run_interpreter(void *dummydata) {
   }
 /* Control passes to this point in the event of an error via a 'siglongjmp' */
   while (TRUE) {
+#ifdef TARGET_UNIX
+    profile_running(FALSE);
+#endif
     read_command();
     tokenize(inputline, thisline, HASLINE, TRUE);
     interpret_line();
@@ -826,6 +830,9 @@ static void *run_interpreter(void *dummydata) {
 ** 'quit' command is followed by a return code, that value is used instead.
 */
 void exit_interpreter_real(int retcode) {
+#ifdef TARGET_UNIX
+  profile_final();
+#endif
   fileio_shutdown();
   end_screen();
   kbd_quit();
@@ -206,6 +206,8 @@ void clear_program(void) {
   basicvars.program[0] = asc_NUL;
   basicvars.linecount = 0;
   last_added = NIL;
+  clear_lineindex();
+  clear_defindex();
   init_stack();
 }
 
@@ -297,6 +299,8 @@ static void insert_line(byte *line) {
     basicvars.top+=newlength;
     last_added = bp;
   }
+  clear_lineindex();
+  clear_defindex();
   adjust_heaplimits();
 }
 
@@ -311,6 +315,8 @@ static void delete_line(int32 line) {
     int32 length = GET_LINELEN(p);
     memmove(p, p+length, basicvars.top-p-length+ENDMARKSIZE);
     basicvars.top-=length;
+    clear_lineindex();
+    clear_defindex();
     adjust_heaplimits();
     last_added = NIL;
   }
@@ -331,6 +337,8 @@ void delete_range(int32 low, int32 high) {
   if (GET_LINENO(highline)==high) highline+=GET_LINELEN(highline);
   memmove(lowline, highline, basicvars.top-highline+ENDMARKSIZE);
   basicvars.top-=(highline-lowline);
+  clear_lineindex();
+  clear_defindex();
   adjust_heaplimits();
   last_added = NIL;
 }
@@ -373,6 +381,7 @@ void renumber_program(byte *progstart, int32 start, int32 step) {
       }
     }
   }
+  clear_lineindex();    /* Line numbers have changed */
   bp = progstart;
   while (!AT_PROGEND(bp)) {
     reset_linenums(bp);
@@ -865,7 +874,9 @@ static void link_library(char *name, byte *base, int32 size, boolean onheap) {
   STRLCPY(lp->libname, name, nameLen);
   lp->libstart = base;
   lp->libsize = size;
-  lp->libfplist = NIL;
+  lp->libindex = make_lineindex(base, onheap);
+  lp->libdefs = make_defindex(base, onheap);
+  lp->libscanned = FALSE;
   for (n=0; n<VARLISTS; n++) lp->varlists[n] = NIL;
 }
 
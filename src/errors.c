@@ -95,6 +95,10 @@ static int sigintkey;           /* Scan code of old key used for Escape */
 static HANDLE sigintthread = NULL;     /* Thread number for Escape key watching */
 #endif
 
+#if !defined(TARGET_MINGW) && !defined(TARGET_DJGPP) && !defined(__TARGET_SCL__)
+static sigset_t trappedsigs;    /* Signals that 'handle_signal' can leave blocked */
+#endif
+
 static char errortext[200];     /* Copy of text of last error for REPORT */
 static int errortext_size = 200;
 
@@ -142,6 +146,11 @@ static void handle_signal(int signo) {
 #endif
     DEBUGFUNCMSGOUT;
     error(ERR_ADDREXCEPT);
+#ifdef SIGBUS
+  case SIGBUS:          /* Most likely a mapped file has been made shorter */
+    DEBUGFUNCMSGOUT;
+    error(fileio_shrunk() ? ERR_CANTREAD : ERR_ADDREXCEPT);
+#endif
   case SIGABRT:
 #ifdef TARGET_MINGW
     (void) signal(SIGABRT, handle_signal);
@@ -249,11 +258,26 @@ void init_errors(void) {
     (void) sigaction(SIGPIPE, &sa, NULL);
     (void) sigaction(SIGFPE, &sa, NULL);
     (void) sigaction(SIGSEGV, &sa, NULL);
+#ifdef SIGBUS
+    (void) sigaction(SIGBUS, &sa, NULL);
+#endif
     (void) sigaction(SIGABRT, &sa, NULL);
     (void) sigaction(SIGINT, &sa, NULL);
 #if defined(TARGET_UNIX) | defined(TARGET_MACOSX)
     (void) sigaction(SIGCONT, &sa, NULL);
 #endif
+/* Errors raised in the handler leave via siglongjmp with the signal still blocked */
+    (void) sigemptyset(&trappedsigs);
+    (void) sigaddset(&trappedsigs, SIGFPE);
+    (void) sigaddset(&trappedsigs, SIGSEGV);
+#ifdef SIGBUS
+    (void) sigaddset(&trappedsigs, SIGBUS);
+#endif
+    (void) sigaddset(&trappedsigs, SIGABRT);
+#ifndef BODGEDJP
+    (void) sigaddset(&trappedsigs, SIGTTIN);
+    (void) sigaddset(&trappedsigs, SIGTTOU);
+#endif
 
 #endif /* TARGET_MINGW | TARGET_DJGPP */
   }
@@ -270,6 +294,9 @@ void restore_handlers(void) {
   if (basicvars.misc_flags.trapexcp) {
     (void) signal(SIGFPE, SIG_DFL);
     (void) signal(SIGSEGV, SIG_DFL);
+#ifdef SIGBUS
+    (void) signal(SIGBUS, SIG_DFL);
+#endif
     (void) signal(SIGABRT, SIG_DFL);
     (void) signal(SIGINT, SIG_DFL);
 #if defined(TARGET_UNIX) | defined(TARGET_MACOSX)
@@ -371,6 +398,14 @@ void show_help(void) {
   printf("  -version       Print version\n");
   printf("  -size <size>   Set Basic workspace size to <size> bytes when starting\n");
   printf("                 Suffix with K, M or G to specify size in KiB, MiB or GiB.\n");
+#if !defined(TARGET_RISCOS) && !defined(USE_SDL) && !defined(BRANDYAPP)
+  printf("  -outbuf <size> Buffer <size> bytes of output when not writing to a terminal\n");
+  printf("                 Suffix with K or M to specify size in KiB or MiB.\n");
+#endif
+#ifdef TARGET_UNIX
+  printf("  -mmap <size>   Map files of at least <size> bytes opened with OPENIN into\n");
+  printf("                 memory. Suffix with K or M to specify size in KiB or MiB.\n");
+#endif
 #ifdef USE_SDL
   printf("  -fullscreen    Start Brandy in fullscreen mode\n");
   printf("  -nofull        Never use fullscreen mode\n");
@@ -387,6 +422,9 @@ void show_help(void) {
   printf("  -chain <file>  Run Basic program <file> and stay in interpreter when it ends\n");
   printf("  -quit <file>   Run Basic program <file> and leave interpreter when it ends\n");
   printf("  -lib <file>    Load the Basic library <file> when the interpreter starts\n");
+#ifdef TARGET_UNIX
+  printf("  -profile <file> Profile the program and write the samples to <file> at the end\n");
+#endif
 #ifdef DEFAULT_IGNORE
   printf("  -strict        'Unsupported features' generate errors\n");
 #else
@@ -412,7 +450,9 @@ static detail badcmdtable [] = {
   {WARNING, STRING, 0, "Basic workspace size is missing after option '%s'\n"},
   {WARNING, NOPARM, 0, "The name of the file to load has already been supplied\n"},
   {WARNING, NOPARM, 0, "There is not enough memory available to run the interpreter\n"},
-  {WARNING, NOPARM, 0, "Initialisation of the interpreter failed\n"}
+  {WARNING, NOPARM, 0, "Initialisation of the interpreter failed\n"},
+  {WARNING, STRING, 0, "Output buffer size is missing after option '%s'\n"},
+  {WARNING, STRING, 0, "File size is missing after option '%s'\n"}
 };
 
 /*
@@ -623,6 +663,7 @@ static detail errortable [] = {
 /* ERR_NET_CONNREFUSED*/{NONFATAL, NOPARM,  165, "Connection refused"},                  // 'No reply'
 /* ERR_NET_MAXSOCKETS */{NONFATAL, NOPARM,  192, "The maximum allowed number of sockets is already open"},
 /* ERR_NET_NOTFOUND */  {NONFATAL, NOPARM,  213, "Host not found"},                      // 'Disk not present'
+/* ERR_NET_ADDRINUSE */ {NONFATAL, NOPARM,  194, "Address already in use"},              // 'Already open'
 /* ERR_NO_RPI_GPIO */   {NONFATAL, NOPARM,  510, "Raspberry Pi GPIO not available"},
 //
 // Dynamic Linker errors
@@ -633,6 +674,7 @@ static detail errortable [] = {
 /* ERR_NODIR */         {NONFATAL, NOPARM,  189, "Unable to create directory"},
 /* ERR_FILELOCKED */    {NONFATAL, NOPARM,  195, "This item is locked to stop changes being made to it"},
 /* ERR_BAD_OSFILE */    {NONFATAL, NOPARM, 1026, "Bad OSFile call"},
+/* ERR_NOPROFILE */     {NONFATAL, NOPARM,    0, "The profiler is not available on this platform"},
 //
 // DO NOT PUT ANYTHING BELOW THIS LINE - THIS MUST BE THE LAST ERROR
 /* HIGHERROR */         {FATAL,    NOPARM,    0, "You should never see this"} /* ALWAYS leave this as the last error */
@@ -792,6 +834,13 @@ static void handle_error(errortype severity) {
     }
 #endif
     if (basicvars.error_handler.islocal) {        /* Trapped via 'ON ERROR LOCAL' */
+#if !defined(TARGET_MINGW) && !defined(TARGET_DJGPP) && !defined(__TARGET_SCL__)
+/*
+** Functions set up their restart point without saving the signal mask
+** so unblock any signal whose handler raised this error
+*/
+      if (basicvars.misc_flags.trapexcp) (void) sigprocmask(SIG_UNBLOCK, &trappedsigs, NULL);
+#endif
 #ifdef DEBUG
       if (basicvars.debug_flags.debug) fprintf(stderr, "About to siglongjmp(*basicvars.local_restart,1), local_restart = %p\n", basicvars.local_restart);
 #endif
@@ -195,6 +195,7 @@ typedef enum {
     ERR_NET_CONNREFUSED,/* 165, Connection refused */
     ERR_NET_MAXSOCKETS, /* 192, Maximum number of sockets already open */
     ERR_NET_NOTFOUND,   /* 213, Host not found */
+    ERR_NET_ADDRINUSE,  /* 194, Address already in use */
     ERR_NO_RPI_GPIO,    /* 510, Raspberry Pi GPIO not available */
 // Dynamic Linker errors
     ERR_DL_NODL,        /* 0, dlopen() and friends not available */
@@ -204,6 +205,7 @@ typedef enum {
     ERR_NODIR,          /* 104885 (189), Unable to create directory */
     ERR_FILELOCKED,     /* 67779  (195), This item is locked */
     ERR_BAD_OSFILE,     /* 1026, Bad OSFile call */
+    ERR_NOPROFILE,      /* 0, Profiler not available */
 // No more errors
     HIGHERROR           /* Leave last, dummy error */
 } errnum;
@@ -215,6 +217,8 @@ typedef enum {
 #define CMD_FILESUPP  3 /* File name already supplied */
 #define CMD_NOMEMORY  4 /* Not enough memory to run the interpreter */
 #define CMD_INITFAIL  5 /* Interpreter initialisation failed */
+#define CMD_NOBUFSIZE 6 /* No output buffer size supplied after option */
+#define CMD_NOMAPSIZE 7 /* No file size supplied after option */
 
 extern void init_errors(void);
 extern void watch_signals(void);
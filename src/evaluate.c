@@ -30,6 +30,11 @@
 #include <time.h>
 #include <setjmp.h>
 #include "target.h"
+#if !defined(TARGET_RISCOS) && !defined(TARGET_DJGPP)
+#define MATMULTHREADS                   /* Split large matrix multiplications between threads */
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include "common.h"
 #include "basicdefs.h"
 #include "tokens.h"
@@ -373,6 +378,185 @@ static float64 fdivwithtest(float64 lh, float64 rh) {
   return(res);
 }
 
+/*
+** The following functions carry out the multiplications and divisions
+** of whole arrays that need the results checking. Each array is dealt
+** with a chunk at a time. The '_kernel' functions work out the results
+** for a chunk without stopping to check each one, which allows the C
+** compiler to vectorise them, and say whether any result is in error.
+** If one is, that chunk is worked out again an element at a time using
+** the functions above so that the error is reported in the same way.
+** On x86 Linux with gcc, AVX2 versions of the kernels are built as well
+** as the plain SSE2 ones and the one to use is picked when the program
+** is loaded.
+*/
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6 && defined(__x86_64__) && defined(__linux__)
+#define ARRAYKERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define ARRAYKERNEL
+#endif
+
+#define ARRAYCHUNK 512                  /* Number of array elements dealt with at a time */
+
+/*
+** 'fpbad' returns 1 if 'x' is neither zero nor a normal number, that is,
+** it is subnormal, infinite or a NaN. The exponent and mantissa are
+** tested as integers as that vectorises where comparing the values
+** themselves does not
+*/
+static inline int32 fpbad(float64 x) {
+  uint64 bits, exponent;
+  memcpy(&bits, &x, sizeof(bits));
+  exponent = (bits >> 52) & 0x7FF;
+  return (((exponent+1) & 0x7FF) <= 1) & ((bits << 1) != 0);
+}
+
+static ARRAYKERNEL boolean fmul_kernel(float64 *restrict dest, const float64 *restrict lh, const float64 *restrict rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    float64 res = lh[n]*rh[n];
+    dest[n] = res;
+    bad |= fpbad(res);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean fmuls_kernel(float64 *restrict dest, const float64 *restrict lh, float64 rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    float64 res = lh[n]*rh;
+    dest[n] = res;
+    bad |= fpbad(res);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean fdiv_kernel(float64 *restrict dest, const float64 *restrict lh, const float64 *restrict rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    float64 res = lh[n]/rh[n];
+    dest[n] = res;
+    bad |= (rh[n] == 0.0) | fpbad(res);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean fdivs_kernel(float64 *restrict dest, const float64 *restrict lh, float64 rh, int32 count) {
+  int32 n, bad = 0;
+  if (rh == 0.0) return FALSE;
+  for (n = 0; n < count; n++) {
+    float64 res = lh[n]/rh;
+    dest[n] = res;
+    bad |= fpbad(res);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean fsdiv_kernel(float64 *restrict dest, float64 lh, const float64 *restrict rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    float64 res = lh/rh[n];
+    dest[n] = res;
+    bad |= (rh[n] == 0.0) | fpbad(res);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean i32mul_kernel(int32 *restrict dest, const int32 *restrict lh, const int32 *restrict rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    int64 res = (int64)lh[n]*rh[n];
+    dest[n] = (int32)res;
+    bad |= (res > MAXINTVAL) | (res < -MAXINTVAL);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean i32muls_kernel(int32 *restrict dest, const int32 *restrict lh, int32 rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    int64 res = (int64)lh[n]*rh;
+    dest[n] = (int32)res;
+    bad |= (res > MAXINTVAL) | (res < -MAXINTVAL);
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean i64mul_kernel(int64 *restrict dest, const int64 *restrict lh, const int64 *restrict rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    dest[n] = CAST((uint64)lh[n]*(uint64)rh[n], int64);
+    bad |= fabs((float64)lh[n]*(float64)rh[n]) > (float64)MAXINT64VAL;
+  }
+  return bad == 0;
+}
+
+static ARRAYKERNEL boolean i64muls_kernel(int64 *restrict dest, const int64 *restrict lh, int64 rh, int32 count) {
+  int32 n, bad = 0;
+  for (n = 0; n < count; n++) {
+    dest[n] = CAST((uint64)lh[n]*(uint64)rh, int64);
+    bad |= fabs((float64)lh[n]*(float64)rh) > (float64)MAXINT64VAL;
+  }
+  return bad == 0;
+}
+
+/*
+** 'ARRAYCHUNKS' runs the kernel call 'kernel' over 'count' elements a
+** chunk at a time, copying the results to 'dest' if they are all okay or
+** working them out again using 'checked' if not. Within 'kernel' and
+** 'checked', 'n' is the index of the first element of the chunk, 'len'
+** the number of elements in it and 'i' the index of the element being
+** checked
+*/
+#define ARRAYCHUNKS(type, dest, count, kernel, checked) { \
+  type chunk[ARRAYCHUNK]; \
+  int32 n, i, len; \
+  for (n = 0; n < (count); n += len) { \
+    len = (count)-n < ARRAYCHUNK ? (count)-n : ARRAYCHUNK; \
+    if (kernel) \
+      memcpy((dest)+n, chunk, len*sizeof(type)); \
+    else { \
+      for (i = n; i < n+len; i++) (dest)[i] = (checked); \
+    } \
+  } \
+}
+
+static void fmul_arrays(float64 *dest, float64 *lh, float64 *rh, int32 count) {
+  ARRAYCHUNKS(float64, dest, count, fmul_kernel(chunk, lh+n, rh+n, len), fmulwithtest(lh[i], rh[i]))
+}
+
+static void fmul_arrayvalue(float64 *dest, float64 *lh, float64 rh, int32 count) {
+  ARRAYCHUNKS(float64, dest, count, fmuls_kernel(chunk, lh+n, rh, len), fmulwithtest(lh[i], rh))
+}
+
+static void fdiv_arrays(float64 *dest, float64 *lh, float64 *rh, int32 count) {
+  ARRAYCHUNKS(float64, dest, count, fdiv_kernel(chunk, lh+n, rh+n, len), fdivwithtest(lh[i], rh[i]))
+}
+
+static void fdiv_arrayvalue(float64 *dest, float64 *lh, float64 rh, int32 count) {
+  ARRAYCHUNKS(float64, dest, count, fdivs_kernel(chunk, lh+n, rh, len), fdivwithtest(lh[i], rh))
+}
+
+static void fdiv_valuearray(float64 *dest, float64 lh, float64 *rh, int32 count) {
+  ARRAYCHUNKS(float64, dest, count, fsdiv_kernel(chunk, lh, rh+n, len), fdivwithtest(lh, rh[i]))
+}
+
+static void i32mul_arrays(int32 *dest, int32 *lh, int32 *rh, int32 count) {
+  ARRAYCHUNKS(int32, dest, count, i32mul_kernel(chunk, lh+n, rh+n, len), i32mulwithtest(lh[i], rh[i]))
+}
+
+static void i32mul_arrayvalue(int32 *dest, int32 *lh, int32 rh, int32 count) {
+  ARRAYCHUNKS(int32, dest, count, i32muls_kernel(chunk, lh+n, rh, len), i32mulwithtest(lh[i], rh))
+}
+
+static void i64mul_arrays(int64 *dest, int64 *lh, int64 *rh, int32 count) {
+  ARRAYCHUNKS(int64, dest, count, i64mul_kernel(chunk, lh+n, rh+n, len), i64mulwithtest(lh[i], rh[i]))
+}
+
+static void i64mul_arrayvalue(int64 *dest, int64 *lh, int64 rh, int32 count) {
+  ARRAYCHUNKS(int64, dest, count, i64muls_kernel(chunk, lh+n, rh, len), i64mulwithtest(lh[i], rh))
+}
+
 /*
 ** 'eval_intfactor' evaluates a numeric factor where an integer is
 ** required. The function returns the value obtained.
@@ -1360,6 +1544,9 @@ static void do_getfloat(void) {
 ** block with a pointer to that block held with the rest of the Basic
 ** variables in 'basicvars'. The existing pointer is saved by the call
 ** 'push_fn'. Note that 'push_fn' also saves the operator stack pointer.
+** The signal mask is not saved in the environment block as that costs
+** a system call on every function call. 'handle_error' puts the mask
+** right before jumping back here instead.
 **
 ** The DJGPP version of the program includes a check for the amount of
 ** C stack left in this function. This is needed as there are no checks
@@ -1409,7 +1596,7 @@ static void do_function(void) {
   }
   tp = basicvars.current;
 
-  if (sigsetjmp(*basicvars.local_restart, 1) == 0) {
+  if (sigsetjmp(*basicvars.local_restart, 0) == 0) {
     exec_fnstatements(dp->fnprocaddr);
   } else {
 /*
@@ -1754,7 +1941,7 @@ static void core_eval_iv_op(int oper) {
             } else { /* STACK_INT and STACK_UINT8 */
               int32 *base = make_array(VAR_INTWORD, lharray);
               srce = lharray->arraystart.intbase;
-              for (n = 0; n < lharray->arrsize; n++) base[n] = i32mulwithtest(srce[n], rhint);
+              i32mul_arrayvalue(base, srce, rhint, lharray->arrsize);
             }
           } else if (lhitem == STACK_UINT8ARRAY) {                    /* <int array>*<intX> */
             uint8 *srce;
@@ -1774,12 +1961,12 @@ static void core_eval_iv_op(int oper) {
           } else if (lhitem == STACK_INT64ARRAY) {            /* <int64 array>*<intX> */
             int64 *srce = lharray->arraystart.int64base;
             int64 *base = make_array(VAR_INTLONG, lharray);
-            for (n = 0; n < lharray->arrsize; n++) base[n] = i64mulwithtest(srce[n], rhint);
+            i64mul_arrayvalue(base, srce, rhint, lharray->arrsize);
           } else {    /* <float array>*<integer> */
             float64 *srce = lharray->arraystart.floatbase;
             float64 *base = make_array(VAR_FLOAT, lharray);
             floatvalue = TOFLOAT(rhint);
-            for (n = 0; n < lharray->arrsize; n++) base[n] = fmulwithtest(srce[n], floatvalue);
+            fmul_arrayvalue(base, srce, floatvalue, lharray->arrsize);
           }
         }
         break;
@@ -1796,7 +1983,7 @@ static void core_eval_iv_op(int oper) {
             for (n = 0; n < lharray->arrsize; n++) base[n] = fdivwithtest(TOFLOAT(srce[n]), floatvalue);
           } else {
             float64 *srce = lharray->arraystart.floatbase;
-            for (n = 0; n < lharray->arrsize; n++) base[n] = fdivwithtest(srce[n], floatvalue);
+            fdiv_arrayvalue(base, srce, floatvalue, lharray->arrsize);
           }
         }
         break;
@@ -1854,10 +2041,10 @@ static void core_eval_iv_op(int oper) {
           for (n = 0; n < lharray.arrsize; n++) base[n] -= floatvalue;
         break;
       case OP_MUL: /* <float array>*<integer value> */
-          for (n = 0; n < lharray.arrsize; n++) base[n]=fmulwithtest(base[n], floatvalue);
+          fmul_arrayvalue(base, base, floatvalue, lharray.arrsize);
         break;
       case OP_DIV: /* <float array>/<integer value> */
-          for (n = 0; n < lharray.arrsize; n++) base[n] = fdivwithtest(base[n], floatvalue);
+          fdiv_arrayvalue(base, base, floatvalue, lharray.arrsize);
         break;
     }
     push_arraytemp(&lharray, VAR_FLOAT);
@@ -1952,7 +2139,7 @@ static void core_eval_fv_op(int oper) {
             for (n = 0; n < lharray->arrsize; n++) base[n] = fmulwithtest(TOFLOAT(srce[n]), floatvalue);
           } else {
             float64 *srce = lharray->arraystart.floatbase;
-            for (n = 0; n < lharray->arrsize; n++) base[n] = fmulwithtest(srce[n], floatvalue);
+            fmul_arrayvalue(base, srce, floatvalue, lharray->arrsize);
           }
         }
         break;
@@ -1969,7 +2156,7 @@ static void core_eval_fv_op(int oper) {
             for (n = 0; n < lharray->arrsize; n++) base[n] = fdivwithtest(TOFLOAT(srce[n]), floatvalue);
           } else {
             float64 *srce = lharray->arraystart.floatbase;
-            for (n = 0; n < lharray->arrsize; n++) base[n] = fdivwithtest(srce[n], floatvalue);
+            fdiv_arrayvalue(base, srce, floatvalue, lharray->arrsize);
           }
         }
         break;
@@ -2025,7 +2212,7 @@ static void core_eval_fv_op(int oper) {
         for (n = 0; n < lharray.arrsize; n++) base[n]*=floatvalue;
         break;
       case OP_DIV:    /* <float array>/<float value> */
-        for (n = 0; n < lharray.arrsize; n++) base[n] = fdivwithtest(base[n], floatvalue);
+        fdiv_arrayvalue(base, base, floatvalue, lharray.arrsize);
         break;
     }
     push_arraytemp(&lharray, VAR_FLOAT);
@@ -2621,7 +2808,7 @@ static void eval_iamul(void) {
   if (lhitem == STACK_INT || lhitem == STACK_UINT8) {   /* <int32/uint8 value>*<integer array> */
     int32 *base = make_array(VAR_INTWORD, rharray);
     int32 lhint = pop_anyint();
-    for (n = 0; n < rharray->arrsize; n++) base[n] = i32mulwithtest(lhint, rhsrce[n]);
+    i32mul_arrayvalue(base, rhsrce, lhint, rharray->arrsize);
   } else if (lhitem == STACK_INT64) {                   /* <int64 value>*<integer array> */
     int64 *base = make_array(VAR_INTLONG, rharray);
     int64 lhint64=pop_int64();
@@ -2636,7 +2823,7 @@ static void eval_iamul(void) {
     if (lhitem == STACK_INTARRAY) {                /* <int array>*<int array> */
       int32 *base = make_array(VAR_INTWORD, rharray);
       int32 *lhsrce = lharray->arraystart.intbase;
-      for (n = 0; n < rharray->arrsize; n++) base[n] = i32mulwithtest(lhsrce[n], rhsrce[n]);
+      i32mul_arrays(base, lhsrce, rhsrce, rharray->arrsize);
     } else if (lhitem == STACK_UINT8ARRAY) {              /* <uint8 array>*<int array> */
       int32 *base = make_array(VAR_INTWORD, rharray);
       uint8 *lhsrce = lharray->arraystart.uint8base;
@@ -2733,7 +2920,7 @@ static void eval_i64amul(void) {
   if (TOPITEMISINT) {   /* <int32/uint8 value>*<int64 array> */
     int64 lhint64 = pop_anyint();
     int64 *base = make_array(VAR_INTLONG, rharray);
-    for (n = 0; n < rharray->arrsize; n++) base[n] = i64mulwithtest(lhint64, rhsrce[n]);
+    i64mul_arrayvalue(base, rhsrce, lhint64, rharray->arrsize);
   } else if (lhitem == STACK_FLOAT) {   /* <float>*<int64 array> */
     floatvalue = pop_float();
     float64 *base = make_array(VAR_FLOAT, rharray);
@@ -2752,7 +2939,7 @@ static void eval_i64amul(void) {
     } else if (lhitem == STACK_INT64ARRAY) {      /* <int64 array>*<int64 array> */
       int64 *lhsrce = lharray->arraystart.int64base;
       int64 *base = make_array(VAR_INTLONG, rharray);
-      for (n = 0; n < rharray->arrsize; n++) base[n] = i64mulwithtest(lhsrce[n], rhsrce[n]);
+      i64mul_arrays(base, lhsrce, rhsrce, rharray->arrsize);
     } else if (lhitem == STACK_FLOATARRAY) {      /* <float array>*<int64 array> */
       float64 *lhsrce = lharray->arraystart.floatbase;
       float64 *base = make_array(VAR_FLOAT, rharray);
@@ -2785,7 +2972,7 @@ static void eval_famul(void) {
   if (TOPITEMISNUM) {   /* <int or float>*<float array> */
     floatvalue = pop_anynumfp();
     base = make_array(VAR_FLOAT, rharray);
-    for (n = 0; n < rharray->arrsize; n++) base[n] = fmulwithtest(floatvalue, rhsrce[n]);
+    fmul_arrayvalue(base, rhsrce, floatvalue, rharray->arrsize);
   } else if (TOPITEMISNUMARRAY) {
     basicarray *lharray = pop_array();
     check_arrays(lharray, rharray);
@@ -2798,14 +2985,14 @@ static void eval_famul(void) {
       for (n = 0; n < rharray->arrsize; n++) base[n] = fmulwithtest(TOFLOAT(lhsrce[n]), rhsrce[n]);
     } else if (lhitem == STACK_FLOATARRAY) {      /* <float array>*<float array> */
       float64 *lhsrce = lharray->arraystart.floatbase;
-      for (n = 0; n < rharray->arrsize; n++) base[n] = fmulwithtest(lhsrce[n], rhsrce[n]);
+      fmul_arrays(base, lhsrce, rhsrce, rharray->arrsize);
     }
   } else if (lhitem == STACK_FATEMP) {          /* <float array>*<float array> */
     float64 *lhsrce;
     basicarray lharray = pop_arraytemp();
     check_arrays(&lharray, rharray);
     lhsrce = lharray.arraystart.floatbase;
-    for (n = 0; n < rharray->arrsize; n++) lhsrce[n] = fmulwithtest(lhsrce[n], rhsrce[n]);
+    fmul_arrays(lhsrce, lhsrce, rhsrce, rharray->arrsize);
     push_arraytemp(&lharray, VAR_FLOAT);
   } else want_number();
   DEBUGFUNCMSGOUT;
@@ -2868,6 +3055,171 @@ static void check_arraytype(basicarray *result, basicarray *lharray, basicarray
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** Large matrix multiplications are carried out a block at a time to make
+** better use of the processor cache. The result is built up a row at a
+** time, adding in the rows of the right-hand matrix multiplied by each
+** element of the left-hand row in turn. This runs along the rows of both
+** matrices instead of down the columns of the right-hand one, and the
+** innermost loop is simple enough for the C compiler to vectorise. Each
+** result element is still summed in the same order as the simple method
+** uses. Matrices with enough rows are split between several threads
+*/
+#define MATMULMIN 32768                 /* Smallest multiplication (rows*columns*inner) to use the blocked code */
+#define MATBLOCKCOLS 256                /* Number of result columns worked on at once */
+#define MATBLOCKINNER 128               /* Number of right-hand rows worked on at once */
+#ifdef MATMULTHREADS
+#define MATTHREADMIN 4194304            /* Smallest multiplication to split between threads */
+#define MATTHREADROWS 16                /* Fewest result rows to give a thread */
+#define MATMAXTHREADS 8                 /* Most threads to use */
+#else
+#define MATMAXTHREADS 1
+#endif
+
+typedef struct {
+  boolean isfloat;                      /* TRUE if arrays are floating point, FALSE if 32-bit integer */
+  void *result, *lhbase, *rhbase;       /* Result, left-hand and right-hand matrices */
+  int32 firstrow, lastrow;              /* Range of result rows to calculate */
+  int32 inner;                          /* Number of columns in left-hand matrix = rows in right-hand one */
+  int32 columns;                        /* Number of columns in the result and right-hand matrix */
+} matmuljob;
+
+/*
+** 'matmul_rows' calculates the rows of the matrix product described
+** by 'job'. Integer arithmetic is carried out unsigned so that it
+** wraps around in the same way as the simple method
+*/
+static void matmul_rows(matmuljob *job) {
+  int32 col, lastcol, inner, lastinner, row, n, k;
+  int32 columns = job->columns;
+  for (col = 0; col < columns; col += MATBLOCKCOLS) {
+    lastcol = col+MATBLOCKCOLS < columns ? col+MATBLOCKCOLS : columns;
+    for (inner = 0; inner < job->inner; inner += MATBLOCKINNER) {
+      lastinner = inner+MATBLOCKINNER < job->inner ? inner+MATBLOCKINNER : job->inner;
+      for (row = job->firstrow; row < job->lastrow; row++) {
+        if (job->isfloat) {
+          float64 *restrict resrow = CAST(job->result, float64 *)+(size_t)row*columns;
+          float64 *lhrow = CAST(job->lhbase, float64 *)+(size_t)row*job->inner;
+          if (inner == 0) for (n = col; n < lastcol; n++) resrow[n] = 0.0;
+          for (k = inner; k < lastinner; k++) {
+            float64 lhvalue = lhrow[k];
+            float64 *restrict rhrow = CAST(job->rhbase, float64 *)+(size_t)k*columns;
+            for (n = col; n < lastcol; n++) resrow[n] += lhvalue*rhrow[n];
+          }
+        } else {
+          uint32 *restrict resrow = CAST(job->result, uint32 *)+(size_t)row*columns;
+          uint32 *lhrow = CAST(job->lhbase, uint32 *)+(size_t)row*job->inner;
+          if (inner == 0) for (n = col; n < lastcol; n++) resrow[n] = 0;
+          for (k = inner; k < lastinner; k++) {
+            uint32 lhvalue = lhrow[k];
+            uint32 *restrict rhrow = CAST(job->rhbase, uint32 *)+(size_t)k*columns;
+            for (n = col; n < lastcol; n++) resrow[n] += lhvalue*rhrow[n];
+          }
+        }
+      }
+    }
+  }
+}
+
+#ifdef MATMULTHREADS
+static void *matmul_thread(void *job) {
+  matmul_rows(CAST(job, matmuljob *));
+  return NIL;
+}
+
+/*
+** 'matmul_threads' returns the number of threads to use for a
+** multiplication with 'rows' result rows and 'work' multiplications
+*/
+static int32 matmul_threads(int32 rows, double work) {
+  static int32 cpucount = 0;
+  int32 threads;
+  if (cpucount == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    cpucount = n > 0 ? (n < MATMAXTHREADS ? n : MATMAXTHREADS) : 1;
+#else
+    cpucount = 1;
+#endif
+  }
+  if (work < MATTHREADMIN) return 1;
+  threads = rows/MATTHREADROWS;
+  return threads < 1 ? 1 : (threads > cpucount ? cpucount : threads);
+}
+#endif
+
+/*
+** 'fmatmul_safe' checks that no product of an element of the 'lhsize'
+** element array 'lhbase' and one of the 'rhsize' element array 'rhbase'
+** can overflow or underflow. If one could, the multiplication has to be
+** done the slow way so that the error is reported as it would be there
+*/
+static boolean fmatmul_safe(float64 *lhbase, int32 lhsize, float64 *rhbase, int32 rhsize) {
+  float64 lhmax = 0.0, lhmin = HUGE_VAL, rhmax = 0.0, rhmin = HUGE_VAL, value;
+  int32 n;
+  for (n = 0; n < lhsize; n++) {
+    value = fabs(lhbase[n]);
+    if (value != 0.0) {
+      if (!isfinite(value)) return FALSE;
+      if (value > lhmax) lhmax = value;
+      if (value < lhmin) lhmin = value;
+    }
+  }
+  for (n = 0; n < rhsize; n++) {
+    value = fabs(rhbase[n]);
+    if (value != 0.0) {
+      if (!isfinite(value)) return FALSE;
+      if (value > rhmax) rhmax = value;
+      if (value < rhmin) rhmin = value;
+    }
+  }
+  if (lhmax == 0.0 || rhmax == 0.0) return TRUE;        /* All the products are zero */
+  return isnormal(lhmax*rhmax) && isnormal(lhmin*rhmin);
+}
+
+/*
+** 'matmul_blocked' multiplies the 'rows' by 'inner' matrix at 'lhbase'
+** by the 'inner' by 'columns' matrix at 'rhbase', leaving the result
+** at 'result'. It returns FALSE if the matrices are too small for the
+** blocked method to be worth using or, for floating point matrices, if
+** the simple method has to be used to check for errors
+*/
+static boolean matmul_blocked(boolean isfloat, void *result, void *lhbase, void *rhbase, int32 rows, int32 inner, int32 columns) {
+  matmuljob jobs[MATMAXTHREADS];
+  double work = (double)rows*inner*columns;
+  int32 threads = 1, n;
+#ifdef MATMULTHREADS
+  pthread_t threadids[MATMAXTHREADS];
+  int32 started;
+#endif
+  if (work < MATMULMIN) return FALSE;
+  if (isfloat && !fmatmul_safe(lhbase, rows*inner, rhbase, inner*columns)) return FALSE;
+#ifdef MATMULTHREADS
+  threads = matmul_threads(rows, work);
+#endif
+  for (n = 0; n < threads; n++) {
+    jobs[n].isfloat = isfloat;
+    jobs[n].result = result;
+    jobs[n].lhbase = lhbase;
+    jobs[n].rhbase = rhbase;
+    jobs[n].firstrow = CAST((int64)rows*n/threads, int32);
+    jobs[n].lastrow = CAST((int64)rows*(n+1)/threads, int32);
+    jobs[n].inner = inner;
+    jobs[n].columns = columns;
+  }
+#ifdef MATMULTHREADS
+  for (started = 1; started < threads; started++) {
+    if (pthread_create(&threadids[started], NULL, matmul_thread, &jobs[started]) != 0) break;
+  }
+  for (n = started; n < threads; n++) matmul_rows(&jobs[n]);   /* Do any rows a thread could not be started for */
+  matmul_rows(&jobs[0]);
+  for (n = 1; n < started; n++) pthread_join(threadids[n], NULL);
+#else
+  matmul_rows(&jobs[0]);
+#endif
+  return TRUE;
+}
+
 /*
 ** 'eval_immul' is called to handle matrix multiplication when
 ** the right-hand array is a 32-bit integer array
@@ -2901,6 +3253,10 @@ static void eval_immul(void) {
     base[0] = sum;
   } else {
     if (lharray->dimcount == 1) { /* Multiplying a vector by a matrix.  Result is a (row) vector */
+      if (matmul_blocked(FALSE, base, lhbase, rhbase, 1, lharray->dimsize[ROW], result.dimsize[ROW])) {
+        DEBUGFUNCMSGOUT;
+        return;
+      }
       for (resindex = 0; resindex < result.dimsize[ROW]; resindex++) {
         sum = 0;
         for (col = 0; col < lharray->dimsize[ROW]; col++) {
@@ -2918,7 +3274,7 @@ static void eval_immul(void) {
         base[resindex] = sum;
       }
     }
-    else {        /* Multiplying two two-dimensional matrices */
+    else if (!matmul_blocked(FALSE, base, lhbase, rhbase, result.dimsize[ROW], lharray->dimsize[COLUMN], result.dimsize[COLUMN])) {        /* Multiplying two two-dimensional matrices */
       resindex = 0;
       for (row = 0; row < result.dimsize[ROW]; row++) {   /* Row in the result array */
         for (col = 0; col < result.dimsize[COLUMN]; col++) {      /* Column in the result array */
@@ -2971,6 +3327,10 @@ static void eval_fmmul(void) {
     base[0] = sum;
   } else {
     if (lharray->dimcount == 1) { /* Multiplying a vector by a matrix.  Result is a (row) vector */
+      if (matmul_blocked(TRUE, base, lhbase, rhbase, 1, lharray->dimsize[ROW], result.dimsize[ROW])) {
+        DEBUGFUNCMSGOUT;
+        return;
+      }
       for (resindex = 0; resindex < result.dimsize[ROW]; resindex++) {
         sum = 0;
         for (col = 0; col < lharray->dimsize[ROW]; col++) {
@@ -2988,7 +3348,7 @@ static void eval_fmmul(void) {
         base[resindex] = sum;
       }
     }
-    else {        /* Multiplying two two-dimensional matrices */
+    else if (!matmul_blocked(TRUE, base, lhbase, rhbase, result.dimsize[ROW], lharray->dimsize[COLUMN], result.dimsize[COLUMN])) {     /* Multiplying two two-dimensional matrices */
       resindex = 0;
       for (row = 0; row < result.dimsize[ROW]; row++) {   /* Row in the result array */
         for (col = 0; col < result.dimsize[COLUMN]; col++) {      /* Column in the result array */
@@ -3163,7 +3523,7 @@ static void eval_fadiv(void) {
   if (TOPITEMISNUM) {                                           /* <int32/float value>/<float array> */
     floatvalue = pop_anynumfp();
     base = make_array(VAR_FLOAT, rharray);
-    for (n = 0; n < rharray->arrsize; n++) base[n] = fdivwithtest(floatvalue, rhsrce[n]);
+    fdiv_valuearray(base, floatvalue, rhsrce, rharray->arrsize);
   } else if (TOPITEMISNUMARRAY) {
     basicarray *lharray = pop_array();
     check_arrays(lharray, rharray);
@@ -3179,13 +3539,13 @@ static void eval_fadiv(void) {
       for (n = 0; n < rharray->arrsize; n++) base[n] = fdivwithtest(TOFLOAT(lhsrce[n]), rhsrce[n]);
     } else if (lhitem == STACK_FLOATARRAY) {                      /* <float array>/<float array> */
       float64 *lhsrce = lharray->arraystart.floatbase;
-      for (n = 0; n < rharray->arrsize; n++) base[n] = fdivwithtest(lhsrce[n], rhsrce[n]);
+      fdiv_arrays(base, lhsrce, rhsrce, rharray->arrsize);
     }
   } else if (lhitem == STACK_FATEMP) {                          /* <float array>/<float array> */
     basicarray lharray = pop_arraytemp();
     float64 *lhsrce = lharray.arraystart.floatbase;
     check_arrays(&lharray, rharray);
-    for (n = 0; n < rharray->arrsize; n++) lhsrce[n] = fdivwithtest(lhsrce[n], rhsrce[n]);
+    fdiv_arrays(lhsrce, lhsrce, rhsrce, rharray->arrsize);
     push_arraytemp(&lharray, VAR_FLOAT);
   } else want_number();
   DEBUGFUNCMSGOUT;
@@ -4473,6 +4833,17 @@ static void (*opfunctions [21][18])(void) = {
   want_number},
 };
 
+/*
+** 'GET_FACTOR' fetches the next operand in an expression. When direct
+** dispatch is in use it jumps to the in-line code for the factor in
+** 'expression' and comes back to 'label' afterwards
+*/
+#ifdef USE_DIRECTDISPATCH
+#define GET_FACTOR(label) do { factor_return = &&label; goto *factor_labels[*basicvars.current]; label: ; } while (0)
+#else
+#define GET_FACTOR(label) (*factor_table[*basicvars.current])()
+#endif
+
 /*
 ** 'expression' is the main function called when evaluating an expression
 ** and also the heart of the expression code. It contains the program's
@@ -4490,7 +4861,23 @@ static void (*opfunctions [21][18])(void) = {
 ** adjacent or separated by higher priority operators.
 */
 void expression(void) {
-  int32 thisop, lastop;
+  int32 thisop, lastop = OPSTACKMARK;
+#ifdef USE_DIRECTDISPATCH
+  void *factor_return;
+  static void *factor_labels[256] = {
+    [0 ... 255] = &&factor_call,
+    [BASTOKEN_STATICVAR] = &&factor_staticvar,
+    [BASTOKEN_INTVAR] = &&factor_intvar,
+    [BASTOKEN_FLOATVAR] = &&factor_floatvar,
+    [BASTOKEN_INTZERO] = &&factor_intzero,
+    [BASTOKEN_INTONE] = &&factor_intone,
+    [BASTOKEN_SMALLINT] = &&factor_smallconst,
+    [BASTOKEN_INTCON] = &&factor_intconst,
+    [BASTOKEN_FLOATZERO] = &&factor_floatzero,
+    [BASTOKEN_FLOATONE] = &&factor_floatone,
+    [BASTOKEN_FLOATCON] = &&factor_floatconst
+  };
+#endif
 
   DEBUGFUNCMSGIN;
   if (*basicvars.current == ' ') {
@@ -4507,7 +4894,7 @@ void expression(void) {
 #ifdef DEBUG
   if (basicvars.debug_flags.debug) fprintf(stderr, "    expression: About to factor table jump, *basicvars.current=0x%X, current=0x%llX at line %d\n", *basicvars.current, (int64)(size_t)basicvars.current, 2 + __LINE__);
 #endif
-  (*factor_table[*basicvars.current])();        /* Get first factor in the expression */
+  GET_FACTOR(got_first);                        /* Get first factor in the expression */
 #ifdef DEBUG
   if (basicvars.debug_flags.debug) fprintf(stderr, "expression: returned from factor_table jump, current=0x%llX\n", (int64)(size_t)basicvars.current);
 #endif
@@ -4522,7 +4909,7 @@ void expression(void) {
 #ifdef DEBUG
   if (basicvars.debug_flags.debug) fprintf(stderr, "    expression: About to factor table jump, *basicvars.current=0x%X, current=0x%llX at line %d\n", *basicvars.current, (int64)(size_t)basicvars.current, 2 + __LINE__);
 #endif
-  (*factor_table[*basicvars.current])();        /* Get second operand */
+  GET_FACTOR(got_second);                       /* Get second operand */
 #ifdef DEBUG
   if (basicvars.debug_flags.debug) fprintf(stderr, "expression: returned from factor_table jump, current=0x%llX\n", (int64)(size_t)basicvars.current);
 #endif
@@ -4572,7 +4959,7 @@ void expression(void) {
     *basicvars.opstop = lastop;
     lastop = thisop;
     basicvars.current++;        /* Skip operator (always one character) */
-    (*factor_table[*basicvars.current])();      /* Get next operand */
+    GET_FACTOR(got_next);                       /* Get next operand */
     thisop = optable[*basicvars.current];
   } while (thisop != 0);
   while (lastop != OPSTACKMARK) {       /* Now clear the operator stack */
@@ -4583,6 +4970,57 @@ void expression(void) {
 #ifdef DEBUG
     if (basicvars.debug_flags.functions) fprintf(stderr, "<<< Exited function evaluate.c:expression at end of function, current=0x%llX\n", (int64)(size_t)basicvars.current);
 #endif
+#ifdef USE_DIRECTDISPATCH
+  return;
+/*
+** In-line versions of the commonest factor functions. These are
+** exactly the same as the functions in 'factor_table' but avoid a
+** function call for each operand. Everything else goes via the table
+*/
+factor_staticvar:
+  PUSH_INT(basicvars.staticvars[*(basicvars.current+1)].varentry.varinteger);
+  basicvars.current+=2;
+  goto *factor_return;
+factor_intvar:
+  PUSH_INT(*GET_ADDRESS(basicvars.current, int32 *));
+  basicvars.current+=LOFFSIZE+1;
+  goto *factor_return;
+factor_floatvar:
+  PUSH_FLOAT(*GET_ADDRESS(basicvars.current, float64 *));
+  basicvars.current+=LOFFSIZE+1;
+  goto *factor_return;
+factor_intzero:
+  PUSH_INT(0);
+  basicvars.current++;
+  goto *factor_return;
+factor_intone:
+  PUSH_INT(1);
+  basicvars.current++;
+  goto *factor_return;
+factor_smallconst:
+  PUSH_INT(*(basicvars.current+1)+1);
+  basicvars.current+=2;
+  goto *factor_return;
+factor_intconst:
+  PUSH_INT(GET_INTVALUE((basicvars.current+1)));
+  basicvars.current+=INTSIZE+1;
+  goto *factor_return;
+factor_floatzero:
+  PUSH_FLOAT(0.0);
+  basicvars.current++;
+  goto *factor_return;
+factor_floatone:
+  PUSH_FLOAT(1.0);
+  basicvars.current++;
+  goto *factor_return;
+factor_floatconst:
+  PUSH_FLOAT(get_fpvalue(basicvars.current));
+  basicvars.current+=FLOATSIZE+1;
+  goto *factor_return;
+factor_call:
+  (*factor_table[*basicvars.current])();
+  goto *factor_return;
+#endif
 }
 
 /*
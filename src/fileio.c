@@ -28,6 +28,7 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <unistd.h>
@@ -39,11 +40,17 @@
 #include "fileio.h"
 #include "strings.h"
 #include "screen.h"
-#ifndef NONET
 #include "net.h"
-#endif
 #include "keyboard.h"
 
+#ifdef TARGET_UNIX
+#define USE_MMAP                /* Large files opened with OPENIN are mapped into memory */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define GETCHAR getc_unlocked   /* Files are only used by the interpreter's thread */
+#else
+#define GETCHAR getc
+#endif
 
 /* Floating point number format */
 enum {XMIXED_ENDIAN, XLITTLE_ENDIAN, XBIG_ENDIAN, XBIG_MIXED_ENDIAN} double_type;
@@ -58,6 +65,12 @@ typedef struct {
   eofstate eofstatus;           /* Current end-of-file status */
   boolean lastwaswrite;         /* TRUE if the last operation on a file was a write */
   int nethandle;                /* network handle */
+#ifdef USE_MMAP
+  byte *mapbase;                /* Start of file in memory if it has been mapped else NIL */
+  size_t mapsize;               /* Size of the mapped part of the file */
+  size_t maplength;             /* Length of the mapping, which is more than 'mapsize' if the file has shrunk */
+  size_t mappos;                /* Current file pointer position in the mapped file */
+#endif
 } fileblock;
 
 #ifdef TARGET_RISCOS
@@ -129,6 +142,7 @@ static int32 fileio_read(int32 handle) {
   value = _kernel_osbget(handle);
   if (value==_kernel_ERROR) report();   /* Function returned -2 = SWI call failed */
   if (value==-1) error(ERR_CANTREAD);
+  basicvars.stats.bytesread+=1;
   return value;
 }
 
@@ -178,6 +192,38 @@ int32 fileio_openout(char *name, int32 namelen) {
   return handle;
 }
 
+#ifndef NONET
+/*
+** 'open_network' sets up entry 'n' in 'fileinfo' for network
+** connection 'nethandle'
+*/
+static void open_network(int32 n, int nethandle) {
+  fileinfo[n].stream = (void *)42; /* Not used, but != NIL */
+  fileinfo[n].filetype = NETWORK;
+  fileinfo[n].eofstatus = OKAY;
+  fileinfo[n].lastwaswrite = FALSE;
+  fileinfo[n].nethandle = nethandle;
+}
+
+/*
+** 'accept_connection' accepts the next connection waiting on the
+** listening socket with handle 'handle'. It returns the handle for
+** the new connection or -1 if there are none waiting
+*/
+static int32 accept_connection(int32 handle) {
+  int32 n;
+  int nethandle = brandynet_accept(fileinfo[handle].nethandle);
+  if (nethandle == -1) return -1;
+  for (n=FIRSTHANDLE; n>0 && fileinfo[n].stream!=NIL; n--);     /* Find an unused handle */
+  if (n == 0) {
+    brandynet_close(nethandle);
+    error(ERR_MAXHANDLE);
+  }
+  open_network(n, nethandle);
+  return n;
+}
+#endif
+
 /*
 ** 'fileio_openup' opens a file for both input and output
 */
@@ -196,11 +242,13 @@ int32 fileio_openup(char *name, int32 namelen) {
     for (n=FIRSTHANDLE; n>0 && fileinfo[n].stream!=NIL; n--);   /* Find an unused handle */
     handle=brandynet_connect(filename+4, filename[2], 1);
     if (handle == -1) return 0;
-    fileinfo[n].stream = (void *)42; /* Not used, but != NIL */
-    fileinfo[n].filetype = NETWORK;
-    fileinfo[n].eofstatus = OKAY;
-    fileinfo[n].lastwaswrite = FALSE;
-    fileinfo[n].nethandle = handle;
+    open_network(n, handle);
+    return n;
+  } else if (strncmp(filename, "listen0:", 8)==0 || strncmp(filename, "listen4:", 8)==0 || strncmp(filename, "listen6:", 8)==0) {
+    for (n=FIRSTHANDLE; n>0 && fileinfo[n].stream!=NIL; n--);   /* Find an unused handle */
+    handle=brandynet_listen(filename+8, filename[6], 1);
+    if (handle == -1) return 0;
+    open_network(n, handle);
     return n;
   } else {
 #endif
@@ -275,6 +323,7 @@ int32 fileio_bget(int32 handle) {
 
 #ifndef NONET
   if ((handle <= FIRSTHANDLE) && (fileinfo[handle].filetype == NETWORK)) {
+    if (net_listening(fileinfo[handle].nethandle)) return accept_connection(handle);
     ch=net_bget(fileinfo[handle].nethandle);
     if (ch == -2) {
       if (fileinfo[handle].eofstatus == PENDING) {
@@ -300,6 +349,7 @@ int32 fileio_bget(int32 handle) {
 #ifndef NONET
   }
 #endif
+  if (ch>=0) basicvars.stats.bytesread+=1;
   return ch;
 
 }
@@ -322,6 +372,26 @@ int32 fileio_getdol(int32 handle, char *buffer) {
   return length;
 }
 
+/*
+** 'fileio_getbulk' reads up to 'length' bytes from a file into 'buffer',
+** stopping early if the character 'delimiter' is found. The delimiter
+** is read but not stored. If 'delimiter' is -1, 'length' bytes are read
+** unless the end of the file is reached first. The function returns the
+** number of characters stored
+*/
+int32 fileio_getbulk(int32 handle, char *buffer, int32 length, int32 delimiter) {
+  int32 count = 0;
+  if (delimiter<0) return fileio_getblock(handle, buffer, length);
+  while (count<length) {
+    int32 ch = fileio_bget(handle);
+    if (ch==_kernel_ERROR) report();    /* Function returned -2 = SWI call failed */
+    if (ch==-1 || ch==delimiter) break;
+    buffer[count] = ch;
+    count++;
+  }
+  return count;
+}
+
 /*
 ** 'fileio_getnumber' reads a binary number from the file with
 ** handle 'handle'. It stores the result at the address given
@@ -424,6 +494,52 @@ int32 fileio_getstring(int32 handle, char *p) {
   return length;
 }
 
+/*
+** 'fileio_getblock' reads up to 'length' bytes from file 'handle' into
+** 'buffer' in one call. It returns the number of bytes read, which is
+** less than 'length' only if the end of the file was reached
+*/
+int32 fileio_getblock(int32 handle, char *buffer, int32 length) {
+  _kernel_oserror *oserror;
+  _kernel_swi_regs regs;
+  if (handle==0) {
+    error(ERR_BADHANDLE);
+    return 0;
+  }
+#ifndef NONET
+  if ((handle <= FIRSTHANDLE) && (fileinfo[handle].filetype==NETWORK)) {
+    error(ERR_NET_NOTSUPP);
+    return 0;
+  }
+#endif
+  regs.r[0] = 4;        /* OS_GBPB 4 = read from file at current file pointer position */
+  regs.r[1] = handle;
+  regs.r[2] = TOINT((int)buffer);
+  regs.r[3] = length;
+  oserror = _kernel_swi(OS_GBPB, &regs, &regs);
+  if (oserror!=NIL) {
+    error(ERR_CMDFAIL, oserror->errmess);
+    return 0;
+  }
+  basicvars.stats.bytesread+=length-regs.r[3];
+  return length-regs.r[3];
+}
+
+/*
+** 'put_floatbytes' and 'get_floatbytes' convert between floating point values
+** and the eight bytes used for them in files written by PRINT#. Under
+** RISC OS these are the bytes of the value in memory
+*/
+static void put_floatbytes(byte *p, float64 value) {
+  memmove(p, &value, sizeof(float64));
+}
+
+static float64 get_floatbytes(byte *p) {
+  float64 value;
+  memmove(&value, p, sizeof(float64));
+  return value;
+}
+
 /*
 ** 'fileio_bput' writes a character to a file
 */
@@ -446,6 +562,7 @@ void fileio_bput(int32 handle, int32 value) {
 #ifndef NONET
   }
 #endif
+  basicvars.stats.byteswritten+=1;
 }
 
 /*
@@ -476,6 +593,7 @@ void fileio_bputstr(int32 handle, char *string, int32 length) {
 #ifndef NONET
   }
 #endif
+  basicvars.stats.byteswritten+=length;
 }
 
 /*
@@ -595,6 +713,17 @@ int32 fileio_eof(int32 handle) {
   return result==0 ? FALSE : TRUE;
 }
 
+/*
+** 'network_handle' returns the network connection number of 'handle'
+** if it is a network connection or -1 if it is an ordinary file
+*/
+static int32 network_handle(int32 handle) {
+#ifndef NONET
+  if (handle != 0 && handle <= FIRSTHANDLE && fileinfo[handle].filetype == NETWORK) return fileinfo[handle].nethandle;
+#endif
+  return -1;
+}
+
 /*
 ** 'fileio_shutdown' is called at the end of the run of the
 ** interpreter. This is not required under RISC OS
@@ -641,10 +770,117 @@ void init_fileio(void) {
 */
 static int32 map_handle(int32 handle) {
   handle = FIRSTHANDLE-handle;
-  if (handle<0 || handle>=MAXFILES || fileinfo[handle].filetype==CLOSED) error(ERR_BADHANDLE);
+  if (handle<0 || handle>=FIRSTHANDLE || fileinfo[handle].filetype==CLOSED) error(ERR_BADHANDLE);
   return handle;
 }
 
+#ifndef NONET
+/*
+** 'open_network' sets up entry 'n' in 'fileinfo' for network
+** connection 'nethandle'
+*/
+static void open_network(int32 n, int nethandle) {
+  fileinfo[n].stream = (void *)42; /* Not used, but != NIL */
+  fileinfo[n].filetype = NETWORK;
+  fileinfo[n].eofstatus = OKAY;
+  fileinfo[n].lastwaswrite = FALSE;
+  fileinfo[n].nethandle = nethandle;
+}
+
+/*
+** 'accept_connection' accepts the next connection waiting on the
+** listening socket with index 'n' in 'fileinfo'. It returns the
+** handle for the new connection or -1 if there are none waiting
+*/
+static int32 accept_connection(int32 n) {
+  int nethandle = brandynet_accept(fileinfo[n].nethandle);
+  if (nethandle == -1) return -1;
+  for (n=0; n<FIRSTHANDLE && fileinfo[n].stream!=NIL; n++);     /* Find an unused handle */
+  if (n>=FIRSTHANDLE) {
+    brandynet_close(nethandle);
+    error(ERR_MAXHANDLE);
+  }
+  open_network(n, nethandle);
+  return FIRSTHANDLE-n;
+}
+#endif
+
+#ifdef USE_MMAP
+/*
+** 'map_file' maps the file with index 'n' in 'fileinfo' into memory if
+** it is an ordinary file at least 'matrixflags.mmapsize' bytes long.
+** Reads from the file then come straight from memory instead of going
+** through the C library a character at a time. Pipes, devices and small
+** files, or any file that cannot be mapped, are left to the C library
+*/
+static void map_file(int32 n) {
+  struct stat info;
+  void *base;
+
+  fileinfo[n].mapbase = NIL;
+  if (matrixflags.mmapsize==0) return;
+  if (fstat(fileno(fileinfo[n].stream), &info)!=0 || !S_ISREG(info.st_mode)) return;
+  if (info.st_size<matrixflags.mmapsize || CAST(CAST(info.st_size, size_t), off_t)!=info.st_size) return;
+  base = mmap(NIL, info.st_size, PROT_READ, MAP_SHARED, fileno(fileinfo[n].stream), 0);
+  if (base==MAP_FAILED) return;
+#ifdef MADV_SEQUENTIAL
+  madvise(base, info.st_size, MADV_SEQUENTIAL);
+#endif
+  fileinfo[n].mapbase = base;
+  fileinfo[n].mapsize = fileinfo[n].maplength = info.st_size;
+  fileinfo[n].mappos = 0;
+}
+
+/*
+** 'shrink_mapping' checks whether mapped file 'n' has been made shorter
+** since it was mapped and if so cuts down the part of the mapping that
+** is used to match, moving the file pointer back to the new end of the
+** file if it is now past it. Touching the pages beyond the end of the
+** file would raise SIGBUS. It returns TRUE if the file has shrunk
+*/
+static boolean shrink_mapping(int32 n) {
+  struct stat info;
+
+  if (fstat(fileno(fileinfo[n].stream), &info)!=0 || info.st_size>=CAST(fileinfo[n].mapsize, off_t)) return FALSE;
+  fileinfo[n].mapsize = info.st_size;
+  if (fileinfo[n].mappos>fileinfo[n].mapsize) fileinfo[n].mappos = fileinfo[n].mapsize;
+  return TRUE;
+}
+
+/*
+** 'remap_file' is called when the end of a mapped file has been reached.
+** If something has been added to the file since it was mapped, the
+** mapping is replaced with one that covers the whole of the file. If
+** the file has been made shorter, only what is left of it is used. The
+** function returns TRUE if there is now more of the file to read
+*/
+static boolean remap_file(int32 n) {
+  struct stat info;
+  void *base;
+
+  if (shrink_mapping(n)) return FALSE;
+  if (fstat(fileno(fileinfo[n].stream), &info)!=0 || info.st_size<=CAST(fileinfo[n].mapsize, off_t)) return FALSE;
+  if (CAST(CAST(info.st_size, size_t), off_t)!=info.st_size) return FALSE;
+  base = mmap(NIL, info.st_size, PROT_READ, MAP_SHARED, fileno(fileinfo[n].stream), 0);
+  if (base==MAP_FAILED) return FALSE;
+  munmap(fileinfo[n].mapbase, fileinfo[n].maplength);
+  fileinfo[n].mapbase = base;
+  fileinfo[n].mapsize = fileinfo[n].maplength = info.st_size;
+  return fileinfo[n].mappos<fileinfo[n].mapsize;
+}
+
+/*
+** 'mapped_avail' returns the number of bytes of a mapped file left
+** after the file pointer, checking whether the file has grown if
+** there are fewer than 'wanted'
+*/
+static size_t mapped_avail(int32 n, size_t wanted) {
+  fileblock *fp = &fileinfo[n];
+  if (fp->mappos>=fp->mapsize || fp->mapsize-fp->mappos<wanted) remap_file(n);
+  return fp->mappos<fp->mapsize ? fp->mapsize-fp->mappos : 0;
+}
+#endif
+
 /*
 ** 'fileio_openin' opens a file for input
 */
@@ -657,8 +893,8 @@ int32 fileio_openin(char *name, int32 namelen) {
     error(ERR_INVALIDFNAME);
     return 0;
   }
-  for (n=0; n<MAXFILES && fileinfo[n].stream!=NIL; n++);        /* Find an unused handle */
-  if (n>=MAXFILES) {
+  for (n=0; n<FIRSTHANDLE && fileinfo[n].stream!=NIL; n++);     /* Find an unused handle */
+  if (n>=FIRSTHANDLE) {
     error(ERR_MAXHANDLE);
     return 0;
   }
@@ -690,6 +926,9 @@ int32 fileio_openin(char *name, int32 namelen) {
   fileinfo[n].filetype = OPENIN;
   fileinfo[n].eofstatus = OKAY;
   fileinfo[n].lastwaswrite = FALSE;
+#ifdef USE_MMAP
+  map_file(n);
+#endif
   return FIRSTHANDLE-n;
 }
 
@@ -709,8 +948,8 @@ int32 fileio_openout(char *name, int32 namelen) {
     error(ERR_INVALIDFNAME);
     return 0;
   }
-  for (n=0; n<MAXFILES && fileinfo[n].stream!=NIL; n++);        /* Find an unused handle */
-  if (n>=MAXFILES) {
+  for (n=0; n<FIRSTHANDLE && fileinfo[n].stream!=NIL; n++);     /* Find an unused handle */
+  if (n>=FIRSTHANDLE) {
     error(ERR_MAXHANDLE);
     return 0;
   }
@@ -748,8 +987,8 @@ int32 fileio_openup(char *name, int32 namelen) {
     error(ERR_INVALIDFNAME);
     return 0;
   }
-  for (n=0; n<MAXFILES && fileinfo[n].stream!=NIL; n++);        /* Find an unused handle */
-  if (n>=MAXFILES) {
+  for (n=0; n<FIRSTHANDLE && fileinfo[n].stream!=NIL; n++);     /* Find an unused handle */
+  if (n>=FIRSTHANDLE) {
     error(ERR_MAXHANDLE);
     return 0;
   }
@@ -761,11 +1000,13 @@ int32 fileio_openup(char *name, int32 namelen) {
     int handle;
     handle=brandynet_connect(filename+4, filename[2], 1);
     if (handle == -1) return 0;
-    fileinfo[n].stream = (void *)42; /* Not used, but != NIL */
-    fileinfo[n].filetype = NETWORK;
-    fileinfo[n].eofstatus = OKAY;
-    fileinfo[n].lastwaswrite = FALSE;
-    fileinfo[n].nethandle = handle;
+    open_network(n, handle);
+    return FIRSTHANDLE-n;
+  } else if (!strncmp(filename, "listen0:", 8) || !strncmp(filename, "listen4:", 8) || !strncmp(filename, "listen6:", 8)) {
+    int handle;
+    handle=brandynet_listen(filename+8, filename[6], 1);
+    if (handle == -1) return 0;
+    open_network(n, handle);
     return FIRSTHANDLE-n;
   } else {
 #endif
@@ -804,13 +1045,19 @@ int32 fileio_openup(char *name, int32 namelen) {
 */
 static void close_file(int32 handle) {
 #ifndef NONET
-  if ((handle <= FIRSTHANDLE) && (fileinfo[handle].filetype == NETWORK)) {
+  if (fileinfo[handle].filetype == NETWORK) {
     brandynet_close(fileinfo[handle].nethandle);
     fileinfo[handle].stream = NIL;
     fileinfo[handle].filetype = CLOSED;
     fileinfo[handle].lastwaswrite = FALSE;
     fileinfo[handle].nethandle = -1;
   } else {
+#endif
+#ifdef USE_MMAP
+    if (fileinfo[handle].mapbase!=NIL) {
+      munmap(fileinfo[handle].mapbase, fileinfo[handle].maplength);
+      fileinfo[handle].mapbase = NIL;
+    }
 #endif
     fclose(fileinfo[handle].stream);
     fileinfo[handle].stream = NIL;
@@ -854,6 +1101,7 @@ int32 fileio_bget(int32 handle) {
   handle = map_handle(handle);
 #ifndef NONET
   if (fileinfo[handle].filetype == NETWORK) {
+    if (net_listening(fileinfo[handle].nethandle)) return accept_connection(handle);
     ch=net_bget(fileinfo[handle].nethandle);
     if (ch == -2) {
       if (fileinfo[handle].eofstatus == PENDING) {
@@ -864,6 +1112,9 @@ int32 fileio_bget(int32 handle) {
         fileinfo[handle].eofstatus = PENDING;
       }
     }
+    else if (ch>=0) {
+      basicvars.stats.bytesread+=1;
+    }
   } else {
 #endif
     if (fileinfo[handle].eofstatus!=OKAY) {     /* If EOF is pending, flag an error */
@@ -874,6 +1125,16 @@ int32 fileio_bget(int32 handle) {
     else if (fileinfo[handle].filetype==OPENOUT) {      /* If file is open for output, read one char */
       fileinfo[handle].eofstatus = PENDING;
     }
+#ifdef USE_MMAP
+    if (fileinfo[handle].mapbase!=NIL) {
+      if (mapped_avail(handle, 1)==0) {
+        fileinfo[handle].eofstatus = PENDING;
+        return 0;
+      }
+      basicvars.stats.bytesread+=1;
+      return fileinfo[handle].mapbase[fileinfo[handle].mappos++];
+    }
+#endif
     if (fileinfo[handle].lastwaswrite) {                /* Ensure everything has been written to disk first */
       fflush(fileinfo[handle].stream);
       fileinfo[handle].lastwaswrite = FALSE;
@@ -883,6 +1144,9 @@ int32 fileio_bget(int32 handle) {
       fileinfo[handle].eofstatus = PENDING;     /* If call returns 'EOF' set 'PENDING EOF' flag */
       ch = 0;
     }
+    else {
+      basicvars.stats.bytesread+=1;
+    }
     fileinfo[handle].lastwaswrite = FALSE;
 #ifndef NONET
   }
@@ -908,11 +1172,39 @@ int32 fileio_getdol(int32 handle, char *buffer) {
     return 0;
   }
   handle = map_handle(handle);
+#ifndef NONET
+  if (fileinfo[handle].filetype==NETWORK) {     /* Return what has arrived of the line */
+    length = net_getbulk(fileinfo[handle].nethandle, buffer, MAXSTRING-1, asc_LF);
+    if (length>0 && buffer[length-1]==asc_CR) length--;
+    return length;
+  }
+#endif
   if (fileinfo[handle].eofstatus!=OKAY) {       /* If EOF is pending or EOF, flag an error */
     fileinfo[handle].eofstatus = ATEOF;
     error(ERR_HITEOF);
     return 0;
   }
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) {  /* Find the end of the line in the mapped file */
+    size_t avail = mapped_avail(handle, MAXSTRING);
+    byte *start = fileinfo[handle].mapbase+fileinfo[handle].mappos;
+    if (avail==0) {
+      error(ERR_CANTREAD);
+      return 0;
+    }
+    if (avail>MAXSTRING-1) avail = MAXSTRING-1;
+    p = memchr(start, asc_LF, avail);
+    length = p!=NIL ? CAST(p, byte *)-start+1 : avail;
+    memmove(buffer, start, length);
+    fileinfo[handle].mappos+=length;
+    basicvars.stats.bytesread+=length;
+    if (p!=NIL) {       /* Remove the line end */
+      length--;
+      if (length>0 && buffer[length-1]==asc_CR) length--;
+    }
+    return length;
+  }
+#endif
   if (fileinfo[handle].lastwaswrite) {          /* Ensure everything has been written to disk first */
     fflush(fileinfo[handle].stream);
     fileinfo[handle].lastwaswrite = FALSE;
@@ -923,6 +1215,7 @@ int32 fileio_getdol(int32 handle, char *buffer) {
     return 0;
   }
   length = strlen(buffer);
+  basicvars.stats.bytesread+=length;
   p = buffer+length-1;  /* Point at line end character */
   if (*p==asc_LF) {     /* Got a 'linefeed' at the end of the line */
     length--;
@@ -931,10 +1224,95 @@ int32 fileio_getdol(int32 handle, char *buffer) {
   return length;
 }
 
-static int32 fileio_read(FILE *handle) {
+/*
+** 'fileio_getbulk' reads up to 'length' bytes from a file into 'buffer',
+** stopping early if the character 'delimiter' is found. The delimiter
+** is read but not stored. If 'delimiter' is -1, 'length' bytes are read
+** unless the end of the file is reached first. The function returns the
+** number of characters stored. Mapped files are searched for the
+** delimiter in memory, otherwise the C library's buffer is used
+*/
+int32 fileio_getbulk(int32 handle, char *buffer, int32 length, int32 delimiter) {
+  FILE *stream;
+  int32 count, ch;
+  boolean found = FALSE;
+
+  if (handle==0) {
+    error(ERR_BADHANDLE);
+    return 0;
+  }
+  handle = map_handle(handle);
+#ifndef NONET
+  if (fileinfo[handle].filetype==NETWORK) {
+    return net_getbulk(fileinfo[handle].nethandle, buffer, length, delimiter);
+  }
+#endif
+  if (fileinfo[handle].eofstatus!=OKAY) {       /* If EOF is pending or EOF, flag an error */
+    fileinfo[handle].eofstatus = ATEOF;
+    error(ERR_HITEOF);
+    return 0;
+  }
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) {
+    size_t avail = mapped_avail(handle, length);
+    byte *start = fileinfo[handle].mapbase+fileinfo[handle].mappos, *p;
+    count = avail<CAST(length, size_t) ? avail : length;
+    if (delimiter>=0) {
+      p = memchr(start, delimiter, count);
+      if (p!=NIL) {
+        count = p-start;
+        found = TRUE;
+      }
+    }
+    memmove(buffer, start, count);
+    fileinfo[handle].mappos+=count+found;
+    basicvars.stats.bytesread+=count+found;
+    if (!found && count<length) fileinfo[handle].eofstatus = PENDING;
+    return count;
+  }
+#endif
+  if (fileinfo[handle].lastwaswrite) {          /* Ensure everything has been written to disk first */
+    fflush(fileinfo[handle].stream);
+    fileinfo[handle].lastwaswrite = FALSE;
+  }
+  stream = fileinfo[handle].stream;
+  if (delimiter<0)
+    count = fread(buffer, sizeof(char), length, stream);
+  else {
+    for (count=0; count<length; count++) {
+      ch = GETCHAR(stream);
+      if (ch==EOF) break;
+      if (ch==delimiter) {
+        found = TRUE;
+        break;
+      }
+      buffer[count] = ch;
+    }
+  }
+  basicvars.stats.bytesread+=count+found;
+  if (!found && count<length) fileinfo[handle].eofstatus = PENDING;
+  return count;
+}
+
+/*
+** 'fileio_read' reads the next byte of a value written by PRINT# from
+** the file with index 'handle' in 'fileinfo'
+*/
+static int32 fileio_read(int32 handle) {
   int32 ch;
-  ch = fgetc(handle);
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) {
+    if (mapped_avail(handle, 1)==0) {
+      error(ERR_CANTREAD);
+      return 0;
+    }
+    basicvars.stats.bytesread+=1;
+    return fileinfo[handle].mapbase[fileinfo[handle].mappos++];
+  }
+#endif
+  ch = fgetc(fileinfo[handle].stream);
   if (ch==EOF) error(ERR_CANTREAD);
+  basicvars.stats.bytesread+=1;
   return ch;
 }
 
@@ -954,7 +1332,6 @@ static int32 fileio_read(FILE *handle) {
 ** byte floating point format
 */
 void fileio_getnumber(int32 handle, boolean *isint, int64 *ip, float64 *fp) {
-  FILE *stream;
   int32 n, marker;
   char temp[sizeof(float64)];
 
@@ -973,47 +1350,46 @@ void fileio_getnumber(int32 handle, boolean *isint, int64 *ip, float64 *fp) {
     fflush(fileinfo[handle].stream);
     fileinfo[handle].lastwaswrite = FALSE;
   }
-  stream = fileinfo[handle].stream;
-  marker = fileio_read(stream);
+  marker = fileio_read(handle);
   switch (marker) {
   case PRINT_INT:
     *ip = 0;
-    for (n=24; n>=0; n-=8) *ip |= fileio_read(stream) << n;
+    for (n=24; n>=0; n-=8) *ip |= fileio_read(handle) << n;
     *isint = TRUE;
     break;
   case PRINT_UINT8:
-    *ip = fileio_read(stream);
+    *ip = fileio_read(handle);
     *isint = TRUE;
     break;
   case PRINT_INT64:
     *ip = 0;
-    for (n=56; n>=0; n-=8) *ip |= (int64)fileio_read(stream) << n;
+    for (n=56; n>=0; n-=8) *ip |= (int64)fileio_read(handle) << n;
     *isint = TRUE;
     break;
   case PRINT_FLOAT:
     switch (double_type) {
     case XMIXED_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n] = fileio_read(handle);
       break;
     case XLITTLE_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n^4] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n^4] = fileio_read(handle);
       break;
     case XBIG_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n^3] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n^3] = fileio_read(handle);
       break;
     case XBIG_MIXED_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n^7] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n^7] = fileio_read(handle);
     }
     memmove(fp, temp, sizeof(float64));
     *isint = FALSE;
     break;
   case PRINT_FLOAT5: { /* Acorn's five byte format */
     int32 exponent;
-    int32 mantissa = fileio_read(stream);
-    mantissa |= fileio_read(stream) << 8;
-    mantissa |= fileio_read(stream) << 16;
-    mantissa |= fileio_read(stream) << 24;
-    exponent = fileio_read(stream);
+    int32 mantissa = fileio_read(handle);
+    mantissa |= fileio_read(handle) << 8;
+    mantissa |= fileio_read(handle) << 16;
+    mantissa |= fileio_read(handle) << 24;
+    exponent = fileio_read(handle);
     if (exponent || mantissa) {
       *fp = ((mantissa & 0x7FFFFFFF) / 4294967296.0 + 0.5)
             * pow (2, exponent - 0x80)
@@ -1039,7 +1415,6 @@ void fileio_getnumber(int32 handle, boolean *isint, int64 *ip, float64 *fp) {
 ** that is, the last character of the string is first.
 */
 int32 fileio_getstring(int32 handle, char *p) {
-  FILE *stream;
   int32 marker, length = 0, n;
 
   if (handle==0) {
@@ -1056,17 +1431,16 @@ int32 fileio_getstring(int32 handle, char *p) {
     fflush(fileinfo[handle].stream);
     fileinfo[handle].lastwaswrite = FALSE;
   }
-  stream = fileinfo[handle].stream;
-  marker = fileio_read(stream);
+  marker = fileio_read(handle);
   switch (marker) {
   case PRINT_SHORTSTR:  /* Reading short string in 'Acorn' format */
-    length = fileio_read(stream);
-    for (n=1; n<=length; n++) p[length-n] = fileio_read(stream);
+    length = fileio_read(handle);
+    for (n=1; n<=length; n++) p[length-n] = fileio_read(handle);
     break;
   case PRINT_LONGSTR:   /* Reading long string */
     length = 0;         /* Start by reading the string length (four bytes, little endian) */
-    for (n=0; n<sizeof(int32); n++) length+=fileio_read(stream)<<(n*BYTESHIFT);
-    for (n=0; n<length; n++) p[n] = fileio_read(stream);
+    for (n=0; n<sizeof(int32); n++) length+=fileio_read(handle)<<(n*BYTESHIFT);
+    for (n=0; n<length; n++) p[n] = fileio_read(handle);
     break;
   default:
     error(ERR_TYPESTR);
@@ -1074,10 +1448,102 @@ int32 fileio_getstring(int32 handle, char *p) {
   return length;
 }
 
+/*
+** 'fileio_getblock' reads up to 'length' bytes from file 'handle' into
+** 'buffer' in one call. It returns the number of bytes read, which is
+** less than 'length' only if the end of the file was reached
+*/
+int32 fileio_getblock(int32 handle, char *buffer, int32 length) {
+  int32 count;
+
+  if (handle==0) {
+    error(ERR_BADHANDLE);
+    return 0;
+  }
+  handle = map_handle(handle);
+#ifndef NONET
+  if (fileinfo[handle].filetype==NETWORK) {
+    error(ERR_NET_NOTSUPP);
+    return 0;
+  }
+#endif
+  if (fileinfo[handle].eofstatus!=OKAY) {       /* If EOF is pending or EOF, flag an error */
+    fileinfo[handle].eofstatus = ATEOF;
+    error(ERR_HITEOF);
+    return 0;
+  }
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) {
+    size_t avail = mapped_avail(handle, length);
+    count = avail<CAST(length, size_t) ? avail : length;
+    memmove(buffer, fileinfo[handle].mapbase+fileinfo[handle].mappos, count);
+    fileinfo[handle].mappos+=count;
+    if (count<length) fileinfo[handle].eofstatus = PENDING;
+    basicvars.stats.bytesread+=count;
+    return count;
+  }
+#endif
+  if (fileinfo[handle].lastwaswrite) {          /* Ensure everything has been written to disk first */
+    fflush(fileinfo[handle].stream);
+    fileinfo[handle].lastwaswrite = FALSE;
+  }
+  count = fread(buffer, sizeof(char), length, fileinfo[handle].stream);
+  if (count<length) fileinfo[handle].eofstatus = PENDING;
+  basicvars.stats.bytesread+=count;
+  return count;
+}
+
+/*
+** 'put_floatbytes' and 'get_floatbytes' convert between floating point values
+** and the eight bytes used for them in files written by PRINT#, which
+** are in the order used by the Acorn interpreter under RISC OS
+*/
+static void put_floatbytes(byte *p, float64 value) {
+  int32 n;
+  byte temp[sizeof(float64)];
+  memmove(temp, &value, sizeof(float64));
+  switch (double_type) {
+  case XMIXED_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) p[n] = temp[n];
+    break;
+  case XLITTLE_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) p[n] = temp[n^4];
+    break;
+  case XBIG_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) p[n] = temp[n^3];
+    break;
+  case XBIG_MIXED_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) p[n] = temp[n^7];
+  }
+}
+
+static float64 get_floatbytes(byte *p) {
+  int32 n;
+  float64 value;
+  byte temp[sizeof(float64)];
+  memset(temp, 0, sizeof(float64));
+  switch (double_type) {
+  case XMIXED_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) temp[n] = p[n];
+    break;
+  case XLITTLE_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) temp[n^4] = p[n];
+    break;
+  case XBIG_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) temp[n^3] = p[n];
+    break;
+  case XBIG_MIXED_ENDIAN:
+    for (n=0; n<sizeof(float64); n++) temp[n^7] = p[n];
+  }
+  memmove(&value, temp, sizeof(float64));
+  return value;
+}
+
 static void fileio_write(FILE *stream, int32 value) {
   int32 result;
   result = fputc(value, stream);
   if (result==EOF) error(ERR_CANTWRITE);
+  basicvars.stats.byteswritten+=1;
 }
 
 /*
@@ -1110,6 +1576,7 @@ void fileio_bput(int32 handle, int32 value) {
 #ifndef NONET
   }
 #endif
+  basicvars.stats.byteswritten+=1;
 }
 
 /*
@@ -1142,6 +1609,7 @@ void fileio_bputstr(int32 handle, char *string, int32 length) {
 #ifndef NONET
   }
 #endif
+  basicvars.stats.byteswritten+=length;
 }
 
 /*
@@ -1293,6 +1761,7 @@ void fileio_printstring(int32 handle, char *string, int32 length) {
       error(ERR_CANTWRITE);
       return;
     }
+    basicvars.stats.byteswritten+=length;
   }
   fileinfo[handle].lastwaswrite = TRUE;
 }
@@ -1308,6 +1777,17 @@ void fileio_setptr(int32 handle, int64 newoffset) {
     return;
   }
   handle = map_handle(handle);
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) {
+    if (newoffset<0 || CAST(CAST(newoffset, size_t), int64)!=newoffset) {
+      error(ERR_SETPTRFAIL);
+      return;
+    }
+    fileinfo[handle].mappos = newoffset;
+    fileinfo[handle].eofstatus = OKAY;
+    return;
+  }
+#endif
   result = fseek(fileinfo[handle].stream, newoffset, SEEK_SET);
   if (result==-1) {                             /* File pointer cannot be set */
     error(ERR_SETPTRFAIL);
@@ -1324,6 +1804,9 @@ int64 fileio_getptr(int32 handle) {
 
   if (handle==0) return 0; /* This is what happens on RISC OS 3.71 */
   handle = map_handle(handle);
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) return fileinfo[handle].mappos;
+#endif
   result = ftell(fileinfo[handle].stream);
   if (result==-1) error(ERR_GETPTRFAIL);        /* File pointer cannot be read */
   return result;
@@ -1341,6 +1824,12 @@ int64 fileio_getext(int32 handle) {
     return 0;
   }
   handle = map_handle(handle);
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) {
+    remap_file(handle);         /* Pick up anything added to the file */
+    return fileinfo[handle].mapsize;
+  }
+#endif
   stream = fileinfo[handle].stream;
   position = ftell(stream);
   if (position==-1) {
@@ -1392,6 +1881,9 @@ int32 fileio_eof(int32 handle) {
   if (fileinfo[handle].filetype == NETWORK) {
     return net_eof(fileinfo[handle].nethandle);
   } else {
+#endif
+#ifdef USE_MMAP
+  if (fileinfo[handle].mapbase!=NIL) return mapped_avail(handle, 1)==0;
 #endif
   stream = fileinfo[handle].stream;
   position = ftell(stream);
@@ -1405,6 +1897,18 @@ int32 fileio_eof(int32 handle) {
 #endif
 }
 
+/*
+** 'network_handle' returns the network connection number of 'handle'
+** if it is a network connection or -1 if it is an ordinary file
+*/
+static int32 network_handle(int32 handle) {
+  handle = map_handle(handle);
+#ifndef NONET
+  if (fileinfo[handle].filetype == NETWORK) return fileinfo[handle].nethandle;
+#endif
+  return -1;
+}
+
 /*
 ** 'fileio_shutdown' is called at the end of a run to ensure that
 ** all files opened by the program have been closed
@@ -1463,8 +1967,388 @@ void init_fileio(void) {
     fileinfo[n].stream = NIL;
     fileinfo[n].filetype = CLOSED;
     fileinfo[n].eofstatus = ATEOF;
+#ifdef USE_MMAP
+    fileinfo[n].mapbase = NIL;
+#endif
   }
   find_floatformat();
 }
 
 #endif
+
+/*
+** 'fileio_wait' waits until at least one of the 'count' files in the
+** list at 'block' is ready to be read from or written to, or until
+** 'timeout' centiseconds have passed (-1 = wait for as long as it
+** takes). Each entry in the list is a pair of words, the file's handle
+** and the events wanted (1 = data can be read, 2 = data can be written).
+** On return the second word of each pair says which of those are ready,
+** with 4 added if a network connection has been closed. Ordinary files
+** are always ready. The function returns the number of files that are
+** ready, which is zero if the time ran out or Escape was pressed
+*/
+int32 fileio_wait(int32 *block, int32 count, int32 timeout) {
+  int32 n, ready = 0;
+#ifndef NONET
+  int nethandles[MAXFILES];
+  int32 netevents[MAXFILES], netslot[MAXFILES];
+  int32 netcount = 0;
+#endif
+
+  if (count < 0 || count > MAXFILES) error(ERR_RANGE);
+  for (n = 0; n < count; n++) {
+    int32 nethandle = network_handle(block[2*n]);
+    block[2*n+1] &= NET_READABLE | NET_WRITABLE;
+    if (nethandle >= 0) {
+#ifndef NONET
+      nethandles[netcount] = nethandle;
+      netevents[netcount] = block[2*n+1];
+      netslot[netcount] = n;
+      netcount++;
+      block[2*n+1] = 0;
+#endif
+      continue;
+    }
+    if (block[2*n+1] != 0) ready++;
+  }
+#ifndef NONET
+  if (netcount > 0) {
+    if (net_wait(nethandles, netevents, netcount, ready > 0 ? 0 : timeout) < 0) error(ERR_NET_NOTSUPP);
+    for (n = 0; n < netcount; n++) {
+      block[2*netslot[n]+1] = netevents[n];
+      if (netevents[n] != 0) ready++;
+    }
+  }
+#endif
+  return ready;
+}
+
+/*
+** 'fileio_shrunk' is called when the interpreter receives SIGBUS. This
+** happens when a file that has been mapped into memory is made shorter
+** while it is being read and the part of it that has gone is touched.
+** The function fixes up any mapped files that have shrunk and returns
+** TRUE if there were any, so that the error can be reported as one
+** reading the file. It has to be safe to call from a signal handler
+*/
+boolean fileio_shrunk(void) {
+  boolean shrunk = FALSE;
+#ifdef USE_MMAP
+  int32 n;
+  for (n=0; n<MAXFILES; n++) {
+    if (fileinfo[n].stream!=NIL && fileinfo[n].filetype!=NETWORK && fileinfo[n].mapbase!=NIL && shrink_mapping(n)) shrunk = TRUE;
+  }
+#endif
+  return shrunk;
+}
+
+/* ================================================================= */
+/* ================== Whole array transfer functions =============== */
+/* ================================================================= */
+
+/*
+** Whole arrays are written and read a block at a time using a buffer
+** big enough to hold the longest string that can be written. Values go
+** through the buffer in the same format that PRINT# and INPUT# use for
+** single values so that files can be read either way. When reading,
+** no more is read from the file than the rest of the array could take
+** up at the least (two bytes for each value), so the file is never read
+** beyond the end of the array's values. 'fileio_bputarray' and
+** 'fileio_bgetarray' transfer the values as they are held in memory
+*/
+#define ARRAYBUFSIZE (2*MAXSTRING)      /* Size of the buffer */
+#define MINVALUESIZE 2                  /* Smallest number of bytes a value can take in a file */
+
+static byte *arraybuffer;               /* Buffer used for array transfers */
+
+static byte *get_arraybuffer(void) {
+  if (arraybuffer==NIL) {
+    arraybuffer = malloc(ARRAYBUFSIZE);
+    if (arraybuffer==NIL) error(ERR_NOROOM);
+  }
+  return arraybuffer;
+}
+
+/*
+** 'fileio_printarray' writes the values in the array 'ap' to a file in
+** the format used by PRINT#. 'type' is the type of the array's elements
+*/
+void fileio_printarray(int32 handle, basicarray *ap, int32 type) {
+  byte *buffer, *p;
+  int32 n, m, length, size;
+  uint64 value;
+
+  buffer = p = get_arraybuffer();
+  for (n=0; n<ap->arrsize; n++) {
+    length = type==VAR_STRINGDOL ? ap->arraystart.stringbase[n].stringlen : 0;
+    switch (type) {     /* Work out how many bytes the value takes in the file */
+    case VAR_UINT8: size = 1+sizeof(uint8); break;
+    case VAR_INTWORD: size = 1+sizeof(int32); break;
+    case VAR_INTLONG: size = 1+sizeof(int64); break;
+    case VAR_FLOAT: size = 1+sizeof(float64); break;
+    default: size = length<SHORT_STRING ? 2+length : 1+sizeof(int32)+length;
+    }
+    if (p-buffer+size>ARRAYBUFSIZE) {   /* Buffer full - Write it out */
+      fileio_bputstr(handle, CAST(buffer, char *), p-buffer);
+      p = buffer;
+    }
+    switch (type) {
+    case VAR_INTWORD:
+      value = CAST(ap->arraystart.intbase[n], uint32);
+      *p++ = PRINT_INT;
+      for (m=24; m>=0; m-=8) *p++ = value>>m;
+      break;
+    case VAR_UINT8:
+      *p++ = PRINT_UINT8;
+      *p++ = ap->arraystart.uint8base[n];
+      break;
+    case VAR_INTLONG:
+      value = ap->arraystart.int64base[n];
+      *p++ = PRINT_INT64;
+      for (m=56; m>=0; m-=8) *p++ = value>>m;
+      break;
+    case VAR_FLOAT:
+      *p++ = PRINT_FLOAT;
+      put_floatbytes(p, ap->arraystart.floatbase[n]);
+      p+=sizeof(float64);
+      break;
+    default: {          /* String - Acorn format if short, the interpreter's if long */
+      char *cp = ap->arraystart.stringbase[n].stringaddr;
+      if (length<SHORT_STRING) {
+        *p++ = PRINT_SHORTSTR;
+        *p++ = length;
+        for (m=length-1; m>=0; m--) *p++ = cp[m];
+      }
+      else {
+        *p++ = PRINT_LONGSTR;
+        for (m=0; m<sizeof(int32); m++) *p++ = length>>(m*BYTESHIFT);
+        memmove(p, cp, length);
+        p+=length;
+      }
+    }
+    }
+  }
+  if (p>buffer) fileio_bputstr(handle, CAST(buffer, char *), p-buffer);
+}
+
+/*
+** 'fill_arraybuffer' makes sure that there are at least 'needed' bytes
+** in the array buffer after 'pos', reading more from the file if there
+** are not. 'remaining' is the number of values still to be read after
+** the one the bytes are needed for
+*/
+static void fill_arraybuffer(int32 handle, int32 *pos, int32 *have, int32 needed, int32 remaining) {
+  int32 count, want, avail = *have-*pos;
+  if (avail>=needed) return;
+  if (*pos>0) {         /* Move what is left to the start of the buffer */
+    memmove(arraybuffer, arraybuffer+*pos, avail);
+    *pos = 0;
+    *have = avail;
+  }
+  while (*have<needed) {
+    want = needed-*have+remaining*MINVALUESIZE;
+    if (want>ARRAYBUFSIZE-*have) want = ARRAYBUFSIZE-*have;
+    count = fileio_getblock(handle, CAST(arraybuffer+*have, char *), want);
+    if (count==0) error(ERR_HITEOF);
+    *have+=count;
+  }
+}
+
+/*
+** 'fileio_inputarray' fills the array 'ap' with values read from a file
+** written by PRINT#. Numbers are converted to the type of the array's
+** elements, 'type', as INPUT# does
+*/
+void fileio_inputarray(int32 handle, basicarray *ap, int32 type) {
+  byte *p;
+  int32 n, m, pos, have, length, remaining;
+  boolean isint;
+  int64 intvalue = 0;
+  float64 floatvalue = 0.0;
+
+  get_arraybuffer();
+  pos = have = 0;
+  for (n=0; n<ap->arrsize; n++) {
+    remaining = ap->arrsize-n-1;
+    fill_arraybuffer(handle, &pos, &have, MINVALUESIZE, remaining);
+    p = arraybuffer+pos;
+    if (type==VAR_STRINGDOL) {
+      basicstring *sp = &ap->arraystart.stringbase[n];
+      char *cp;
+      boolean isshort = *p==PRINT_SHORTSTR;
+      if (isshort) {
+        length = p[1];
+        fill_arraybuffer(handle, &pos, &have, 2+length, remaining);
+        p = arraybuffer+pos+2;
+      }
+      else if (*p==PRINT_LONGSTR) {
+        fill_arraybuffer(handle, &pos, &have, 1+sizeof(int32), remaining);
+        p = arraybuffer+pos+1;
+        length = 0;
+        for (m=0; m<sizeof(int32); m++) length+=p[m]<<(m*BYTESHIFT);
+        if (length<0 || length>MAXSTRING) error(ERR_STRINGLEN);
+        fill_arraybuffer(handle, &pos, &have, 1+sizeof(int32)+length, remaining);
+        p = arraybuffer+pos+1+sizeof(int32);
+      }
+      else {
+        error(ERR_TYPESTR);
+        return;
+      }
+      free_string(*sp);
+      cp = alloc_string(length);
+      if (isshort)
+        for (m=1; m<=length; m++) cp[length-m] = p[m-1];
+      else if (length>0) {
+        memmove(cp, p, length);
+      }
+      sp->stringlen = length;
+      sp->stringaddr = cp;
+      pos = p+length-arraybuffer;
+      continue;
+    }
+    isint = TRUE;
+    switch (*p) {
+    case PRINT_INT:
+      fill_arraybuffer(handle, &pos, &have, 1+sizeof(int32), remaining);
+      p = arraybuffer+pos+1;
+      intvalue = CAST((CAST(p[0], uint32)<<24) | (p[1]<<16) | (p[2]<<8) | p[3], int32);
+      p+=sizeof(int32);
+      break;
+    case PRINT_UINT8:
+      intvalue = p[1];
+      p+=2;
+      break;
+    case PRINT_INT64:
+      fill_arraybuffer(handle, &pos, &have, 1+sizeof(int64), remaining);
+      p = arraybuffer+pos+1;
+      intvalue = 0;
+      for (m=0; m<sizeof(int64); m++) intvalue = (intvalue<<8) | p[m];
+      p+=sizeof(int64);
+      break;
+    case PRINT_FLOAT:
+      fill_arraybuffer(handle, &pos, &have, 1+sizeof(float64), remaining);
+      p = arraybuffer+pos+1;
+      floatvalue = get_floatbytes(p);
+      isint = FALSE;
+      p+=sizeof(float64);
+      break;
+    case PRINT_FLOAT5: {        /* Acorn's five byte format */
+      int32 exponent, mantissa;
+      fill_arraybuffer(handle, &pos, &have, 6, remaining);
+      p = arraybuffer+pos+1;
+      mantissa = p[0] | (p[1]<<8) | (p[2]<<16) | (CAST(p[3], uint32)<<24);
+      exponent = p[4];
+      if (exponent || mantissa)
+        floatvalue = ((mantissa & 0x7FFFFFFF) / 4294967296.0 + 0.5) * pow(2, exponent - 0x80) * (mantissa < 0 ? -1 : 1);
+      else {
+        floatvalue = 0;
+      }
+      isint = FALSE;
+      p+=5;
+      break;
+    }
+    default:
+      error(ERR_TYPENUM);
+      return;
+    }
+    pos = p-arraybuffer;
+    switch (type) {
+    case VAR_INTWORD:
+      ap->arraystart.intbase[n] = isint ? intvalue : TOINT(floatvalue);
+      break;
+    case VAR_UINT8:
+      ap->arraystart.uint8base[n] = isint ? intvalue : TOINT(floatvalue);
+      break;
+    case VAR_INTLONG:
+      ap->arraystart.int64base[n] = isint ? intvalue : TOINT64(floatvalue);
+      break;
+    default:
+      ap->arraystart.floatbase[n] = isint ? TOFLOAT(intvalue) : floatvalue;
+    }
+  }
+}
+
+/*
+** 'array_bytes' returns the size in bytes of the elements of array 'ap'
+** if they are numbers
+*/
+static size_t array_bytes(basicarray *ap, int32 type) {
+  switch (type) {
+  case VAR_INTWORD: return ap->arrsize*sizeof(int32);
+  case VAR_UINT8:   return ap->arrsize*sizeof(uint8);
+  case VAR_INTLONG: return ap->arrsize*sizeof(int64);
+  default:          return ap->arrsize*sizeof(float64);
+  }
+}
+
+/*
+** 'fileio_bputarray' writes the values in array 'ap' to a file as they
+** are held in memory. Each string is written as its length in four
+** bytes, least significant byte first, followed by its characters, so
+** that strings containing any character can be read back
+*/
+void fileio_bputarray(int32 handle, basicarray *ap, int32 type) {
+  int32 n, m, length;
+  byte *buffer, *p;
+
+  if (type!=VAR_STRINGDOL) {
+    size_t size = array_bytes(ap, type);
+    char *cp = ap->arraystart.arraybase;
+    while (size>0) {
+      length = size>ARRAYBUFSIZE ? ARRAYBUFSIZE : size;
+      fileio_bputstr(handle, cp, length);
+      cp+=length;
+      size-=length;
+    }
+    return;
+  }
+  buffer = p = get_arraybuffer();
+  for (n=0; n<ap->arrsize; n++) {
+    length = ap->arraystart.stringbase[n].stringlen;
+    if (p-buffer+sizeof(int32)+length>ARRAYBUFSIZE) {
+      fileio_bputstr(handle, CAST(buffer, char *), p-buffer);
+      p = buffer;
+    }
+    for (m=0; m<sizeof(int32); m++) *p++ = length>>(m*BYTESHIFT);
+    memmove(p, ap->arraystart.stringbase[n].stringaddr, length);
+    p+=length;
+  }
+  if (p>buffer) fileio_bputstr(handle, CAST(buffer, char *), p-buffer);
+}
+
+/*
+** 'fileio_bgetarray' fills array 'ap' with bytes read from a file as
+** written by 'fileio_bputarray'. Each string is read as its four byte
+** length followed by its characters
+*/
+void fileio_bgetarray(int32 handle, basicarray *ap, int32 type) {
+  int32 n, m, length, count;
+  byte lenbytes[sizeof(int32)];
+  char *cp;
+
+  if (type!=VAR_STRINGDOL) {
+    size_t size = array_bytes(ap, type);
+    cp = ap->arraystart.arraybase;
+    while (size>0) {
+      length = size>ARRAYBUFSIZE ? ARRAYBUFSIZE : size;
+      count = fileio_getblock(handle, cp, length);
+      if (count<length) error(ERR_HITEOF);
+      cp+=length;
+      size-=length;
+    }
+    return;
+  }
+  for (n=0; n<ap->arrsize; n++) {
+    basicstring *sp = &ap->arraystart.stringbase[n];
+    if (fileio_getblock(handle, CAST(lenbytes, char *), sizeof(int32))<sizeof(int32)) error(ERR_HITEOF);
+    length = 0;
+    for (m=0; m<sizeof(int32); m++) length+=CAST(lenbytes[m], uint32)<<(m*BYTESHIFT);
+    if (length<0 || length>MAXSTRING) error(ERR_STRINGLEN);
+    if (length>0 && fileio_getblock(handle, basicvars.stringwork, length)<length) error(ERR_HITEOF);
+    free_string(*sp);
+    cp = alloc_string(length);
+    if (length>0) memmove(cp, basicvars.stringwork, length);
+    sp->stringlen = length;
+    sp->stringaddr = cp;
+  }
+}
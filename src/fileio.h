@@ -36,6 +36,8 @@ extern int32 fileio_bget(int32);
 extern int32 fileio_getdol(int32, char *);
 extern void fileio_getnumber(int32, boolean *, int64 *, float64 *);
 extern int32 fileio_getstring(int32, char *);
+extern int32 fileio_getblock(int32, char *, int32);
+extern int32 fileio_getbulk(int32, char *, int32, int32);
 extern void fileio_bput(int32, int32);
 extern void fileio_bputstr(int32, char *, int32);
 extern void fileio_printint(int32, int32);
@@ -43,7 +45,13 @@ extern void fileio_printuint8(int32, uint8);
 extern void fileio_printint64(int32, int64);
 extern void fileio_printfloat(int32, float64);
 extern void fileio_printstring(int32, char *, int32);
+extern void fileio_printarray(int32, basicarray *, int32);
+extern void fileio_inputarray(int32, basicarray *, int32);
+extern void fileio_bputarray(int32, basicarray *, int32);
+extern void fileio_bgetarray(int32, basicarray *, int32);
 extern int32 fileio_eof(int32);
+extern int32 fileio_wait(int32 *, int32, int32);
+extern boolean fileio_shrunk(void);
 extern int64 fileio_getptr(int32);
 extern void fileio_setptr(int32, int64);
 extern int64 fileio_getext(int32);
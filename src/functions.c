@@ -83,6 +83,28 @@ static int32 lastrandom;                /* 32-bit pseudo-random number generator
 static int32 randomoverflow;            /* 1-bit overflow from pseudo-random number generator */
 static float64 floatvalue;              /* Temporary for holding floating point values */
 
+/*
+** The EVAL cache holds the tokenised versions of the strings most
+** recently passed to EVAL. It is direct mapped, indexed by a hash of
+** the string. The tokens are written back after each evaluation so that
+** the addresses of variables found when the expression was evaluated
+** are kept. The cache is emptied whenever the variables are cleared
+*/
+#define EVALCACHESIZE 512               /* Number of entries in the EVAL cache (must be a power of 2) */
+#define EVALMAXLEN 255                  /* Longest string that is cached */
+
+typedef struct {
+  char *evalsource;                     /* Copy of the string, followed by its tokenised form */
+  byte *evaltokens;                     /* Tokenised version of the string */
+  int32 evallen;                        /* Length of the string */
+  uint32 evalhash;                      /* Hash of the string */
+  uint32 evalgen;                       /* Number of the entry, to detect when it has been replaced */
+} evalentry;
+
+static evalentry evalcache[EVALCACHESIZE];
+static uint32 evalgeneration;           /* Number given to the last entry added to the cache */
+static int32 evalcount;                 /* Number of entries in use */
+
 /*
 ** 'bad_token' is called to report a bad token value. This could mean
 ** two things: either the program has been corrupted or there is a bug
@@ -884,6 +906,67 @@ static void fn_err(void) {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** 'eval_hash' returns the hash value used for the EVAL cache for
+** the string at 'sp' of length 'len'
+*/
+static uint32 eval_hash(char *sp, int32 len) {
+  uint32 h = 2166136261u;
+  while (len>0) {
+    h = (h ^ CAST(*sp, byte))*16777619u;
+    sp++;
+    len--;
+  }
+  return h;
+}
+
+/*
+** 'clear_evalcache' empties the EVAL cache. It is called whenever the
+** variables are cleared as the cached tokens can refer to them
+*/
+void clear_evalcache(void) {
+  int32 n;
+  DEBUGFUNCMSGIN;
+  if (evalcount!=0) {
+    for (n=0; n<EVALCACHESIZE; n++) {
+      if (evalcache[n].evalsource!=NIL) {
+        free(evalcache[n].evalsource);
+        evalcache[n].evalsource = NIL;
+        evalcache[n].evalgen = 0;
+      }
+    }
+    evalcount = 0;
+  }
+  DEBUGFUNCMSGOUT;
+}
+
+/*
+** 'add_eval' adds the string at 'sp' of length 'len' and its
+** tokenised form, 'tokens', to the EVAL cache in slot 'ep', replacing
+** whatever was there. It returns the number given to the entry or
+** zero if the string could not be cached
+*/
+static uint32 add_eval(evalentry *ep, uint32 hash, char *sp, int32 len, byte *tokens) {
+  int32 toklen = GET_LINELEN(tokens);
+  char *cp = malloc(len+toklen);
+  if (cp==NIL) return 0;
+  if (ep->evalsource!=NIL)
+    free(ep->evalsource);
+  else {
+    evalcount++;
+  }
+  memcpy(cp, sp, len);
+  memcpy(cp+len, tokens, toklen);
+  ep->evalsource = cp;
+  ep->evaltokens = CAST(cp+len, byte *);
+  ep->evallen = len;
+  ep->evalhash = hash;
+  evalgeneration++;
+  if (evalgeneration==0) evalgeneration = 1;
+  ep->evalgen = evalgeneration;
+  return evalgeneration;
+}
+
 /*
 ** 'fn_eval' deals with the function 'eval'
 ** The argument of the function is tokenized and stored in
@@ -892,11 +975,17 @@ static void fn_err(void) {
 ** error occurs in the expression being evaluated as the
 ** current will not be pointing into the Basic program. I
 ** think the value should be saved on the Basic stack.
+** Strings that have been seen before are found in the EVAL
+** cache instead of being tokenised again. The expression is
+** evaluated from a copy of the cached tokens as EVAL can be
+** called recursively
 */
 static void fn_eval(void) {
   stackitem stringtype;
   basicstring descriptor;
   byte evalexpr[MAXSTATELEN];
+  evalentry *ep;
+  uint32 hash = 0, gen;
 
   DEBUGFUNCMSGIN;
   (*factor_table[*basicvars.current])();
@@ -907,10 +996,25 @@ static void fn_eval(void) {
     return;
   }
   descriptor = pop_string();
-  memmove(basicvars.stringwork, descriptor.stringaddr, descriptor.stringlen);
-  basicvars.stringwork[descriptor.stringlen] = asc_NUL; /* Now have a null-terminated version of string */
+  basicvars.stats.evals+=1;
+  ep = NIL;
+  gen = 0;
+  if (descriptor.stringlen<=EVALMAXLEN) {
+    hash = eval_hash(descriptor.stringaddr, descriptor.stringlen);
+    ep = &evalcache[hash & (EVALCACHESIZE-1)];
+    if (ep->evalsource!=NIL && ep->evalhash==hash && ep->evallen==descriptor.stringlen
+     && memcmp(ep->evalsource, descriptor.stringaddr, descriptor.stringlen)==0) {
+      memcpy(evalexpr, ep->evaltokens, GET_LINELEN(ep->evaltokens));
+      gen = ep->evalgen;
+    }
+  }
+  if (gen==0) {         /* Not in the cache */
+    memmove(basicvars.stringwork, descriptor.stringaddr, descriptor.stringlen);
+    basicvars.stringwork[descriptor.stringlen] = asc_NUL; /* Now have a null-terminated version of string */
+    tokenize(basicvars.stringwork, evalexpr, NOLINE, FALSE);    /* 'tokenise' leaves its results in 'thisline' */
+    if (ep!=NIL) gen = add_eval(ep, hash, descriptor.stringaddr, descriptor.stringlen, evalexpr);
+  }
   if (stringtype == STACK_STRTEMP) free_string(descriptor);
-  tokenize(basicvars.stringwork, evalexpr, NOLINE, FALSE);      /* 'tokenise' leaves its results in 'thisline' */
   save_current();               /* Save pointer to current position in expression */
   basicvars.current = FIND_EXEC(evalexpr);
   expression();
@@ -920,6 +1024,7 @@ static void fn_eval(void) {
     return;
   }
   restore_current();
+  if (gen!=0 && ep->evalgen==gen) memcpy(ep->evaltokens, evalexpr, GET_LINELEN(evalexpr));     /* Keep variable addresses */
   DEBUGFUNCMSGOUT;
 }
 
@@ -1010,7 +1115,33 @@ static void fn_getdol(void) {
   } else if (*basicvars.current == '#') {       /* Have encountered the 'GET$#' version */
     basicvars.current++;
     handle = eval_intfactor();
-    count = fileio_getdol(handle, basicvars.stringwork);
+    if (*basicvars.current == BASTOKEN_BY || *basicvars.current == BASTOKEN_TO) {
+      int32 length = MAXSTRING, delimiter = -1;       /* 'GET$#<handle> BY <count> TO <char>' */
+      do {
+        if (*basicvars.current == BASTOKEN_BY) {
+          basicvars.current++;
+          length = eval_intfactor();
+          if (length<0 || length>MAXSTRING) {
+            DEBUGFUNCMSGOUT;
+            error(ERR_STRINGLEN);
+            return;
+          }
+        }
+        else {
+          basicvars.current++;
+          delimiter = eval_intfactor();
+          if (delimiter<0 || delimiter>255) {
+            DEBUGFUNCMSGOUT;
+            error(ERR_RANGE);
+            return;
+          }
+        }
+      } while (*basicvars.current == BASTOKEN_BY || *basicvars.current == BASTOKEN_TO);
+      count = fileio_getbulk(handle, basicvars.stringwork, length, delimiter);
+    }
+    else {
+      count = fileio_getdol(handle, basicvars.stringwork);
+    }
     cp = alloc_string(count);
     memcpy(cp, basicvars.stringwork, count);
     push_strtemp(count, cp);
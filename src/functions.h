@@ -28,6 +28,7 @@
 
 extern void exec_function(void);
 extern void init_functions(void);
+extern void clear_evalcache(void);
 
 /*
 ** The following functions are invoked from the factor function
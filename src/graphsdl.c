@@ -142,6 +142,18 @@ static SDL_Rect font_rect, place_rect, line_rect, scale_rect;
 static SDL_Rect scroll_rect;
 #endif
 
+/*
+** Areas of the display surface changed since the video update thread
+** last updated the window. 'dirtyall' is set when the whole window
+** has to be updated
+*/
+#define MAXDIRTYRECTS 32
+
+static SDL_Rect dirtyrects[MAXDIRTYRECTS];
+static int dirtycount;
+static boolean dirtyall;
+static SDL_mutex *dirtylock;
+
 static Uint8 palette[768];              /* palette for screen */
 static Uint8 hardpalette[48]            /* palette for screen */
        = { 0, 0,  0,  255,0,  0,  0,255,  0,  255,255,  0, /* Black, Red, Green, Yellow */
@@ -249,6 +261,7 @@ static void scroll_yneg(int32 windowed);
 static void reveal_cursor(void);
 #ifndef BRANDY_MODE7ONLY
 static void plot_pixel(SDL_Surface *, int32, int32, Uint32, Uint32);
+static void draw_h_line(SDL_Surface *, int32, int32, int32, Uint32, Uint32);
 static void draw_line(SDL_Surface *, int32, int32, int32, int32, Uint32, int32, Uint32);
 static void filled_triangle(SDL_Surface *, int32, int32, int32, int32, int32, int32, Uint32, Uint32);
 static void draw_ellipse(SDL_Surface *, int32, int32, int32, int32, int32, Uint32, Uint32, Uint32);
@@ -290,7 +303,7 @@ void add_mouseitem(int x, int y, int b, int64 c) {
   m->x = x;
   m->y = y;
   m->buttons = b;
-  m->timestamp = basicvars.centiseconds;
+  m->timestamp = mos_centiseconds();
   m->next=NULL;
 
   if (mousebuffer == NULL) {
@@ -324,7 +337,7 @@ static void drain_mouse_expired() {
   mousequeue *p;
   if (mouseqexpire == 0) return;
   while (mousebuffer != NULL) {
-    if ((mousebuffer->timestamp + mouseqexpire) > basicvars.centiseconds) break;
+    if ((mousebuffer->timestamp + mouseqexpire) > mos_centiseconds()) break;
     p=mousebuffer->next;
     free(mousebuffer);
     mousebuffer=p;
@@ -587,6 +600,14 @@ void find_cursor(void) {
   return;
 }
 
+/*
+** 'flush_screen' makes sure that all output has been written.
+** The SDL display is updated by its own thread so this is a no-op.
+*/
+void flush_screen(void) {
+  return;
+}
+
 static void set_rgb(void) {
   int j;
   if (colourdepth == COL24BIT) {
@@ -817,6 +838,88 @@ static void reveal_cursor() {
   if (cursorstate==SUSPENDED) toggle_cursor();
 }
 
+/*
+** 'mark_dirty' notes that the rectangle (left, top) to (right, bottom)
+** of the display surface has changed and has to be sent to the window
+** on the next update. The coordinates are real pixel coordinates on
+** the display surface, that is, after scaling. A rectangle that lies
+** inside one already on the list is dropped, and if the list fills up
+** it is replaced by a single rectangle covering everything on it
+*/
+static void mark_dirty(int32 left, int32 top, int32 right, int32 bottom) {
+  int n;
+  SDL_Rect *rp;
+
+  if (!matrixflags.surface) return;
+  if (left < 0) left = 0;
+  if (top < 0) top = 0;
+  if (right >= matrixflags.surface->w) right = matrixflags.surface->w-1;
+  if (bottom >= matrixflags.surface->h) bottom = matrixflags.surface->h-1;
+  if (left > right || top > bottom) return;
+  SDL_LockMutex(dirtylock);
+  if (!dirtyall) {
+    for (n = 0; n < dirtycount; n++) {
+      rp = &dirtyrects[n];
+      if (left >= rp->x && right < rp->x+rp->w && top >= rp->y && bottom < rp->y+rp->h) break;
+    }
+    if (n == dirtycount) {
+      if (dirtycount == MAXDIRTYRECTS) {       /* List is full - merge it all into one rectangle */
+        for (n = 0; n < dirtycount; n++) {
+          rp = &dirtyrects[n];
+          if (rp->x < left) left = rp->x;
+          if (rp->y < top) top = rp->y;
+          if (rp->x+rp->w-1 > right) right = rp->x+rp->w-1;
+          if (rp->y+rp->h-1 > bottom) bottom = rp->y+rp->h-1;
+        }
+        dirtycount = 0;
+      }
+      rp = &dirtyrects[dirtycount++];
+      rp->x = left;
+      rp->y = top;
+      rp->w = right-left+1;
+      rp->h = bottom-top+1;
+    }
+  }
+  SDL_UnlockMutex(dirtylock);
+}
+
+/*
+** 'mark_dirty_all' is used when the whole of the display surface has
+** been changed
+*/
+static void mark_dirty_all(void) {
+  SDL_LockMutex(dirtylock);
+  dirtyall = TRUE;
+  dirtycount = 0;
+  SDL_UnlockMutex(dirtylock);
+}
+
+/*
+** 'update_dirty' sends the parts of the display surface that have
+** changed to the window. Nothing is done if the screen has not been
+** written to since the last call. A display that really has two
+** pages has to be flipped in full
+*/
+static void update_dirty(void) {
+  SDL_Rect rects[MAXDIRTYRECTS];
+  int count;
+  boolean all;
+
+  SDL_LockMutex(dirtylock);
+  count = dirtycount;
+  all = dirtyall;
+  memcpy(rects, dirtyrects, count*sizeof(SDL_Rect));
+  dirtycount = 0;
+  dirtyall = FALSE;
+  SDL_UnlockMutex(dirtylock);
+  if ((matrixflags.surface->flags & SDL_DOUBLEBUF) == SDL_DOUBLEBUF)
+    SDL_Flip(matrixflags.surface);
+  else if (all)
+    SDL_UpdateRect(matrixflags.surface, 0, 0, 0, 0);
+  else if (count > 0)
+    SDL_UpdateRects(matrixflags.surface, count, rects);
+}
+
 /*
 ** 'toggle_cursor' draws the text cursor at the current text position
 ** in graphics modes.
@@ -856,6 +959,8 @@ static void toggle_cursor(void) {
   cursorstate = (cursorstate == ONSCREEN) ? SUSPENDED : ONSCREEN;       /* Toggle the cursor state */
   left = xtemp*ds.xscale*mxppc;                                 /* Calculate pixel coordinates of ends of cursor */
   right = left + ds.xscale*mxppc -1;
+  mark_dirty(left*matrixflags.videoscale, ytext*ds.yscale*matrixflags.videoscale*myppc,
+             (right+1)*matrixflags.videoscale-1, (ytext+1)*ds.yscale*matrixflags.videoscale*myppc-1);
   if (cursmode == UNDERLINE) curheight=(tmsg.crtc6845r10 & 31);
   y = ((ytext+1)*ds.yscale*matrixflags.videoscale*myppc - ds.yscale) * ds.vscrwidth;
   while (startpt > curheight*matrixflags.videoscale) {
@@ -903,6 +1008,7 @@ static void blit_scaled_actual2(int32 left, int32 top, int32 right, int32 bottom
   int32 dleft = left*xscale;                               /* Calculate pixel coordinates in the */
   int32 dtop  = top*yscale;                                /* screen buffer of the rectangle */
   int32 i, j, ii, jj;
+  mark_dirty(dleft, dtop, (right+1)*xscale-1, (bottom+1)*yscale-1);
   yy = dtop;
   for (j = top; j <= bottom; j++) {
     for (jj = 1; jj <= yscale; jj++) {
@@ -920,6 +1026,7 @@ static void blit_scaled_actual2(int32 left, int32 top, int32 right, int32 bottom
   if ((screenmode == 3) || (screenmode == 6)) {       /* Paint on the black bars over the background */
     int p;
     hide_cursor();
+    mark_dirty_all();
     for (p=0; p<25; p++) {
       yy=(16+(p*20))*matrixflags.videoscale;
       memset(matrixflags.surface->pixels + 4*yy*ds.vscrwidth*matrixflags.videoscale, 0, 16*ds.screenwidth*xscale*matrixflags.videoscale);
@@ -943,6 +1050,7 @@ static void blit_scaled_actual(int32 left, int32 top, int32 right, int32 bottom)
   if (top < 0) top = 0;
   if (bottom >= ds.screenheight) bottom = ds.screenheight-1;
   if ((!ds.scaled) && (matrixflags.videoscale == 1)) {
+    mark_dirty(left, top, right, bottom);
     if ((top == 0) && (left == 0) && (right == ds.screenwidth-1) && (bottom == ds.screenheight-1)) {
       /* Special high-speed memory copy for full-screen non-scaled blits */
       uint64 *dptr, *sptr, lptr, scrsz;
@@ -967,6 +1075,36 @@ static void blit_scaled(int32 left, int32 top, int32 right, int32 bottom) {
   if ((ds.autorefresh != 1) || (ds.displaybank != ds.writebank)) return;
   blit_scaled_actual(left, top, right, bottom);
 }
+
+/*
+** 'resync_display' copies any rows of the displayed screen bank that
+** differ from what is on the display surface, for example after the
+** screen memory has been written to directly. Only the bands of rows
+** that have changed are copied and so marked for updating, rather
+** than the whole screen. The text cursor must not be on screen. In
+** modes 3 and 6 the rows under the black bars painted between the
+** lines of text never match the screen bank, so they are skipped
+*/
+static void resync_display(void) {
+  int32 xscale = ds.xscale * matrixflags.videoscale;
+  int32 yscale = ds.yscale * matrixflags.videoscale;
+  int32 i, j, first = -1;
+  Uint32 *src, *dst;
+
+  for (j = 0; j < ds.screenheight; j++) {
+    if (((screenmode == 3) || (screenmode == 6)) && ((j*ds.yscale) % 20) >= 16) continue;
+    src = (Uint32*)screenbank[ds.displaybank]->pixels + j*ds.vscrwidth;
+    dst = (Uint32*)matrixflags.surface->pixels + j*yscale*ds.vscrwidth*matrixflags.videoscale;
+    for (i = 0; i < ds.screenwidth && src[i] == dst[i*xscale]; i++);
+    if (i < ds.screenwidth) {
+      if (first < 0) first = j;
+    } else if (first >= 0) {
+      blit_scaled_actual(0, first, ds.screenwidth-1, j-1);
+      first = -1;
+    }
+  }
+  if (first >= 0) blit_scaled_actual(0, first, ds.screenwidth-1, ds.screenheight-1);
+}
 #endif
 
 #define COLOURSTEP 68           /* RGB colour value increment used in 256 colour modes */
@@ -1216,6 +1354,7 @@ static void scroll_up(int32 windowed) {
     for (loop=0;loop<top;loop+=4) {
       *(uint32 *)(screenbank[ds.writebank]->pixels+dest+loop) = SWAPENDIAN(ds.tb_colour);
     }
+    mark_dirty_all();
     for (loop=0;loop<(top*ds.yscale);loop+=4) {
       *(uint32 *)(matrixflags.surface->pixels+(dest*ds.yscale)+loop) = SWAPENDIAN(ds.tb_colour);
     }
@@ -1291,6 +1430,7 @@ static void scroll_down(int32 windowed) {
     for (loop=0;loop<top;loop+=4) {
       *(uint32 *)(screenbank[ds.writebank]->pixels+loop) = SWAPENDIAN(ds.tb_colour);
     }
+    mark_dirty_all();
     for (loop=0;loop<(top*ds.yscale);loop+=4) {
       *(uint32 *)(matrixflags.surface->pixels+loop) = SWAPENDIAN(ds.tb_colour);
     }
@@ -2704,6 +2844,7 @@ static void setup_mode(int32 mode) {
     sx=ox; sy=oy;
     matrixflags.surface = SDL_SetVideoMode(ox * matrixflags.videoscale, oy * matrixflags.videoscale, 32, matrixflags.sdl_flags);
     SDL_BlitSurface(screen1, NULL, matrixflags.surface, NULL);
+    mark_dirty_all();
     if (matrixflags.failovermode == 255) {
       tmsg.modechange = -2;
       return;
@@ -2775,6 +2916,7 @@ static void setup_mode(int32 mode) {
   SDL_FillRect(screen2, NULL, ds.tb_colour);
   SDL_FillRect(screen3, NULL, ds.tb_colour);
   SDL_SetClipRect(matrixflags.surface, NULL);
+  mark_dirty_all();
   /* Are we full screen? If so, turn the mouse off */
   if (matrixflags.alwaysfullscreen || (matrixflags.surface->flags & SDL_FULLSCREEN)) {
     sdl_mouse_onoff(0);
@@ -2810,6 +2952,7 @@ void emulate_mode(int32 mode) {
   }
 /* Reset colours, clear screen and home cursor */
   SDL_FillRect(matrixflags.surface, NULL, ds.tb_colour);
+  mark_dirty_all();
   for (p=0; p<MAXBANKS; p++) {
     SDL_FillRect(screenbank[p], NULL, ds.tb_colour);
   }
@@ -2973,47 +3116,171 @@ static void plot_pixel(SDL_Surface *surface, int32 x, int32 y, Uint32 colour, Ui
 ** Note that the coordinates are *pixel* coordinates, that is, they are
 ** not expressed in graphics units.
 **
-** This code is slow but does the job, and is HIGHLY recursive (and memory hungry).
+** This is a scanline fill. Each seed taken off the stack is grown left
+** and right into a run of pixels which is written in one go, then the
+** rows above and below the run are scanned and one seed is pushed for
+** every run found there. Filled pixels are noted in a bitmap so that
+** GCOL actions which leave a pixel looking like the background do not
+** cause it to be visited again. The bitmap is split into bands of rows
+** of the graphics window, each allocated the first time a pixel in it
+** is filled, so the memory used goes with the size of the area filled
+** rather than the size of the window. The seed stack is of a fixed
+** size: if it overflows, the seeds that did not fit are recovered by
+** rescanning the window for unfilled pixels next to filled ones once
+** the stack has drained.
+*/
+#define FFSTACKSIZE 4096
+#define FFBANDROWS 32           /* Rows of the graphics window in each band of the bitmap */
+
+static int32 ffstackx[FFSTACKSIZE], ffstacky[FFSTACKSIZE];
+static int32 ffsp;
+static boolean ffoverflow;
+static byte **ffbands;          /* Bands of the bitmap of filled pixels */
+static int32 ffbandcount;       /* Number of bands covering the graphics window */
+static int32 ffwidth;           /* Width of the graphics window in pixels */
+
+/*
+** 'ff_release' frees the bitmap of filled pixels
+*/
+static void ff_release(void) {
+  int32 n;
+  if (ffbands == NIL) return;
+  for (n = 0; n < ffbandcount; n++) free(ffbands[n]);
+  free(ffbands);
+  ffbands = NIL;
+}
+
+/*
+** 'ff_done' returns TRUE if pixel (x, y), relative to the top left-hand
+** corner of the graphics window, has been filled
+*/
+static boolean ff_done(int32 x, int32 y) {
+  byte *band = ffbands[y / FFBANDROWS];
+  size_t bit;
+  if (band == NIL) return FALSE;
+  bit = (size_t)(y % FFBANDROWS)*ffwidth + x;
+  return (band[bit >> 3] & (1 << (bit & 7))) != 0;
+}
+
+/*
+** 'ff_mark' notes that pixels 'lx' to 'rx' on row 'y', relative to the
+** top left-hand corner of the graphics window, have been filled. The
+** band of the bitmap that holds the row is allocated if need be
+*/
+static void ff_mark(int32 lx, int32 rx, int32 y) {
+  byte **bp = &ffbands[y / FFBANDROWS];
+  size_t bit;
+  if (*bp == NIL) {
+    *bp = calloc(((size_t)FFBANDROWS*ffwidth+7)/8, 1);
+    if (*bp == NIL) {
+      ff_release();
+      error(ERR_NOROOM);
+    }
+  }
+  for (bit = (size_t)(y % FFBANDROWS)*ffwidth + lx; lx <= rx; lx++, bit++) (*bp)[bit >> 3] |= 1 << (bit & 7);
+}
+
+/*
+** 'ff_push' adds a seed to the flood fill stack, noting if there is no
+** room for it
 */
-// Attempt to reduce stack usage..
-int32 ffcolour, ffaction;
-
-static void flood_fill_inner(uint32 coord) {
-  int32 x=(coord & 0xFFFF);
-  int32 y=(coord >> 16);
-  if(basicvars.recdepth == basicvars.maxrecdepth) return;
-  if (*((Uint32*)screenbank[ds.writebank]->pixels + x + y*ds.vscrwidth) != ds.gb_colour) return;
-  basicvars.recdepth++;
-  plot_pixel(screenbank[ds.writebank], x, y, ffcolour, ffaction); /* Plot this pixel */
-  if (x >= 1) /* Left */
-    if (*((Uint32*)screenbank[ds.writebank]->pixels + (x-1) + y*ds.vscrwidth) == ds.gb_colour)
-      flood_fill_inner(x-1+(y<<16));
-  if (x < (ds.screenwidth-1)) /* Right */
-    if (*((Uint32*)screenbank[ds.writebank]->pixels + (x+1) + y*ds.vscrwidth) == ds.gb_colour)
-      flood_fill_inner(x+1+(y<<16));
-  if (y >= 1) /* Up */
-    if (*((Uint32*)screenbank[ds.writebank]->pixels + x + (y-1)*ds.vscrwidth) == ds.gb_colour)
-      flood_fill_inner(x+((y-1)<<16));
-  if (y < (ds.screenheight-1)) /* Down */
-    if (*((Uint32*)screenbank[ds.writebank]->pixels + x + (y+1)*ds.vscrwidth) == ds.gb_colour)
-      flood_fill_inner(x+((y+1)<<16));
-  basicvars.recdepth--;
+static void ff_push(int32 x, int32 y) {
+  if (ffsp == FFSTACKSIZE) {
+    ffoverflow = TRUE;
+    return;
+  }
+  ffstackx[ffsp] = x;
+  ffstacky[ffsp] = y;
+  ffsp++;
 }
 
 static void flood_fill(int32 x, int32 y, int colour, Uint32 action) {
-  int32 pwinleft, pwinright, pwintop, pwinbottom;
+  int32 pwinleft, pwinright, pwintop, pwinbottom, width, height;
+  int32 left, right, top, bottom, lx, rx, n, row;
+  Uint32 *pixels, *line, bgcol;
+  boolean fast;
+
   if (colour == ds.gb_colour) return;
   pwinleft = GXTOPX(ds.gwinleft);               /* Calculate extent of graphics window in pixels */
   pwinright = GXTOPX(ds.gwinright);
   pwintop = GYTOPY(ds.gwintop);
   pwinbottom = GYTOPY(ds.gwinbottom);
+  if (pwinleft < 0) pwinleft = 0;
+  if (pwinright >= ds.screenwidth) pwinright = ds.screenwidth-1;
+  if (pwintop < 0) pwintop = 0;
+  if (pwinbottom >= ds.screenheight) pwinbottom = ds.screenheight-1;
   if (x < pwinleft || x > pwinright || y < pwintop || y > pwinbottom) return;
-  ffcolour=colour;
-  ffaction=action;
-  if (*((Uint32*)screenbank[ds.writebank]->pixels + x + y*ds.vscrwidth) == ds.gb_colour)
-    flood_fill_inner(x+(y<<16));
+  pixels = (Uint32*)screenbank[ds.writebank]->pixels;
+  bgcol = ds.gb_colour;
+  if (pixels[x + y*ds.vscrwidth] != bgcol) return;
+  width = pwinright-pwinleft+1;
+  height = pwinbottom-pwintop+1;
+  ff_release();         /* In case an earlier fill was stopped by an error */
+  ffwidth = width;
+  ffbandcount = (height+FFBANDROWS-1)/FFBANDROWS;
+  ffbands = calloc(ffbandcount, sizeof(byte *));
+  if (ffbands == NIL) error(ERR_NOROOM);
+
+/* Pixel (px, py) can be filled if it has the background colour and has not been filled already */
+#define FF_DONE(px, py) ff_done((px)-pwinleft, (py)-pwintop)
+#define FF_CANFILL(px, py) (pixels[(px) + (py)*ds.vscrwidth] == bgcol && !FF_DONE(px, py))
+
+  fast = action == 0 && ds.plot_inverse == 0;   /* Plain overwrite can be written directly */
+  left = right = x;
+  top = bottom = y;
+  ffsp = 0;
+  ffoverflow = FALSE;
+  ff_push(x, y);
+  while (ffsp > 0) {
+    while (ffsp > 0) {
+      ffsp--;
+      x = ffstackx[ffsp];
+      y = ffstacky[ffsp];
+      if (!FF_CANFILL(x, y)) continue;          /* Already filled via another seed */
+      line = pixels + y*ds.vscrwidth;
+      lx = rx = x;
+      while (lx > pwinleft && FF_CANFILL(lx-1, y)) lx--;
+      while (rx < pwinright && FF_CANFILL(rx+1, y)) rx++;
+      ff_mark(lx-pwinleft, rx-pwinleft, y-pwintop);
+      if (fast) {
+        for (n = lx; n <= rx; n++) line[n] = SWAPENDIAN(colour);
+      } else {
+        draw_h_line(screenbank[ds.writebank], lx, rx, y, colour, action);
+      }
+      if (lx < left) left = lx;
+      if (rx > right) right = rx;
+      if (y < top) top = y;
+      if (y > bottom) bottom = y;
+/* Push one seed for each run of fillable pixels in the rows above and below */
+      for (row = y-1; row <= y+1; row += 2) {
+        if (row < pwintop || row > pwinbottom) continue;
+        n = lx;
+        while (n <= rx) {
+          if (FF_CANFILL(n, row)) {
+            ff_push(n, row);
+            while (n <= rx && FF_CANFILL(n, row)) n++;
+          }
+          n++;
+        }
+      }
+    }
+    if (ffoverflow) {   /* Recover the seeds that were lost when the stack filled up */
+      ffoverflow = FALSE;
+      for (y = pwintop; y <= pwinbottom && !ffoverflow; y++) {
+        for (x = pwinleft; x <= pwinright; x++) {
+          if (FF_CANFILL(x, y) && ((y > pwintop && FF_DONE(x, y-1)) || (y < pwinbottom && FF_DONE(x, y+1)))) {
+            ff_push(x, y);
+            if (ffoverflow) break;
+          }
+        }
+      }
+    }
+  }
+#undef FF_CANFILL
+#undef FF_DONE
+  ff_release();
   hide_cursor();
-  blit_scaled(0,0,ds.screenwidth-1,ds.screenheight-1);
+  blit_scaled(left, top, right, bottom);
   reveal_cursor();
 }
 #endif /* BRANDY_MODE7ONLY */
@@ -3789,6 +4056,7 @@ boolean init_screen(void) {
     fprintf(stderr, "Unable to init SDL: %s\n", SDL_GetError());
     return FALSE;
   }
+  dirtylock = SDL_CreateMutex();
 
 #ifdef TARGET_UNIX
   videodriver=malloc(64);
@@ -4606,7 +4874,7 @@ void get_sdl_mouse(size_t values[]) {
   values[0]=x;
   values[1]=y;
   values[2]=mousebuttonstate;
-  values[3]=basicvars.centiseconds - basicvars.monotonictimebase;
+  values[3]=mos_centiseconds() - basicvars.monotonictimebase;
 }
 
 void warp_sdlmouse(int32 x, int32 y) {
@@ -4639,6 +4907,7 @@ void fullscreenmode(int onoff) {
     SDL_BlitSurface(matrixflags.surface, NULL, screen1, NULL);
     matrixflags.surface = SDL_SetVideoMode(matrixflags.surface->w * matrixflags.videoscale, matrixflags.surface->h * matrixflags.videoscale, matrixflags.surface->format->BitsPerPixel, matrixflags.sdl_flags);
     SDL_BlitSurface(screen1, NULL, matrixflags.surface, NULL);
+    mark_dirty_all();
     SDL_WM_GrabInput(SDL_GRAB_OFF);
   }
   tmsg.modechange = -1;
@@ -4708,7 +4977,7 @@ void star_refresh(int flag) {
       blit_scaled_actual(0,0,ds.screenwidth-1,ds.screenheight-1);
     }
 #endif
-    SDL_Flip(matrixflags.surface);
+    update_dirty();
   }
   matrixflags.noupdate = 0;
 }
@@ -4829,6 +5098,7 @@ void screencopy(int32 src, int32 dst) {
   SDL_BlitSurface(screenbank[src-1],NULL,screenbank[dst-1],NULL);
   if (dst==(ds.displaybank+1)) {
     SDL_BlitSurface(screenbank[ds.displaybank], NULL, matrixflags.surface, NULL);
+    mark_dirty_all();
   }
 }
 
@@ -5026,6 +5296,7 @@ void sdl_screenload(char *fname) {
     SDL_BlitSurface(placeholder, NULL, screenbank[ds.writebank], NULL);
     if (ds.displaybank == ds.writebank) {
       SDL_BlitSurface(placeholder, NULL, matrixflags.surface, NULL);
+      mark_dirty_all();
     }
     SDL_FreeSurface(placeholder);
   }
@@ -5168,7 +5439,7 @@ int videoupdatethread(void) {
     if (tmsg.bailout != -1) {
       exit_interpreter_real(tmsg.bailout);
     } else {
-      mytime = basicvars.centiseconds;
+      mytime = mos_centiseconds();
       SDL_PumpEvents(); /* This is for the keyboard stuff */
       if (matrixflags.noupdate == 0 && matrixflags.videothreadbusy == 0 && ds.autorefresh == 1 && matrixflags.surface) {
         matrixflags.videothreadbusy = 1;
@@ -5177,6 +5448,7 @@ int videoupdatethread(void) {
             memcpy(mode7cloneframe, mode7frame, 1000);
             tmsg.mode7forcerefresh = 0;
             mode7renderscreen();
+            mark_dirty_all();
             if (matrixflags.videoscale != 1)
               blit_scaled_actual2(0, 0, ds.screenwidth-1, ds.screenheight-1, vduflag(MODE7_BANK) ? screen3 :  screen2);
             else
@@ -5184,6 +5456,7 @@ int videoupdatethread(void) {
           }
           if ((mode7timer - mytime) <= 0) {
             hide_cursor();
+            mark_dirty_all();
             if (vduflag(MODE7_BANK)) {
               if (matrixflags.videoscale != 1)
                 blit_scaled_actual2(0, 0, ds.screenwidth-1, ds.screenheight-1, screen2);
@@ -5203,7 +5476,7 @@ int videoupdatethread(void) {
           }
         }
 #ifndef BRANDY_MODE7ONLY
-        if ((screenmode != 7) && ((mytime % 32) == 0) && (cursorstate == SUSPENDED)) blit_scaled_actual(0,0,ds.screenwidth-1,ds.screenheight-1);
+        if ((screenmode != 7) && ((mytime % 32) == 0) && (cursorstate == SUSPENDED)) resync_display();
 #endif
         if (tmsg.crtc6845r10 & 64) {
           int cadence = (tmsg.crtc6845r10 & 32) ? 64 : 32;
@@ -5213,7 +5486,7 @@ int videoupdatethread(void) {
             hide_cursor();
           }
         }
-        SDL_Flip(matrixflags.surface);
+        update_dirty();
         matrixflags.videothreadbusy = 0;
       }
     }
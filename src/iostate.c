@@ -46,6 +46,8 @@
 
 /* #define DEBUG */
 
+#define BPUTBUFSIZE 256         /* Number of bytes from 'BPUT#' collected before writing them */
+
 /*
 ** 'fn_spc' emulates the 'SPC' function. It leaves 'current' pointing
 ** at the character after the function's  operand
@@ -389,15 +391,79 @@ void exec_beats(void) {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** 'write_array' writes the array on top of the Basic stack to the file
+** with handle 'handle', either in the format used by 'PRINT#' or, if
+** 'raw' is TRUE, as the values are held in memory. Temporary arrays
+** are discarded once they have been written
+*/
+static void write_array(int32 handle, boolean raw) {
+  stackitem arraytype;
+  basicarray *ap, temp;
+  int32 type;
+
+  arraytype = GET_TOPITEM;
+  switch (arraytype) {
+  case STACK_INTARRAY: case STACK_IATEMP:
+    type = VAR_INTWORD;
+    break;
+  case STACK_UINT8ARRAY: case STACK_U8ATEMP:
+    type = VAR_UINT8;
+    break;
+  case STACK_INT64ARRAY: case STACK_I64ATEMP:
+    type = VAR_INTLONG;
+    break;
+  case STACK_FLOATARRAY: case STACK_FATEMP:
+    type = VAR_FLOAT;
+    break;
+  default:
+    type = VAR_STRINGDOL;
+  }
+  if (arraytype==STACK_INTARRAY || arraytype==STACK_UINT8ARRAY || arraytype==STACK_INT64ARRAY
+   || arraytype==STACK_FLOATARRAY || arraytype==STACK_STRARRAY)
+    ap = pop_array();
+  else {
+    temp = pop_arraytemp();
+    ap = &temp;
+  }
+  if (raw)
+    fileio_bputarray(handle, ap, type);
+  else {
+    fileio_printarray(handle, ap, type);
+  }
+  if (ap==&temp) {      /* Discard temporary array */
+    if (arraytype==STACK_SATEMP) discard_strings(temp.arraystart.arraybase, temp.arrsize*sizeof(basicstring));
+    free_stackmem();
+  }
+}
+
+/*
+** 'safe_bputitem' returns TRUE if the item in a 'BPUT#' list at 'p'
+** is an integer constant or a simple integer variable on its own, that
+** is, one that can be evaluated and turned into a byte without an error
+** being raised. Floating point values are not safe as converting them
+** to an integer gives an error if they are out of range
+*/
+static boolean safe_bputitem(byte *p) {
+  if (!(*p>=BASTOKEN_STATICVAR && *p<=BASTOKEN_INT64VAR) && !(*p>=BASTOKEN_INTZERO && *p<=BASTOKEN_INTCON)
+   && *p!=BASTOKEN_INT64CON) return FALSE;
+  p = skip_token(p);
+  return *p==',' || *p==';' || ateol[*p];
+}
+
 /*
 ** 'exec_bput' deals with the 'BPUT' statement
 ** This is an extended version of the statement that allows a
-** number of values to be output at a time
+** number of values to be output at a time. The bytes of numeric
+** values are collected and written together, but they are always
+** written before anything is evaluated that could give an error so
+** that the bytes before it still reach the file
 */
 void exec_bput(void) {
-  int32 handle;
+  int32 handle, count;
   stackitem stringtype;
   basicstring descriptor;
+  char bytes[BPUTBUFSIZE];
 
   DEBUGFUNCMSGIN;
   basicvars.current++;          /* Skip BPUT token */
@@ -414,21 +480,44 @@ void exec_bput(void) {
     return;
   }
   basicvars.current++;
+  count = 0;
   do {
+    if (count>0 && !safe_bputitem(basicvars.current)) {
+      fileio_bputstr(handle, bytes, count);
+      count = 0;
+    }
     expression();               /* Now fetch the value to be written */
     switch (GET_TOPITEM) {
     case STACK_INT: case STACK_UINT8: case STACK_INT64: case STACK_FLOAT:
-      fileio_bput(handle, pop_anynum32());
+      if (count==BPUTBUFSIZE) {
+        fileio_bputstr(handle, bytes, count);
+        count = 0;
+      }
+      bytes[count++] = pop_anynum32();
       break;
     case STACK_STRING: case STACK_STRTEMP:
+      if (count>0) {
+        fileio_bputstr(handle, bytes, count);
+        count = 0;
+      }
       stringtype = GET_TOPITEM;
       descriptor = pop_string();
       fileio_bputstr(handle, descriptor.stringaddr, descriptor.stringlen);
 /* If string is last item on line, output a newline as well */
-      if (ateol[*basicvars.current]) fileio_bput(handle, '\n');
+      if (ateol[*basicvars.current]) bytes[count++] = '\n';
       if (stringtype == STACK_STRTEMP) free_string(descriptor);
       break;
+    case STACK_INTARRAY: case STACK_IATEMP: case STACK_UINT8ARRAY: case STACK_U8ATEMP:
+    case STACK_INT64ARRAY: case STACK_I64ATEMP: case STACK_FLOATARRAY: case STACK_FATEMP:
+    case STACK_STRARRAY: case STACK_SATEMP:
+      if (count>0) {
+        fileio_bputstr(handle, bytes, count);
+        count = 0;
+      }
+      write_array(handle, TRUE);
+      break;
     default:    /* Item is neither a number nor a string */
+      if (count>0) fileio_bputstr(handle, bytes, count);
       DEBUGFUNCMSGOUT;
       error(ERR_VARNUMSTR);
       return;
@@ -442,11 +531,57 @@ void exec_bput(void) {
     else if (ateol[*basicvars.current])         /* Anything else - Check for end of statement */
       break;
     else {
+      if (count>0) fileio_bputstr(handle, bytes, count);
       DEBUGFUNCMSGOUT;
       error(ERR_SYNTAX);
       return;
     }
   } while (TRUE);
+  if (count>0) fileio_bputstr(handle, bytes, count);
+  DEBUGFUNCMSGOUT;
+}
+
+/*
+** 'exec_bget' deals with the 'BGET#' statement, which fills whole
+** arrays with values read from a file as written by 'BPUT#'. Numeric
+** arrays are read as the bytes of the values in memory and each element
+** of a string array as its length in four bytes, least significant byte
+** first, followed by its characters
+*/
+void exec_bget(void) {
+  int32 handle;
+  lvalue destination;
+
+  DEBUGFUNCMSGIN;
+  basicvars.current++;          /* Skip BGET token */
+  if (*basicvars.current != '#') {
+    DEBUGFUNCMSGOUT;
+    error(ERR_HASHMISS);
+    return;
+  }
+  basicvars.current++;
+  handle = eval_intfactor();    /* Get the file handle */
+  if (*basicvars.current != ',') {
+    DEBUGFUNCMSGOUT;
+    error(ERR_COMISS);
+    return;
+  }
+  do {
+    basicvars.current++;        /* Skip the ',' token */
+    get_lvalue(&destination);
+    if ((destination.typeinfo & PARMTYPEMASK & ~TYPEMASK)!=VAR_ARRAY) {      /* Not a whole array */
+      DEBUGFUNCMSGOUT;
+      error(ERR_VARARRAY);
+      return;
+    }
+    if (*destination.address.arrayaddr==NIL) {
+      DEBUGFUNCMSGOUT;
+      error(ERR_NODIMS, "(");
+      return;
+    }
+    fileio_bgetarray(handle, *destination.address.arrayaddr, destination.typeinfo & TYPEMASK);
+  } while (*basicvars.current == ',');
+  check_ateol();
   DEBUGFUNCMSGOUT;
 }
 
@@ -1010,6 +1145,14 @@ static void input_file(void) {
       length = fileio_getstring(handle, CAST(&basicvars.memory[destination.address.offset], char *));
       basicvars.memory[destination.address.offset+length] = asc_CR;
       break;
+    case VAR_INTARRAY: case VAR_UINT8ARRAY: case VAR_INT64ARRAY: case VAR_FLOATARRAY: case VAR_STRARRAY:
+      if (*destination.address.arrayaddr==NIL) {
+        DEBUGFUNCMSGOUT;
+        error(ERR_NODIMS, "(");
+        return;
+      }
+      fileio_inputarray(handle, *destination.address.arrayaddr, destination.typeinfo & TYPEMASK);
+      break;
     default:
       DEBUGFUNCMSGOUT;
       error(ERR_VARNUMSTR);
@@ -1906,6 +2049,11 @@ static void print_file(void) {
       fileio_printstring(handle, descriptor.stringaddr, descriptor.stringlen);
       free_string(descriptor);
       break;
+    case STACK_INTARRAY: case STACK_IATEMP: case STACK_UINT8ARRAY: case STACK_U8ATEMP:
+    case STACK_INT64ARRAY: case STACK_I64ATEMP: case STACK_FLOATARRAY: case STACK_FATEMP:
+    case STACK_STRARRAY: case STACK_SATEMP:
+      write_array(handle, FALSE);
+      break;
     default:
       DEBUGFUNCMSGOUT;
       error(ERR_VARNUMSTR);
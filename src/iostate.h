@@ -28,6 +28,7 @@
 
 extern void exec_beats(void);
 extern void exec_bput(void);
+extern void exec_bget(void);
 extern void exec_circle(void);
 extern void exec_clg(void);
 extern void exec_close(void);
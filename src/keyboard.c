@@ -393,6 +393,10 @@ static struct termios origtty;  /* Copy of original keyboard parameters */
 // Move these later
 Uint8 mousestate, *keystate=NULL;
 int64 esclast=0;
+#ifndef TARGET_MINGW
+#include <fcntl.h>
+static int eventpipe[2] = {-1, -1};     /* Written to by 'event_filter' when a key event arrives */
+#endif
 #endif
 
 #include <stdlib.h>
@@ -560,6 +564,75 @@ static void reinitWinConsole() {
 }
 #endif /* Windows Text-mode under Cygwin */
 
+#ifdef USE_SDL
+/*
+** 'event_filter' is called by SDL on the main thread as each event
+** arrives. It sets the Escape state as soon as Escape is pressed and
+** deals with Ctrl-Print and the window being closed, so nothing has to
+** poll for them. Keyboard events and mouse clicks are left in SDL's
+** queue, and anything waiting for a key is woken up via 'eventpipe' so
+** that it can take them off the queue. Mouse clicks are moved to the
+** mouse buffer by the interpreter's thread, as the buffer is not safe
+** to change from here
+*/
+static int event_filter(const SDL_Event *ev) {
+  switch (ev->type) {
+  case SDL_KEYDOWN:
+    if (ev->key.keysym.sym == SDLK_ESCAPE && backgnd_escape && kbd_esctest()) basicvars.escape = TRUE;
+#ifndef BRANDY_NOBREAKONCTRLPRTSC
+    if (ev->key.keysym.sym == SDLK_PRINT && (ev->key.keysym.mod & KMOD_CTRL)) {
+      tmsg.bailout = 0;
+      return 0;
+    }
+#endif
+    /* Fall through */
+  case SDL_KEYUP:
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+#ifndef TARGET_MINGW
+    if (eventpipe[1] >= 0) (void) write(eventpipe[1], "", 1);
+#endif
+    return 1;
+  case SDL_QUIT:
+    exit_interpreter(EXIT_SUCCESS);
+    return 0;
+  default:
+    return 0;
+  }
+}
+
+/*
+** 'wait_event' sleeps until a keyboard event arrives from SDL or there
+** is input on stdin, or until 'wait' centiseconds have passed. If
+** 'wait' is negative it waits for as long as it takes
+*/
+static void wait_event(int32 wait) {
+#ifndef TARGET_MINGW
+  fd_set waitset;
+  struct timeval waitime;
+  char discard[64];
+  int top;
+
+  if (eventpipe[0] >= 0) {
+    FD_ZERO(&waitset);
+    FD_SET(eventpipe[0], &waitset);
+    top = eventpipe[0];
+    if (!nokeyboard) {
+      FD_SET(keyboard, &waitset);
+      if (keyboard > top) top = keyboard;
+    }
+    waitime.tv_sec = wait/100;  /* Convert wait time to seconds and microseconds */
+    waitime.tv_usec = wait%100*10000;
+    if (select(top+1, &waitset, NIL, NIL, wait<0 ? NIL : &waitime) > 0 && FD_ISSET(eventpipe[0], &waitset)) {
+      while (read(eventpipe[0], discard, sizeof(discard)) > 0);  /* Empty the pipe */
+    }
+    return;
+  }
+#endif
+  usleep(wait<0 || wait>0 ? 10000 : 1000);
+}
+#endif /* USE_SDL */
+
 /* Keyboard initialise and finalise */
 /* ================================ */
 
@@ -586,6 +659,19 @@ boolean kbd_init() {
   enable_insert = TRUE;
   set_cursor(enable_insert);
 
+#ifdef USE_SDL
+#ifndef TARGET_MINGW
+  if (pipe(eventpipe) == 0) {
+    fcntl(eventpipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(eventpipe[1], F_SETFL, O_NONBLOCK);
+  }
+  else {
+    eventpipe[0] = eventpipe[1] = -1;
+  }
+#endif
+  SDL_SetEventFilter(event_filter);
+#endif
+
 #ifdef TARGET_DOSWIN
 #ifdef TARGET_DJGPP
   // DOS target
@@ -710,35 +796,24 @@ int32 kbd_pending() {
 /* kbd_escpoll() - is there a pending Escape state */
 /* ----------------------------------------------- */
 /* With background keypress processing, this just tests the flag set by the background,
- * similar to BIT ESCFLG in other BASICs. However, on some targets we can't see
- * keypresses in the background, we don't have an equivalent of SIGINT, so this routine
- * also polls the Escape key.
+ * similar to BIT ESCFLG in other BASICs. With SDL the flag is set by 'event_filter' as
+ * soon as Escape is pressed. However, on some targets we can't see keypresses in the
+ * background, we don't have an equivalent of SIGINT, so this routine also polls the
+ * Escape key.
  * To do: the Escape key needs to be definable, but in this routine we need the keynumber
  * not the character code.
  */
 int kbd_escpoll() {
-#ifdef USE_SDL
-int64 tmp;
-#endif
-
+#if defined(TARGET_MINGW) && !defined(USE_SDL)
   if (backgnd_escape) {                         /* Only poll when not doing key input   */
     if (kbd_esctest()) {                        /* Only poll if Escapes are enabled     */
-#ifdef USE_SDL
-      tmp=basicvars.centiseconds;
-      if (tmp > esclast) {
-        esclast=tmp;
-        if (kbd_inkey(-113)) basicvars.escape=TRUE;     // Should check key character, not keycode
-      }
-#else
-#ifdef TARGET_MINGW
       if (GetAsyncKeyState(VK_ESCAPE)) {                // Should check key character, not keycode
         while (GetAsyncKeyState(VK_ESCAPE));    /* Wait until key not pressed           */
         basicvars.escape=TRUE;
       }
-#endif
-#endif
     }
   }
+#endif
   return basicvars.escape;                      /* Return Escape state                  */
 }
 
@@ -981,13 +1056,13 @@ int32 kbd_inkey(int32 arg) {
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate |= 4;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate |= 2;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate |= 1;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_MOUSEBUTTONUP:
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate &= 3;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate &= 5;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate &= 6;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
       }
     }
@@ -1361,7 +1436,7 @@ int32 kbd_get0(void) {
  #if defined(TARGET_UNIX) && !defined(USE_SDL)
   int key, mod;
 
-  fflush(stdout);
+  flush_screen();                               /* Show everything before waiting       */
   read(STDIN_FILENO, &ch, 1);                   /* Read without flushing                */
   ch=ch & 0xFF;
   if (ch != 27) return ch;                      /* Not <esc>                            */
@@ -1470,7 +1545,7 @@ void osbyte21(int32 xreg) {
 void checkforescape(void) {
 #ifdef USE_SDL
 int64 i;
-  i=basicvars.centiseconds;
+  i=mos_centiseconds();
   if (i > esclast) {
     esclast=i;
 // Should check key character, not keycode
@@ -1520,7 +1595,7 @@ static boolean waitkey(int wait) {
 #endif
 
 #ifdef USE_SDL
-  timerstart = basicvars.centiseconds;
+  timerstart = mos_centiseconds();
   SDL_Event ev;
   while ( 1 ) {
 /*
@@ -1551,20 +1626,20 @@ static boolean waitkey(int wait) {
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate |= 4;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate |= 2;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate |= 1;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_MOUSEBUTTONUP:
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate &= 3;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate &= 5;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate &= 6;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_QUIT:
           exit_interpreter(EXIT_SUCCESS);
           break;
       }
     }
-    if (basicvars.centiseconds - timerstart >= wait) return 0;
+    if (mos_centiseconds() - timerstart >= wait) return 0;
 
 #ifndef TARGET_MINGW
 /*
@@ -1577,8 +1652,8 @@ static boolean waitkey(int wait) {
     waitime.tv_sec = waitime.tv_usec = 0;
     if (!nokeyboard && select(1, &keyset, NIL, NIL, &waitime) > 0 ) return 1;
 #endif /* !TARGET_MINGW */
-    if (basicvars.centiseconds - timerstart >= wait) return 0; /* return after one check if wait time = 0, or after timeout. */
-    usleep(1000);
+    if (mos_centiseconds() - timerstart >= wait) return 0; /* return after one check if wait time = 0, or after timeout. */
+    wait_event(wait - (mos_centiseconds() - timerstart));
   }
 #else /* !USE_SDL */
 #ifdef BODGEMGW
@@ -1586,6 +1661,7 @@ static boolean waitkey(int wait) {
   for(;;) { if(kbhit() || (clock()>tmp)) break; }
   return kbhit();
 #else
+  flush_screen();
   FD_ZERO(&keyset);
   FD_SET(keyboard, &keyset);
   waitime.tv_sec = wait/100;    /* Convert wait time to seconds and microseconds */
@@ -1649,6 +1725,7 @@ int32 read_key(void) {
 #endif
   SDL_Event ev;
   int mx, my;
+  boolean gotevent;
 
   if (holdcount > 0) return pop_key();  // moved to here
 
@@ -1659,7 +1736,8 @@ int32 read_key(void) {
 
     while (matrixflags.videothreadbusy) usleep(1000);
     matrixflags.noupdate = 1;
-    if ((tmsg.bailout == -1) && (SDL_PeepEvents(&ev, 1, SDL_GETEVENT, SDL_ALLEVENTS))) {
+    gotevent = (tmsg.bailout == -1) && SDL_PeepEvents(&ev, 1, SDL_GETEVENT, SDL_ALLEVENTS) > 0;
+    if (gotevent) {
       SDL_GetMouseState(&mx, &my);
       switch(ev.type) {
         case SDL_QUIT:
@@ -1669,13 +1747,13 @@ int32 read_key(void) {
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate |= 4;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate |= 2;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate |= 1;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_MOUSEBUTTONUP:
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate &= 3;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate &= 5;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate &= 6;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_KEYUP:
           break;
@@ -1754,8 +1832,8 @@ int32 read_key(void) {
       else return ch;
     }
 #endif /* TARGET_MINGW */
-/*  If we reach here then nothing happened and so we should sleep */
-    usleep(10000);
+/*  If we reach here with the event queue empty then nothing happened and so we should sleep */
+    if (!gotevent) wait_event(-1);
   }
 #else /* ! USE_SDL */
 
@@ -1979,6 +2057,7 @@ readstate emulate_readline(char buffer[], int32 length, int32 echochar) {
 
   if (basicvars.runflags.inredir) {     /* There is no keyboard to read - Read from file stdin */
     char *p;
+    flush_screen();                     /* Make sure any prompt has been written */
     p = fgets(buffer, length, stdin);   /* Get all in one go */
     if (p == NIL) {                     /* Call failed */
       if (ferror(stdin)) {
@@ -124,12 +124,173 @@ void exec_call(void) {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** CASE jump tables
+** ----------------
+** If every value in the 'WHEN' clauses of a 'CASE' statement is an
+** integer constant, or every one is a string constant, a hash table of
+** the values is built along with the case table. Given a value of the
+** same kind, 'exec_case' can then go straight to the right 'WHEN'
+** instead of evaluating each 'WHEN' expression in turn. Anything else,
+** for example a floating point 'CASE' value, uses the normal search so
+** that the results and any errors are the same as before.
+*/
+
+/*
+** 'hash_caseint' and 'hash_casestring' return the hash values used for
+** integer and string 'WHEN' values
+*/
+static uint32 hash_caseint(int64 value) {
+  return CAST((CAST(value, uint64)*0x9E3779B97F4A7C15ull) >> 32, uint32);
+}
+
+static uint32 hash_casestring(byte *text, int32 length) {
+  uint32 hashtotal = 2166136261u;
+  while (length > 0) {
+    hashtotal = (hashtotal ^ *text)*16777619u;
+    text++;
+    length--;
+  }
+  return hashtotal;
+}
+
+/*
+** 'get_whenconst' checks if the item in a 'WHEN' list at 'tp' is an
+** integer constant, possibly with a '-' in front of it, or a string
+** constant without any '""' in it, followed by a ',' or the end of the
+** list. If it is, it returns a pointer to the byte after the item and
+** sets either 'intvalue' or 'text' and 'length' to its value. 'isstring'
+** says which. It returns NIL if the item is anything else
+*/
+static byte *get_whenconst(byte *tp, boolean *isstring, int64 *intvalue, byte **text, int32 *length) {
+  boolean negate = FALSE;
+
+  *isstring = FALSE;
+  if (*tp == '-') {
+    negate = TRUE;
+    tp++;
+  }
+  switch (*tp) {
+  case BASTOKEN_INTZERO: *intvalue = 0; tp++; break;
+  case BASTOKEN_INTONE: *intvalue = 1; tp++; break;
+  case BASTOKEN_SMALLINT: *intvalue = *(tp+1)+1; tp+=2; break;   /* +1 as values 1..256 are held as 0..255 */
+  case BASTOKEN_INTCON:
+    tp++;
+    *intvalue = CAST(GET_INTVALUE(tp), int32);
+    tp+=INTSIZE;
+    break;
+  case BASTOKEN_INT64CON:
+    tp++;
+    *intvalue = GET_INT64VALUE(tp);
+    tp+=INT64SIZE;
+    break;
+  case BASTOKEN_STRINGCON:
+    if (negate) return NIL;
+    *isstring = TRUE;
+    *text = GET_SRCADDR(tp);
+    *length = GET_SIZE(tp+1+OFFSIZE);
+    tp+=1+OFFSIZE+SIZESIZE;
+    break;
+  default:
+    return NIL;
+  }
+  if (negate) *intvalue = -*intvalue;
+  if (*tp != ',' && *tp != ':' && *tp != asc_NUL) return NIL;   /* Constant is only part of an expression */
+  return tp;
+}
+
+/*
+** 'make_casejump' builds the hash table of 'WHEN' values for case
+** table 'cp' if they are all integer constants or all string constants.
+** Where a value appears more than once, the first 'WHEN' it is in is
+** the one used. It returns NIL if the table cannot be built
+*/
+static casejump *make_casejump(casetable *cp) {
+  casejump *jp;
+  byte *tp, *text = NIL;
+  int32 n, count, size, length = 0;
+  int64 intvalue = 0;
+  boolean isstring, stringkeys = FALSE;
+
+  count = 0;
+  for (n = 0; n < cp->whencount; n++) {         /* Check that the values are all constants */
+    tp = cp->whentable[n].whenexpr;
+    while (TRUE) {
+      tp = get_whenconst(tp, &isstring, &intvalue, &text, &length);
+      if (tp == NIL) return NIL;
+      if (count == 0) stringkeys = isstring;
+      if (isstring != stringkeys) return NIL;   /* Values are a mixture of integers and strings */
+      count++;
+      if (*tp != ',') break;
+      tp++;
+    }
+  }
+  if (count == 0) return NIL;
+  size = 16;    /* Keep the table no more than half full */
+  while (size < count*2) size = size*2;
+  jp = allocmem(sizeof(casejump)+(size-1)*sizeof(caseentry), FALSE);
+  if (jp == NIL) return NIL;
+  jp->stringkeys = stringkeys;
+  jp->jumpmask = size-1;
+  for (n = 0; n < size; n++) jp->jumptable[n].jumpwhen = -1;
+  for (n = 0; n < cp->whencount; n++) {
+    tp = cp->whentable[n].whenexpr;
+    while (TRUE) {
+      uint32 slot;
+      caseentry *ep;
+      tp = get_whenconst(tp, &isstring, &intvalue, &text, &length);
+      slot = (stringkeys ? hash_casestring(text, length) : hash_caseint(intvalue)) & jp->jumpmask;
+      while (TRUE) {
+        ep = &jp->jumptable[slot];
+        if (ep->jumpwhen < 0) break;    /* Unused entry */
+        if (stringkeys ? ep->jumplen == length && memcmp(ep->jumpstring, text, length) == 0 : ep->jumpint == intvalue) break;
+        slot = (slot+1) & jp->jumpmask;
+      }
+      if (ep->jumpwhen < 0) {   /* Value has not been seen in an earlier 'WHEN' */
+        ep->jumpint = intvalue;
+        ep->jumpstring = text;
+        ep->jumplen = length;
+        ep->jumpwhen = n;
+      }
+      if (*tp != ',') break;
+      tp++;
+    }
+  }
+  return jp;
+}
+
+/*
+** 'find_caseint' and 'find_casestring' look for a value in the hash table
+** of 'WHEN' values 'jp'. They return the index of the 'WHEN' with that
+** value or -1 if there is not one
+*/
+static int32 find_caseint(casejump *jp, int64 value) {
+  uint32 slot = hash_caseint(value) & jp->jumpmask;
+  while (jp->jumptable[slot].jumpwhen >= 0) {
+    if (jp->jumptable[slot].jumpint == value) return jp->jumptable[slot].jumpwhen;
+    slot = (slot+1) & jp->jumpmask;
+  }
+  return -1;
+}
+
+static int32 find_casestring(casejump *jp, basicstring string) {
+  uint32 slot = hash_casestring(CAST(string.stringaddr, byte *), string.stringlen) & jp->jumpmask;
+  while (jp->jumptable[slot].jumpwhen >= 0) {
+    caseentry *ep = &jp->jumptable[slot];
+    if (ep->jumplen == string.stringlen && (ep->jumplen == 0 || memcmp(ep->jumpstring, string.stringaddr, ep->jumplen) == 0)) return ep->jumpwhen;
+    slot = (slot+1) & jp->jumpmask;
+  }
+  return -1;
+}
+
 /*
 ** 'exec_case' deals with a 'CASE' statement.
 ** The way 'CASE' statements are handled is to build a table of pointers to
 ** expressions and statement sequences the first time the statement is seen.
 ** This eliminates the need to search for the 'WHEN' clauses each time the
-** statement is executed (at the expense of some extra memory).
+** statement is executed (at the expense of some extra memory). If there is
+** a hash table of the 'WHEN' values and the 'CASE' value is of the same
+** kind, that is used to find the right 'WHEN' directly.
 */
 void exec_case(void) {
   stackitem casetype, whentype;
@@ -139,7 +300,8 @@ void exec_case(void) {
   static float64 floatcase = 0;
   basicstring casestring = {0, NULL}, whenstring;
   casetable *cp;
-  boolean found;
+  casejump *jp;
+  boolean found, searched;
   byte *here;
 
   DEBUGFUNCMSGIN;
@@ -159,78 +321,100 @@ void exec_case(void) {
     return;
   }
 /*
-** Now go through the case table and try to find a 'WHEN' case that
+** Use the hash table of 'WHEN' values if there is one and the 'CASE'
+** value is the right kind. Line tracing needs each 'WHEN' to be looked at
+** so the table is not used then
+*/
+  found = searched = FALSE;
+  n = 0;
+  jp = cp->jumps;
+  if (jp != NIL && !basicvars.traces.lines) {
+    if (casetype == STACK_STRING || casetype == STACK_STRTEMP) {
+      if (jp->stringkeys) {
+        n = find_casestring(jp, casestring);
+        searched = TRUE;
+      }
+    }
+    else if (casetype != STACK_FLOAT && !jp->stringkeys) {
+      n = find_caseint(jp, casetype == STACK_INT ? intcase : casetype == STACK_UINT8 ? uint8case : int64case);
+      searched = TRUE;
+    }
+    found = searched && n >= 0;
+  }
+/*
+** Otherwise go through the case table and try to find a 'WHEN' case that
 ** matches
 */
-  found = FALSE;
-  for (n=0; n<cp->whencount; n++) {
-    basicvars.current = cp->whentable[n].whenexpr;      /* Point at the WHEN expression */
-    if (basicvars.traces.lines) trace_line(GET_LINENO(find_linestart(basicvars.current)));
-    while (TRUE) {
-      expression();
-      whentype = GET_TOPITEM;
-      if (casetype == STACK_INT) {      /* Go by type of 'case' expression */
-        switch(whentype) {              /* Then by type of 'WHEN' expression */
-          case STACK_INT: case STACK_UINT8: case STACK_INT64:
-            found = pop_anyint() == intcase; break;
-          case STACK_FLOAT: found = pop_float() == TOFLOAT(intcase); break;
-          default: 
-            DEBUGFUNCMSGOUT;
-            error(ERR_TYPENUM);
-            return;
+  if (!searched) {
+    for (n=0; n<cp->whencount; n++) {
+      basicvars.current = cp->whentable[n].whenexpr;      /* Point at the WHEN expression */
+      if (basicvars.traces.lines) trace_line(GET_LINENO(find_linestart(basicvars.current)));
+      while (TRUE) {
+        expression();
+        whentype = GET_TOPITEM;
+        if (casetype == STACK_INT) {      /* Go by type of 'case' expression */
+          switch(whentype) {              /* Then by type of 'WHEN' expression */
+            case STACK_INT: case STACK_UINT8: case STACK_INT64:
+              found = pop_anyint() == intcase; break;
+            case STACK_FLOAT: found = pop_float() == TOFLOAT(intcase); break;
+            default: 
+              DEBUGFUNCMSGOUT;
+              error(ERR_TYPENUM);
+              return;
+          }
         }
-      }
-      else if (casetype == STACK_UINT8) {       /* Go by type of 'case' expression */
-        switch(whentype) {              /* Then by type of 'WHEN' expression */
-          case STACK_INT: case STACK_UINT8: case STACK_INT64:
-            found = pop_anyint() == uint8case; break;
-          case STACK_FLOAT: found = pop_float() == TOFLOAT(uint8case); break;
-          default:
-            DEBUGFUNCMSGOUT;
-            error(ERR_TYPENUM);
-            return;
+        else if (casetype == STACK_UINT8) {       /* Go by type of 'case' expression */
+          switch(whentype) {              /* Then by type of 'WHEN' expression */
+            case STACK_INT: case STACK_UINT8: case STACK_INT64:
+              found = pop_anyint() == uint8case; break;
+            case STACK_FLOAT: found = pop_float() == TOFLOAT(uint8case); break;
+            default:
+              DEBUGFUNCMSGOUT;
+              error(ERR_TYPENUM);
+              return;
+          }
         }
-      }
-      else if (casetype == STACK_INT64) {       /* Go by type of 'case' expression */
-        switch(whentype) {              /* Then by type of 'WHEN' expression */
-          case STACK_INT: case STACK_UINT8: case STACK_INT64:
-            found = pop_anyint() == int64case; break;
-          case STACK_FLOAT: found = pop_float() == TOFLOAT(int64case); break;
-          default:
+        else if (casetype == STACK_INT64) {       /* Go by type of 'case' expression */
+          switch(whentype) {              /* Then by type of 'WHEN' expression */
+            case STACK_INT: case STACK_UINT8: case STACK_INT64:
+              found = pop_anyint() == int64case; break;
+            case STACK_FLOAT: found = pop_float() == TOFLOAT(int64case); break;
+            default:
+              DEBUGFUNCMSGOUT;
+              error(ERR_TYPENUM);
+              return;
+          }
+        }
+        else if (casetype == STACK_FLOAT) {               /* 'case' expression is a floating point value */
+          found = pop_anynumfp() == floatcase;
+        }
+        else {    /* This leaves just strings */
+          if (whentype != STACK_STRING && whentype != STACK_STRTEMP) {
             DEBUGFUNCMSGOUT;
-            error(ERR_TYPENUM);
+            error(ERR_TYPESTR);
             return;
+          }
+          whenstring = pop_string();
+          if (whenstring.stringlen != casestring.stringlen)
+            found = FALSE;
+          else if (whenstring.stringlen == 0)
+            found = TRUE;
+          else {
+            found = memcmp(whenstring.stringaddr, casestring.stringaddr, whenstring.stringlen) == 0;
+          }
+          if (whentype == STACK_STRTEMP) free_string(whenstring);
         }
-      }
-      else if (casetype == STACK_FLOAT) {               /* 'case' expression is a floating point value */
-        found = pop_anynumfp() == floatcase;
-      }
-      else {    /* This leaves just strings */
-        if (whentype != STACK_STRING && whentype != STACK_STRTEMP) {
+        if (found || *basicvars.current == ':' || *basicvars.current == asc_NUL) break;   /* Found a match or end of WHEN expression list so escape from loop */
+        if (*basicvars.current == ',')    /* No match - Another value follows for this CASE */
+          basicvars.current++;
+        else {
           DEBUGFUNCMSGOUT;
-          error(ERR_TYPESTR);
+          error(ERR_SYNTAX);
           return;
         }
-        whenstring = pop_string();
-        if (whenstring.stringlen != casestring.stringlen)
-          found = FALSE;
-        else if (whenstring.stringlen == 0)
-          found = TRUE;
-        else {
-          found = memcmp(whenstring.stringaddr, casestring.stringaddr, whenstring.stringlen) == 0;
-        }
-        if (whentype == STACK_STRTEMP) free_string(whenstring);
-      }
-      if (found || *basicvars.current == ':' || *basicvars.current == asc_NUL) break;   /* Found a match or end of WHEN expression list so escape from loop */
-      if (*basicvars.current == ',')    /* No match - Another value follows for this CASE */
-        basicvars.current++;
-      else {
-        DEBUGFUNCMSGOUT;
-        error(ERR_SYNTAX);
-        return;
       }
+      if (found) break;   /* Match found - Escape from outer loop */
     }
-    if (found) break;   /* Match found - Escape from outer loop */
   }
   if (casetype == STACK_STRTEMP) free_string(casestring);
   if (found) {  /* Case value matched */
@@ -333,6 +517,7 @@ void exec_xcase(void) {
   cp->whencount = whencount;
   cp->defaultaddr = defaultaddr;
   for (n=0; n<whencount; n++) cp->whentable[n] = whentable[n];
+  cp->jumps = make_casejump(cp);
   *basicvars.current = BASTOKEN_CASE;
   set_address(basicvars.current, cp);
   exec_case();  /* Now go and process the CASE statement */
@@ -2375,8 +2560,7 @@ static void find_data(void) {
 /* skip these items to move to the start of the next line */
     dp = skip_token(dp+1)+1;
   }
-/* Look for the next 'DATA' statement */
-  while (!AT_PROGEND(dp) && *FIND_EXEC(dp) != BASTOKEN_DATA) dp+=GET_LINELEN(dp);
+  dp = find_dataline(dp);       /* Look for the next 'DATA' statement */
   if (AT_PROGEND(dp)) {  /* Have not found a DATA statement */
     DEBUGFUNCMSGOUT;
     error(ERR_DATA);
@@ -2390,11 +2574,67 @@ static void find_data(void) {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** 'push_dataconst' checks if the field in a 'DATA' statement at 'dp' is
+** just a number, possibly with a '-' in front of it. If it is, it pushes
+** the value on to the Basic stack, exactly as tokenising and evaluating
+** the field as an expression would, and returns a pointer to the ',' or
+** NUL after the field. If it is anything else it returns NIL
+*/
+static byte *push_dataconst(byte *dp) {
+  boolean isneg, isint, isbinhex = FALSE;
+  int32 value = 0, digits = 0;
+  int64 value64 = 0;
+  float64 fpvalue = 0;
+  char *ep;
+
+  dp = skip(dp);
+  isneg = *dp == '-';
+  if (isneg) dp = skip(dp+1);
+  if (*dp == '&' || *dp == '%') {       /* Hex or binary value */
+    int32 base = *dp == '&' ? 4 : 1;
+    isbinhex = isint = TRUE;
+    dp++;
+    while (base == 4 ? isxdigit(*dp) : (*dp == '0' || *dp == '1')) {
+      value = (value<<base)+todigit(*dp);
+      value64 = (value64<<base)+todigit(*dp);
+      digits++;
+      dp++;
+    }
+    if (digits == 0) return NIL;
+  }
+  else if (isdigit(*dp) || (*dp == '.' && isdigit(*(dp+1)))) {  /* Decimal or floating point */
+    ep = tonumber(CAST(dp, char *), &isint, &value, &value64, &fpvalue);
+    if (ep == NIL) return NIL;
+    dp = CAST(ep, byte *);
+  }
+  else {
+    return NIL;
+  }
+  dp = skip(dp);
+  if (*dp != ',' && *dp != asc_NUL) return NIL;  /* Number is only part of the field */
+/* Use the same type of value as the tokeniser would for the constant */
+  if (!isint) {
+    push_float(fpvalue);
+    if (isneg) NEGATE_FLOAT;
+  }
+  else if ((!matrixflags.hex64 && isbinhex) || value == value64) {
+    push_int(value);
+    if (isneg) NEGATE_INT;
+  }
+  else {
+    push_int64(value64);
+    if (isneg) NEGATE_INT64;
+  }
+  return dp;
+}
+
 /*
 ** 'read_numeric' deals with numeric variables found in 'READ' statements.
 ** Here, the value in the 'DATA' statement is interpreted as an expression
-** and not just a string. The data pointer is left pointing at the ','
-** or NUL at the end of the line after the field
+** and not just a string. Fields that are just numbers are converted
+** directly. The data pointer is left pointing at the ',' or NUL at the
+** end of the line after the field
 */
 static void read_numeric(lvalue destination) {
   byte *dp;
@@ -2403,28 +2643,33 @@ static void read_numeric(lvalue destination) {
   byte readexpr[MAXSTATELEN];
 
   DEBUGFUNCMSGIN;
-  n = 0;
-  numparen = 0; /* Keep track of number of parentheses */
-  dp = skip(basicvars.datacur);
-  while (*dp != asc_NUL && (*dp != ',' || numparen > 0)) {      /* Copy value to be read */
-    if ('(' == *dp) numparen++;
-    if (')' == *dp) numparen--;
-    text[n] = *dp;
-    dp++;
-    n++;
-  }
-  text[n] = asc_NUL;
-  if (n == 0) {       /* Number string is empty */
-    DEBUGFUNCMSGOUT;
-    error(ERR_BADEXPR);
-    return;
+  dp = push_dataconst(basicvars.datacur);
+  if (dp != NIL)        /* Field is a number */
+    basicvars.datacur = dp;
+  else {        /* Field has to be evaluated as an expression */
+    n = 0;
+    numparen = 0;       /* Keep track of number of parentheses */
+    dp = skip(basicvars.datacur);
+    while (*dp != asc_NUL && (*dp != ',' || numparen > 0)) {    /* Copy value to be read */
+      if ('(' == *dp) numparen++;
+      if (')' == *dp) numparen--;
+      text[n] = *dp;
+      dp++;
+      n++;
+    }
+    text[n] = asc_NUL;
+    if (n == 0) {     /* Number string is empty */
+      DEBUGFUNCMSGOUT;
+      error(ERR_BADEXPR);
+      return;
+    }
+    basicvars.datacur = dp;
+    tokenize(text, readexpr, NOLINE, FALSE);    /* Tokenise the expression */
+    save_current();     /* Preserve our place in the program */
+    basicvars.current = FIND_EXEC(&readexpr[0]);
+    expression();
+    restore_current();
   }
-  basicvars.datacur = dp;
-  tokenize(text, readexpr, NOLINE, FALSE);      /* Tokenise the expression */
-  save_current();       /* Preserve our place in the program */
-  basicvars.current = FIND_EXEC(&readexpr[0]);
-  expression();
-  restore_current();
   switch (destination.typeinfo) {       /* Now save the value just read */
   case VAR_INTWORD:     /* 32-bit integer variable */
     *destination.address.intaddr = pop_anynum32();
@@ -2608,11 +2853,7 @@ static void restore_dataptr(void) {
 ** the data pointer to this line and we have just advanced to
 ** the line
 */
-    line--;
-    while (!AT_PROGEND(p) && line>0) {
-      p+=GET_LINELEN(p);
-      line--;
-    }
+    p = skip_lines(p, line-1);
     if (AT_PROGEND(p)) {        /* Reached end of program and no DATA statements were found */
       basicvars.runflags.outofdata = TRUE;
       return;           /* Return as there is nothing more to do */
@@ -2638,9 +2879,7 @@ static void restore_dataptr(void) {
 ** 'RESTORE' statement. Look for a DATA statement at this point or
 ** after it
 */
-  while (!AT_PROGEND(dest) && *FIND_EXEC(dest) != BASTOKEN_DATA) {
-    dest+=GET_LINELEN(dest);
-  }
+  dest = find_dataline(dest);
   if (AT_PROGEND(dest))         /* No DATA statement was found */
     basicvars.runflags.outofdata = TRUE;
   else {
@@ -3017,9 +3256,11 @@ void exec_sys(void) {
   stackitem parmtype;
   basicstring descriptor, tempdesc[MAXSYSPARMS];
   lvalue destination;
+  byte *namep;
 
   DEBUGFUNCMSGIN;
   basicvars.current++;
+  namep = basicvars.current;
   expression();         /* Fetch the SWI name or number */
   parmtype = GET_TOPITEM;
   switch (parmtype) {   /* Untangle the SWI number */
@@ -3030,6 +3271,22 @@ void exec_sys(void) {
     descriptor = pop_string();
     swino = mos_getswinum(descriptor.stringaddr, descriptor.stringlen, 0);
     if (parmtype == STACK_STRTEMP) free_string(descriptor);
+/*
+** If the SWI name was given as a constant on its own, overwrite the
+** string constant token with an integer constant holding the SWI
+** number so that later calls from here skip the name lookup. Both
+** tokens are the same size. The source of the line is not altered
+** so it still lists as the name
+*/
+    if (*namep == BASTOKEN_STRINGCON && basicvars.current == namep+1+OFFSIZE+SIZESIZE
+     && (*basicvars.current == ',' || ateol[*basicvars.current] || *basicvars.current == BASTOKEN_TO)) {
+      int32 value = swino;
+      *namep = BASTOKEN_INTCON;
+      for (n=1; n<=INTSIZE; n++) {
+        namep[n] = CAST(value, byte);
+        value = value>>BYTESHIFT;
+      }
+    }
     break;
   default:
     DEBUGFUNCMSGOUT;
@@ -3292,7 +3549,8 @@ void exec_wait(void) {
 ** 'OTHERWISE' statement. In the context of the interpreter they are
 ** used to mark the end of the statement sequence of the preceding 'WHEN'
 ** clause. The function fills in the offset from the WHEN to the code
-** following the CASE statement's ENDCASE.
+** following the CASE statement's ENDCASE and changes the token so that
+** this is only done once.
 */
 void exec_xwhen(void) {
   byte *lp, *lp2;
@@ -3327,6 +3585,11 @@ void exec_xwhen(void) {
     lp2 = FIND_EXEC(lp2);
   }
   set_dest(basicvars.current+1, lp2);
+  if (*basicvars.current == BASTOKEN_XWHEN)     /* Offset is now filled in so switch to the non-'X' token */
+    *basicvars.current = BASTOKEN_WHEN;
+  else {
+    *basicvars.current = BASTOKEN_OTHERWISE;
+  }
   exec_elsewhen();      /* Now go and branch to the ENDCASE */
   DEBUGFUNCMSGOUT;
 }
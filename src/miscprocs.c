@@ -39,6 +39,7 @@
 #include "keyboard.h"
 #include "screen.h"
 #include "statement.h"
+#include "heap.h"
 #include "miscprocs.h"
 
 #ifdef TARGET_RISCOS
@@ -235,6 +236,222 @@ library *find_library(byte *wanted) {
   return lp;
 }
 
+/*
+** Line number indexes
+** -------------------
+** 'find_line' and 'find_linestart' use a table of the lines in the
+** program or library sorted by line number to find lines with a binary
+** search instead of walking the program from the start. The table for
+** the program in memory is built when it is first needed and thrown
+** away by 'clear_lineindex' whenever the program is edited. As a safety
+** net it is also rebuilt if the start or end of the program has moved
+** since it was built. Libraries cannot be edited so their tables are
+** built once by 'make_lineindex' when they are loaded. If the lines of
+** a program are not in ascending order, no table is made and the old
+** linear searches are used instead.
+*/
+static lineindex *progindex;            /* Line number index of program in memory */
+static byte *progindex_start;           /* Values of 'start' and 'top' when index was made */
+static byte *progindex_top;
+static boolean progindex_valid;         /* TRUE if 'progindex' reflects the current program */
+static lineindex *dataindex;            /* Table of the lines in the program that contain DATA */
+static byte *dataindex_start;           /* Values of 'start' and 'top' when table was made */
+static byte *dataindex_top;
+static boolean dataindex_valid;         /* TRUE if 'dataindex' reflects the current program */
+
+/*
+** 'make_lineindex' builds a line number index of the program or
+** library starting at 'base'. If 'onheap' is TRUE the index is placed
+** on the Basic heap otherwise it is malloc'ed. It returns NIL if the
+** lines are not in order or there is no memory for the index
+*/
+lineindex *make_lineindex(byte *base, boolean onheap) {
+  lineindex *ip;
+  byte *p;
+  int32 count, lastline, n;
+  size_t size;
+
+  count = 1;    /* Count includes the end marker */
+  lastline = 0;
+  for (p = base; !AT_PROGEND(p); p+=GET_LINELEN(p)) {
+    if (GET_LINENO(p)<lastline) return NIL;     /* Lines are out of order */
+    lastline = GET_LINENO(p);
+    count++;
+  }
+  size = sizeof(lineindex)+(count-1)*sizeof(lineentry);
+  if (onheap)
+    ip = allocmem(size, FALSE);
+  else {
+    ip = malloc(size);
+  }
+  if (ip==NIL) return NIL;
+  ip->linecount = count;
+  p = base;
+  for (n = 0; n<count; n++) {
+    ip->lines[n].lineno = GET_LINENO(p);
+    ip->lines[n].lineaddr = p;
+    p+=GET_LINELEN(p);
+  }
+  return ip;
+}
+
+/*
+** 'clear_lineindex' discards the line number index and the table of
+** DATA lines of the program in memory. It has to be called whenever
+** lines are added, deleted or renumbered
+*/
+void clear_lineindex(void) {
+  free(progindex);
+  progindex = NIL;
+  progindex_valid = FALSE;
+  free(dataindex);
+  dataindex = NIL;
+  dataindex_valid = FALSE;
+}
+
+/*
+** 'get_progindex' returns the line number index of the program in
+** memory, building it if necessary. It returns NIL if there is no
+** index available
+*/
+static lineindex *get_progindex(void) {
+  if (!progindex_valid || progindex_start!=basicvars.start || progindex_top!=basicvars.top) {
+    clear_lineindex();
+    progindex = make_lineindex(basicvars.start, FALSE);
+    progindex_start = basicvars.start;
+    progindex_top = basicvars.top;
+    progindex_valid = TRUE;
+  }
+  return progindex;
+}
+
+/*
+** 'search_lineindex' returns a pointer to the first line in index 'ip'
+** whose line number is greater than or equal to 'lineno'. The end marker
+** is the last entry in the table so something is always found
+*/
+static byte *search_lineindex(lineindex *ip, int32 lineno) {
+  int32 low = 0, high = ip->linecount-1;
+  while (low<high) {
+    int32 mid = (low+high)/2;
+    if (ip->lines[mid].lineno<lineno)
+      low = mid+1;
+    else {
+      high = mid;
+    }
+  }
+  return ip->lines[low].lineaddr;
+}
+
+/*
+** 'search_lineaddr' returns a pointer to the start of the line in
+** index 'ip' that contains address 'wanted'
+*/
+static byte *search_lineaddr(lineindex *ip, byte *wanted) {
+  int32 low = 0, high = ip->linecount-1;
+  while (low<high) {
+    int32 mid = (low+high+1)/2;
+    if (ip->lines[mid].lineaddr<=wanted)
+      low = mid;
+    else {
+      high = mid-1;
+    }
+  }
+  return ip->lines[low].lineaddr;
+}
+
+/*
+** 'search_lineentry' returns the number of the first entry in index
+** 'ip' whose line starts at or after address 'wanted'. The end marker
+** is the last entry in the table so something is always found
+*/
+static int32 search_lineentry(lineindex *ip, byte *wanted) {
+  int32 low = 0, high = ip->linecount-1;
+  while (low<high) {
+    int32 mid = (low+high)/2;
+    if (ip->lines[mid].lineaddr<wanted)
+      low = mid+1;
+    else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/*
+** 'make_dataindex' builds a table of the lines in the program in memory
+** whose first statement is 'DATA', in the same form as a line number
+** index. The end of the program is the last entry. It returns NIL if
+** there is no memory for the table
+*/
+static lineindex *make_dataindex(void) {
+  lineindex *ip;
+  byte *p;
+  int32 count;
+
+  count = 1;    /* Count includes the end marker */
+  for (p = basicvars.start; !AT_PROGEND(p); p+=GET_LINELEN(p)) {
+    if (*FIND_EXEC(p)==BASTOKEN_DATA) count++;
+  }
+  ip = malloc(sizeof(lineindex)+(count-1)*sizeof(lineentry));
+  if (ip==NIL) return NIL;
+  ip->linecount = count;
+  count = 0;
+  for (p = basicvars.start; !AT_PROGEND(p); p+=GET_LINELEN(p)) {
+    if (*FIND_EXEC(p)==BASTOKEN_DATA) {
+      ip->lines[count].lineno = GET_LINENO(p);
+      ip->lines[count].lineaddr = p;
+      count++;
+    }
+  }
+  ip->lines[count].lineno = GET_LINENO(p);
+  ip->lines[count].lineaddr = p;
+  return ip;
+}
+
+/*
+** 'find_dataline' returns a pointer to the first line at or after the
+** one at 'p' whose first statement is 'DATA' or to the end of the program
+** or library if there is not one. Lines in the program in memory are found
+** using the table of DATA lines
+*/
+byte *find_dataline(byte *p) {
+  if (p>=basicvars.start && p<=basicvars.top) {
+    if (!dataindex_valid || dataindex_start!=basicvars.start || dataindex_top!=basicvars.top) {
+      free(dataindex);
+      dataindex = make_dataindex();
+      dataindex_start = basicvars.start;
+      dataindex_top = basicvars.top;
+      dataindex_valid = TRUE;
+    }
+    if (dataindex!=NIL) return dataindex->lines[search_lineentry(dataindex, p)].lineaddr;
+  }
+  while (!AT_PROGEND(p) && *FIND_EXEC(p)!=BASTOKEN_DATA) p+=GET_LINELEN(p);
+  return p;
+}
+
+/*
+** 'skip_lines' returns a pointer to the line 'count' lines after the one
+** at 'p' or to the end of the program or library if there are fewer
+** lines than that left
+*/
+byte *skip_lines(byte *p, int32 count) {
+  lineindex *ip;
+  if (count<=0) return p;
+  if (p>=basicvars.start && p<=basicvars.top && (ip = get_progindex())!=NIL) {
+    int32 n = search_lineentry(ip, p);
+    if (ip->lines[n].lineaddr==p) {     /* 'p' is the start of a line in the index */
+      n = (count>=ip->linecount-1-n) ? ip->linecount-1 : n+count;
+      return ip->lines[n].lineaddr;
+    }
+  }
+  while (!AT_PROGEND(p) && count>0) {
+    p+=GET_LINELEN(p);
+    count--;
+  }
+  return p;
+}
+
 /*
 ** 'find_linestart' finds the start of the line into which 'wanted'
 ** points. It returns a pointer to the start of the line or NIL if
@@ -243,21 +460,27 @@ library *find_library(byte *wanted) {
 ** libraries that have been loaded.
 ** There is no pointer kept to the start of the current line, nor is
 ** it possible to scan backwards through the line to find its start.
-** All that can be done is to scan from the start of the program.
+** The line number index is used if there is one, otherwise all that
+** can be done is to scan from the start of the program.
 ** Luckily this function is only needed in the error handling and
 ** trace code
 */
 byte *find_linestart(byte *wanted) {
   byte *p, *last;
   library *lp;
+  lineindex *ip;
   p = NIL;
-  if (wanted>=basicvars.page && wanted<basicvars.top)   /* Address is in loaded program */
+  if (wanted>=basicvars.page && wanted<basicvars.top) { /* Address is in loaded program */
     p = basicvars.start;
+    ip = get_progindex();
+  }
   else {
     lp = find_library(wanted);  /* Check if it is in a library */
     if (lp==NIL) return NIL;    /* Could not find where address points */
     p = lp->libstart;   /* 'wanted' points into a library */
+    ip = lp->libindex;
   }
+  if (ip!=NIL) return search_lineaddr(ip, wanted);
   last = p;
   while (p<=wanted) {
     last = p;
@@ -282,11 +505,14 @@ byte *find_linestart(byte *wanted) {
 */
 byte *find_line(int32 lineno) {
   byte *p;
+  lineindex *ip;
 
   if (basicvars.runflags.running) {     /* Running program => search program or library */
     byte *cp = basicvars.current;     /* This is just to reduce the amount of typing */
-    if (cp>=basicvars.page && cp<basicvars.top)         /* Check program for line */
+    if (cp>=basicvars.page && cp<basicvars.top) {       /* Check program for line */
       p = basicvars.start;
+      ip = get_progindex();
+    }
     else {      /* Check libraries */
       library *lp = find_library(cp);
       if (lp==NIL) {
@@ -294,10 +520,13 @@ byte *find_line(int32 lineno) {
         return NULL;
       }
       p = lp->libstart;
+      ip = lp->libindex;
     }
   } else {        /* Not running a program - Line can only be in the program in memory */
     p = basicvars.start;
+    ip = get_progindex();
   }
+  if (ip!=NIL) return search_lineindex(ip, lineno);
   while (GET_LINENO(p)<lineno) p+=GET_LINELEN(p);
   return p;
 }
@@ -54,6 +54,10 @@ extern byte *skip(byte *);
 extern char *tocstring(char *, int32);
 extern byte *find_line(int32);
 extern byte *find_linestart(byte *);
+extern lineindex *make_lineindex(byte *, boolean);
+extern void clear_lineindex(void);
+extern byte *find_dataline(byte *);
+extern byte *skip_lines(byte *, int32);
 extern library *find_library(byte *);
 extern void show_byte(size_t, size_t);
 extern void show_word(size_t, size_t);
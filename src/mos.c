@@ -83,6 +83,9 @@
 #include "screen.h"
 #include "keyboard.h"
 #include "miscprocs.h"
+#include "statement.h"
+#include "strings.h"
+#include "variables.h"
 
 #ifdef TARGET_RISCOS
 #include "kernel.h"
@@ -181,6 +184,108 @@ static void show_meminfo() {
   if (matrixflags.gpio) emulate_printf("  GPIO interface mapped at &" FMT_SZX "\r\n", matrixflags.gpiomem);
 }
 
+/*
+** Statistics read by '*STATS' and 'SYS "Brandy_Stats"'. The counters
+** are kept in 'basicvars.stats' and run from when the interpreter starts
+** or they are cleared. The rest are worked out when they are read
+*/
+#define STAT_STRALLOCS   0
+#define STAT_STRFREES    1
+#define STAT_STRBYTES    2
+#define STAT_COLLECTIONS 3
+#define STAT_SHORTFREE   4
+#define STAT_LONGINUSE   5
+#define STAT_LONGFREE    6
+#define STAT_HEAPUSED    7
+#define STAT_HEAPFREE    8
+#define STAT_STACKUSED   9
+#define STAT_STACKMAX    10
+#define STAT_VARIABLES   11
+#define STAT_ARRAYS      12
+#define STAT_PROCCALLS   13
+#define STAT_FNCALLS     14
+#define STAT_EVALS       15
+#define STAT_BYTESREAD   16
+#define STAT_BYTESWRITTEN 17
+#define STATCOUNT        18
+
+static char *statnames[STATCOUNT] = {
+  "String allocations", "String frees", "String bytes requested", "String collections",
+  "Short string bytes free", "Long string bytes in use", "Long string bytes free",
+  "Heap bytes in use", "Free memory", "Stack bytes in use", "Stack high-water mark",
+  "Variables", "Arrays", "PROC calls", "FN calls", "EVAL calls",
+  "File bytes read", "File bytes written"
+};
+
+/*
+** 'mos_readstat' returns the value of statistic number 'item' and sets
+** 'name' to its description. If there is no such statistic, the name
+** is set to an empty string and the value returned is zero
+*/
+uint64 mos_readstat(int32 item, char **name) {
+  size_t shortfree, longinuse, longfree, stackused;
+  int32 vars, arrays;
+
+  if (item<0 || item>=STATCOUNT) {
+    *name = "";
+    return 0;
+  }
+  *name = statnames[item];
+  switch (item) {
+  case STAT_STRALLOCS:   return basicvars.stats.stringallocs;
+  case STAT_STRFREES:    return basicvars.stats.stringfrees;
+  case STAT_STRBYTES:    return basicvars.stats.stringbytes;
+  case STAT_COLLECTIONS: return basicvars.stats.collections;
+  case STAT_SHORTFREE: case STAT_LONGINUSE: case STAT_LONGFREE:
+    string_memory(&shortfree, &longinuse, &longfree);
+    if (item==STAT_SHORTFREE) return shortfree;
+    return item==STAT_LONGINUSE ? longinuse : longfree;
+  case STAT_HEAPUSED:    return basicvars.vartop-basicvars.lomem;
+  case STAT_HEAPFREE:    return basicvars.stacktop.bytesp-basicvars.vartop;
+  case STAT_STACKUSED:   return basicvars.himem-basicvars.stacktop.bytesp;
+  case STAT_STACKMAX:
+    stackused = basicvars.himem-basicvars.stacktop.bytesp;
+    return stackused>basicvars.stats.stackmax ? stackused : basicvars.stats.stackmax;
+  case STAT_VARIABLES: case STAT_ARRAYS:
+    count_variables(&vars, &arrays);
+    return item==STAT_VARIABLES ? vars : arrays;
+  case STAT_PROCCALLS:   return basicvars.stats.proccalls;
+  case STAT_FNCALLS:     return basicvars.stats.fncalls;
+  case STAT_EVALS:       return basicvars.stats.evals;
+  case STAT_BYTESREAD:   return basicvars.stats.bytesread;
+  default:               return basicvars.stats.byteswritten;
+  }
+}
+
+/*
+** 'mos_clearstats' sets the counters in 'basicvars.stats' to zero. The
+** stack high-water mark starts again from the stack in use now
+*/
+void mos_clearstats(void) {
+  memset(&basicvars.stats, 0, sizeof(basicvars.stats));
+  basicvars.stats.stackmax = basicvars.himem-basicvars.stacktop.bytesp;
+}
+
+/*
+ * *STATS - show the memory and run time statistics
+ */
+static void cmd_stats(char *command) {
+  int32 n;
+  char *name;
+  uint64 value;
+
+  while (*command == ' ') command++;            // Skip spaces
+  if (!strncasecmp(command, "clear", 5) && (command[5] == 0 || command[5] == ' ')) {
+    mos_clearstats();
+    return;
+  }
+  if (*command) error(ERR_BADSYNTAX, "STATS (<Clear>)");
+  for (n=0; n<STATCOUNT; n++) {
+    value = mos_readstat(n, &name);
+    emulate_printf("  %-24s %llu\r\n", name, (unsigned long long)value);
+  }
+}
+
 static void cmd_brandyinfo() {
   emulate_printf("\r\n%s\r\n", IDSTRING);
 #ifdef BRANDY_GITCOMMIT
@@ -648,6 +753,8 @@ void mos_oscli(char *command, char *respfile, FILE *respfh) {
   if (respfile==NIL) {  /* Command output goes to normal place */
     if (!strncasecmp(command, "brandyinfo", 10)) {
       cmd_brandyinfo();
+    } else if (!strncasecmp(command, "stats", 5)) {
+      cmd_stats(command+5);
     } else if ( (!strncasecmp(command, "refresh", 7)) ||
                 (!strncasecmp(command, "fullscreen", 10)) ||
                 (!strncasecmp(command, "wintitle", 8)) ) {
@@ -803,16 +910,20 @@ void mos_wrtime(int32 time) {
 ** depends on the underlying OS.
 ** This code was supplied by Jeff Doggett, and modified
 ** by Michael McConnell
-** Further modified by moving code into brandy.c and running in a
-** separate thread that updates basicvars.centiseconds.
+** The clock is read when it is needed rather than being updated by
+** a thread. clock_gettime() is handled in user space on most systems
+** so this is cheap.
 */
 
 int64 mos_centiseconds(void) {
+  struct timespec tv;
+  clock_gettime(basicvars.clocktype, &tv);
+  basicvars.centiseconds = (((uint64)tv.tv_sec * 100) + ((uint64)tv.tv_nsec / 10000000));
   return basicvars.centiseconds;
 }
 
 int32 mos_rdtime(void) {
-  return ((int32) (basicvars.centiseconds - startime));
+  return ((int32) (mos_centiseconds() - startime));
 }
 
 /*
@@ -820,7 +931,7 @@ int32 mos_rdtime(void) {
 ** The effects of 'TIME=' are emulated here
 */
 void mos_wrtime (int32 time) {
-  startime = (basicvars.centiseconds - time);
+  startime = (mos_centiseconds() - time);
 }
 
 #endif
@@ -1158,19 +1269,24 @@ void mos_waitdelay(int32 time) {
 ** 'time' is the time to wait in centiseconds.
 */
 void mos_waitdelay(int32 time) {
-  int64 tbase;
+  int64 tbase, left;
+  struct timespec delay;
 
   if (time<=0) return;                  /* Nothing to do */
+  flush_screen();                       /* Show what has been output before waiting */
   tbase=mos_centiseconds();
-  while(mos_centiseconds() < tbase + time) {
+  while((left = tbase + time - mos_centiseconds()) > 0) {
 #ifdef USE_SDL
     if (basicvars.escape) {
       time=0;
       error(ERR_ESCAPE);
       return;
     }
+    left = 1;                           /* Check for Escape every centisecond */
 #endif /* USE_SDL */
-    usleep(2000);
+    delay.tv_sec = left / 100;
+    delay.tv_nsec = (left % 100) * 10000000;
+    nanosleep(&delay, NIL);
   }
 }
 #endif /* DJGPP, WIN32 or AMIGA cascade */
@@ -1263,7 +1379,7 @@ static unsigned int cmd_parse_dec(char** text) {
 }
 #endif /* !TARGET_RISCOS */
 
-#ifdef USE_SDL /* This code doesn't depend on SDL, but it's currently only called by code that does depend on it */
+#if defined(USE_SDL) || defined(TARGET_UNIX) /* Only called by the SDL commands and *PROFILE */
 static unsigned int cmd_parse_num(char** text) {
   unsigned int ByteVal;
   char *command;
@@ -1316,6 +1432,9 @@ static unsigned int cmd_parse_num(char** text) {
 #define CMD_VOICES          31
 #define CMD_POINTER         32
 #define CMD_BRANDYINFO      33
+#define CMD_PROFILE         34
+#define CMD_COVERAGE        35
+#define CMD_STATS           36
 #define HELP_BASIC        1024
 #define HELP_HOST         1025
 #define HELP_MOS          1026
@@ -1407,6 +1526,9 @@ void make_cmdtab(){
   add_cmd( "load",         CMD_LOAD         );
   add_cmd( "save",         CMD_SAVE         );
   add_cmd( "brandyinfo",   CMD_BRANDYINFO   );
+  add_cmd( "profile",      CMD_PROFILE      );
+  add_cmd( "coverage",     CMD_COVERAGE     );
+  add_cmd( "stats",        CMD_STATS        );
 #ifdef USE_SDL
   add_cmd( "volume",       CMD_VOLUME       );
   add_cmd( "channelvoice", CMD_CHANNELVOICE );
@@ -1750,6 +1872,11 @@ static void cmd_help(char *command)
       emulate_printf("  ScreenLoad <filename.bmp>\r\n");
       emulate_printf("  ScreenSave <filename.bmp>\r\n");
 #endif /* USE_SDL */
+      emulate_printf("  Coverage   (<On|Off|Clear|List (<file>)>)\r\n");
+#ifdef TARGET_UNIX
+      emulate_printf("  Profile    (<On (<rate>)|Off|Clear|Lines (<file>)|Save <file>>)\r\n");
+#endif
+      emulate_printf("  Stats      (<Clear>)\r\n");
       emulate_printf("  WinTitle   <window title>\r\n");
       break;
     case HELP_MEMINFO:
@@ -1762,6 +1889,34 @@ static void cmd_help(char *command)
       emulate_printf("  Voices\r\n");
       emulate_printf("  Volume       <n>\r\n");
       break;
+#endif
+    case CMD_STATS:
+      emulate_printf("Syntax: *Stats (<Clear>)\r\n");
+      emulate_printf("  This shows counts of string allocations, PROC and FN calls, EVAL calls and\r\n");
+      emulate_printf("  file bytes read and written, with the memory used by strings, variables\r\n");
+      emulate_printf("  and the Basic stack. Clear sets the counts to zero.\r\n");
+      break;
+    case CMD_COVERAGE:
+      emulate_printf("Syntax: *Coverage (<On|Off|Clear|List (<file>)>)\r\n");
+      emulate_printf("  This counts the statements run in each line of the program.\r\n");
+      emulate_printf("  On:      Start counting.\r\n");
+      emulate_printf("  Off:     Stop counting. The counts are kept.\r\n");
+      emulate_printf("  Clear:   Set the counts to zero.\r\n");
+      emulate_printf("  List:    List the program with the counts on the screen or in <file>.\r\n");
+      emulate_printf("           This is the default.\r\n");
+      break;
+#ifdef TARGET_UNIX
+    case CMD_PROFILE:
+      emulate_printf("Syntax: *Profile (<On (<rate>)|Off|Clear|Lines (<file>)|Save <file>>)\r\n");
+      emulate_printf("  This controls the sampling profiler.\r\n");
+      emulate_printf("  On:      Start taking <rate> samples a second of CPU time, default 1000.\r\n");
+      emulate_printf("  Off:     Stop taking samples.\r\n");
+      emulate_printf("  Clear:   Discard the samples taken so far.\r\n");
+      emulate_printf("  Lines:   List the samples for each line, busiest first, on the screen\r\n");
+      emulate_printf("           or in <file>. This is the default.\r\n");
+      emulate_printf("  Save:    Write the samples to <file> as collapsed stacks for flame graph\r\n");
+      emulate_printf("           tools.\r\n");
+      break;
 #endif
     case CMD_WINTITLE:
       emulate_printf("Syntax: *WinTitle <window title>\r\n");
@@ -1937,6 +2092,68 @@ static void cmd_spool(char *command, int append) {
   }
 }
 
+/*
+ * *PROFILE - control the sampling profiler
+ */
+static void cmd_profile(char *command) {
+#ifdef TARGET_UNIX
+  char option[8];
+  int length = 0;
+
+  while (*command == ' ') command++;            // Skip spaces
+  while (length < 7 && isalpha(*command)) option[length++] = tolower(*command++);
+  option[length] = 0;
+  while (*command == ' ') command++;            // Skip spaces
+  if ((command[0] == '"') && (command[strlen(command)-1] == '"')) {
+    command[strlen(command)-1] = '\0';
+    command++;
+  }
+  if (length == 0 || !strcmp(option, "lines")) {
+    profile_lines(*command ? command : NIL);
+  } else if (!strcmp(option, "on")) {
+    profile_start(*command ? cmd_parse_num(&command) : 0);
+  } else if (!strcmp(option, "off")) {
+    profile_stop();
+  } else if (!strcmp(option, "clear")) {
+    profile_clear();
+  } else if (!strcmp(option, "save") && *command) {
+    profile_save(command);
+  } else {
+    error(ERR_BADSYNTAX, "PROFILE (<On (<rate>)|Off|Clear|Lines (<file>)|Save <file>>)");
+  }
+#else
+  error(ERR_NOPROFILE);
+#endif
+}
+
+/*
+ * *COVERAGE - control the counting of the statements run in each line
+ */
+static void cmd_coverage(char *command) {
+  char option[8];
+  int length = 0;
+
+  while (*command == ' ') command++;            // Skip spaces
+  while (length < 7 && isalpha(*command)) option[length++] = tolower(*command++);
+  option[length] = 0;
+  while (*command == ' ') command++;            // Skip spaces
+  if ((command[0] == '"') && (command[strlen(command)-1] == '"')) {
+    command[strlen(command)-1] = '\0';
+    command++;
+  }
+  if (length == 0 || !strcmp(option, "list")) {
+    count_list(*command ? command : NIL);
+  } else if (!strcmp(option, "on") && !*command) {
+    count_start();
+  } else if (!strcmp(option, "off") && !*command) {
+    count_stop();
+  } else if (!strcmp(option, "clear") && !*command) {
+    count_clear();
+  } else {
+    error(ERR_BADSYNTAX, "COVERAGE (<On|Off|Clear|List (<file>)>)");
+  }
+}
+
 /*
  * *QUIT
  * Exit interpreter
@@ -2170,6 +2387,9 @@ void mos_oscli(char *command, char *respfile, FILE *respfh) {
       case CMD_NEWMODE:      cmd_newmode(command+7); return;
       case CMD_REFRESH:      cmd_refresh(command+7); return;
       case CMD_BRANDYINFO:   cmd_brandyinfo(); return;
+      case CMD_PROFILE:      cmd_profile(command+7); return;
+      case CMD_COVERAGE:     cmd_coverage(command+8); return;
+      case CMD_STATS:        cmd_stats(command+5); return;
 
       case CMD_LOAD:         cmd_load(command+4); return;
       case CMD_SAVE:         cmd_save(command+4); return;
@@ -2337,7 +2557,7 @@ static void native_oscli(char *command, char *respfile, FILE *respfh) {
     }
     pclose(sout);
 #else
-    fflush(stdout);                     /* Make sure everything has been output */
+    flush_screen();                     /* Make sure everything has been output */
     fflush(stderr);
     basicvars.retcode = system(cmdbuf);
     find_cursor();                      /* Figure out where the cursor has gone to */
@@ -2407,7 +2627,7 @@ static void native_oscli(char *command, char *respfile, FILE *respfh) {
       emulate_vdu(getChar);
     }
 #else /* !USE_SDL */
-    fflush(stdout);                     /* Make sure everything has been output */
+    flush_screen();                     /* Make sure everything has been output */
     fflush(stderr);
     basicvars.retcode = system(cmdbuf);
     find_cursor();                      /* Figure out where the cursor has gone to */
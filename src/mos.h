@@ -41,6 +41,8 @@ extern void  mos_call(int32, int32, int32 []);
 extern int32 mos_usr(int32);
 extern void  mos_sys(size_t, sysparm[], size_t[], size_t*);
 extern size_t mos_getswinum(char *, int32, int32);
+extern uint64 mos_readstat(int32, char **);
+extern void  mos_clearstats(void);
 extern void  mos_setend(int32);
 extern void  mos_waitdelay(int32);
 extern void  mos_mouse_on(int32);
@@ -43,6 +43,7 @@
 #include "screen.h"
 #include "keyboard.h"
 #include "miscprocs.h"
+#include "fileio.h"
 #ifdef USE_SDL
 #include "SDL.h"
 #include "SDL_syswm.h"
@@ -207,6 +208,42 @@ static void *get_dladdr(size_t nameptr, void *libhandle, int32 xflag) {
 #endif
   return (dlsh);
 }
+
+/*
+** 'get_dlcalladdr' returns the address of the function named in a
+** SYS "Brandy_dlcall". Libraries opened by Brandy_dlopen are never
+** closed so the address of a symbol does not change once found. The
+** addresses are kept in a small hash table keyed on the name so that
+** calling the same function again does not need another dlsym().
+*/
+#define DLCACHESIZE 64
+
+static struct {
+  char *name;
+  void *addr;
+} dlcache[DLCACHESIZE];
+
+static void *get_dlcalladdr(size_t nameptr, int32 xflag) {
+  char *name = (char *)nameptr, *copy;
+  uint32 hash = 5381;
+  int32 n;
+  void *dlsh;
+
+  for (n=0; name[n] != '\0'; n++) hash = hash*33 + (byte)name[n];
+  hash = hash % DLCACHESIZE;
+  if (dlcache[hash].name != NULL && !strcmp(dlcache[hash].name, name)) return dlcache[hash].addr;
+  dlsh = get_dladdr(nameptr, NULL, xflag);
+  if (dlsh != (void *)-1) {
+    copy = malloc(n+1);
+    if (copy != NULL) {
+      memcpy(copy, name, n+1);
+      free(dlcache[hash].name);
+      dlcache[hash].name = copy;
+      dlcache[hash].addr = dlsh;
+    }
+  }
+  return (dlsh);
+}
 #endif /* __clang__ */
 #endif /* TARGET_UNIX | TARGET_MINGW */
 
@@ -696,8 +733,7 @@ void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag,
         size_t (*dlsh)(size_t, size_t,size_t,size_t,size_t,size_t,size_t,size_t,
                         size_t,size_t,size_t,size_t,size_t,size_t,size_t);
 
-        dlerror(); /* Flush the error state */
-        *(void **)(&dlsh)=get_dladdr(inregs[0].i, NULL, xflag);
+        *(void **)(&dlsh)=get_dlcalladdr(inregs[0].i, xflag);
         if (dlsh != (void *)-1) outregs[0]=do_syscall(dlsh, inregs);
       }
 #else
@@ -826,6 +862,21 @@ void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag,
     case SWI_Brandy_AllowLowercase:
       matrixflags.lowercasekeywords = inregs[0].i;
       break;
+    case SWI_Brandy_Stats: {    /* R0 = statistic number or -1 to clear the counters */
+      char *name;
+      if ((int32)inregs[0].i == -1) {
+        mos_clearstats();
+        outregs[0] = 0;
+        outregs[1] = (size_t)"";
+      } else {
+        outregs[0] = (size_t)mos_readstat(inregs[0].i, &name);
+        outregs[1] = (size_t)name;
+      }
+      break;
+    }
+    case SWI_Brandy_NetWait:    /* R0 = list of handle and event pairs, R1 = number of pairs, R2 = timeout in cs */
+      outregs[0] = fileio_wait((int32 *)inregs[0].i, inregs[1].i, inregs[2].i);
+      break;
 // Raspberry Pi GPIO stuff below
     case SWI_RaspberryPi_GPIOInfo:
       outregs[0]=matrixflags.gpio; outregs[1]=(size_t)matrixflags.gpiomem;
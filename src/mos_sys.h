@@ -133,6 +133,8 @@ typedef struct {
 #define SWI_Brandy_TranslateFNames            0x140017
 #define SWI_Brandy_MemSet                     0x140018
 #define SWI_Brandy_AllowLowercase             0x140019
+#define SWI_Brandy_Stats                      0x14001A
+#define SWI_Brandy_NetWait                    0x14001B
 
 #define SWI_RaspberryPi_GPIOInfo                  0x140100
 #define SWI_RaspberryPi_GetGPIOPortMode           0x140101
@@ -236,6 +238,8 @@ static switable swilist[] = {
   {SWI_Brandy_TranslateFNames,                "Brandy_TranslateFNames"},
   {SWI_Brandy_MemSet,                         "Brandy_MemSet"},
   {SWI_Brandy_AllowLowercase,                 "Brandy_AllowLowercase"},
+  {SWI_Brandy_Stats,                          "Brandy_Stats"},
+  {SWI_Brandy_NetWait,                        "Brandy_NetWait"},
 
   {SWI_RaspberryPi_GPIOInfo,                  "RaspberryPi_GPIOInfo"},
   {SWI_RaspberryPi_GetGPIOPortMode,           "RaspberryPi_GetGPIOPortMode"},
@@ -37,6 +37,19 @@
 #endif
 #include <sys/types.h>
 #include <errno.h>
+#if defined(TARGET_LINUX)
+#define USE_EPOLL               /* Wait for sockets with epoll */
+#include <sys/epoll.h>
+#include <time.h>
+#elif defined(TARGET_RISCOS) || defined(TARGET_MINGW)
+#define USE_SELECT              /* Wait for sockets with select() */
+#ifndef TARGET_MINGW
+#include <sys/time.h>
+#endif
+#else
+#define USE_POLL                /* Wait for sockets with poll() */
+#include <poll.h>
+#endif
 #ifdef TARGET_RISCOS
 #include <ctype.h>
 #ifdef __TARGET_SCL__
@@ -60,7 +73,12 @@
 #endif /* TARGET_MINIX */
 
 #define MAXNETRCVLEN 65536
-#define MAXNETSOCKETS 4
+#define NETTABLESIZE 16         /* Initial size of the table of connections */
+#define NETBACKLOG SOMAXCONN    /* Number of connections that can wait to be accepted */
+#define NETWAITEVENTS 64        /* Number of events fetched at a time by epoll_wait() */
+#define NETWAITSLICE 100        /* Longest wait in milliseconds before checking for Escape */
+#define NETWANTSHIFT 8          /* 'net_wait' keeps the events asked for in the next byte up */
+#define NETREADYMASK 0xFF       /* Mask for the events that are ready */
 
 #ifdef TARGET_RISCOS
 #ifdef __TARGET_SCL__
@@ -68,13 +86,32 @@ extern int close(int);
 #endif
 #endif
 
-#ifndef NONET
-static int netsockets[MAXNETSOCKETS];
-static char netbuffer[MAXNETSOCKETS][MAXNETRCVLEN + 1];
-static int bufptr[MAXNETSOCKETS];
-static int bufendptr[MAXNETSOCKETS];
-#endif /* NONET */
-static int neteof[MAXNETSOCKETS];
+/*
+** The connections are kept in a table that is made bigger when it
+** fills up. The index of a connection in the table is its handle.
+** Each connection has its own receive buffer, which is allocated
+** the first time something is read from it
+*/
+typedef struct {
+  int socket;                   /* Socket, or -1 if the entry is not in use */
+  char *buffer;                 /* Receive buffer or NULL */
+  int bufptr;                   /* Offset of next byte to return from the buffer */
+  int bufendptr;                /* Offset of end of data in the buffer */
+  int eof;                      /* Set to 1 when the connection has been closed at the other end */
+  int listening;                /* Set to 1 if the socket waits for connections */
+#ifdef USE_EPOLL
+  uint32 events;                /* Events the socket is registered with epoll for, 0 = not registered */
+  uint32 waitgen;               /* Number of last 'net_wait' call that included the connection */
+  int waitslot;                 /* Index of the connection in the list passed to that call */
+#endif
+} netconn;
+
+static netconn *netconns;       /* Table of connections */
+static int netconnsize;         /* Number of entries in the table */
+#ifdef USE_EPOLL
+static int epollfd = -1;        /* epoll instance used by 'net_wait' */
+static uint32 waitgen;          /* Count of calls to 'net_wait' */
+#endif
 
 #ifdef __TARGET_SCL__
 /* SharedCLibrary is missing inet_aton(). Here'a an implementation */
@@ -156,9 +193,8 @@ void brandynet_init() {
 
   DEBUGFUNCMSGIN;
   matrixflags.networking = 1;
-  for (n=0; n<MAXNETSOCKETS; n++) {
-    netsockets[n]=bufptr[n]=bufendptr[n]=neteof[n]=0;
-    memset(netbuffer, 0, (MAXNETSOCKETS * (MAXNETRCVLEN+1)));
+  for (n=0; n<netconnsize; n++) {
+    if (netconns[n].socket != -1) brandynet_close(n);
   }
 #ifdef TARGET_MINGW
   if(WSAStartup(MAKEWORD(2,2), &wsaData)) matrixflags.networking=0;
@@ -184,19 +220,64 @@ void brandynet_init() {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** 'find_netslot' returns the index of an unused entry in the table of
+** connections, making the table bigger if they are all in use. It
+** returns -1 if there is no memory for a bigger table
+*/
+static int find_netslot(void) {
+  netconn *newtable;
+  int n, newsize;
+
+  for (n=0; n<netconnsize; n++) {
+    if (netconns[n].socket == -1) return(n);
+  }
+  newsize = netconnsize == 0 ? NETTABLESIZE : netconnsize*2;
+  newtable = realloc(netconns, newsize*sizeof(netconn));
+  if (newtable == NULL) return(-1);
+  netconns = newtable;
+  memset(&netconns[netconnsize], 0, (newsize-netconnsize)*sizeof(netconn));
+  for (n=netconnsize; n<newsize; n++) netconns[n].socket = -1;
+  n = netconnsize;
+  netconnsize = newsize;
+  return(n);
+}
+
+/*
+** 'set_nonblocking' puts socket 'mysocket' into non-blocking mode
+*/
+static void set_nonblocking(int mysocket) {
+#if defined(__TARGET_SCL__) || defined(TARGET_MINGW)
+  unsigned long opt = 1;
+#ifdef __TARGET_SCL__
+  socketioctl(mysocket, FIONBIO, &opt);   /* SharedCLibrary doesn't support fcntl */
+#else
+  ioctlsocket(mysocket, FIONBIO, &opt);
+#endif
+#else
+  int flags = fcntl(mysocket, F_GETFL, 0);
+  fcntl(mysocket, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+/*
+** 'add_netconn' fills in table entry 'n' for newly opened socket 'mysocket'
+*/
+static void add_netconn(int n, int mysocket) {
+  netconns[n].socket = mysocket;
+  netconns[n].bufptr = netconns[n].bufendptr = netconns[n].eof = netconns[n].listening = 0;
+#ifdef USE_EPOLL
+  netconns[n].events = netconns[n].waitgen = 0;
+#endif
+}
+
 int brandynet_connect(char *dest, char type, int reporterrors) {
 #if defined(TARGET_RISCOS) | defined(MINIX_OLDNET)
   char *host, *port;
   int n, mysocket, portnum, result;
-#ifndef __TARGET_SCL__
-  int flags;
-#endif
   struct sockaddr_in netdest;
   struct hostent *he = NULL;
   struct in_addr *inaddr = NULL;
-#ifdef __TARGET_SCL__
-  unsigned long opt;
-#endif
 
   DEBUGFUNCMSGIN;
   if(matrixflags.networking==0) {
@@ -204,10 +285,8 @@ int brandynet_connect(char *dest, char type, int reporterrors) {
     return(-1);
   }
 
-  for (n=0; n<MAXNETSOCKETS; n++) {
-    if (!netsockets[n]) break;
-  }
-  if (MAXNETSOCKETS == n) {
+  n = find_netslot();
+  if (n == -1) {
     if (reporterrors) error(ERR_NET_MAXSOCKETS);
     return(-1);
   }
@@ -245,15 +324,8 @@ int brandynet_connect(char *dest, char type, int reporterrors) {
   }
   free(inaddr);                              /* Don't need this any more */
 
-#ifdef __TARGET_SCL__
-  /* SharedCLibrary doesn't support fcntl */
-  opt=1;
-  socketioctl(mysocket, FIONBIO, &opt);
-#else
-  flags = fcntl(mysocket, F_GETFL, 0);
-  fcntl(mysocket, F_SETFL, flags | O_NONBLOCK);
-#endif
-  netsockets[n] = mysocket;
+  set_nonblocking(mysocket);
+  add_netconn(n, mysocket);
   DEBUGFUNCMSGOUT;
   return(n);
 
@@ -261,11 +333,8 @@ int brandynet_connect(char *dest, char type, int reporterrors) {
   char *host, *port;
   int n, mysocket=0, ret, sockres=-1;
   struct addrinfo hints, *addrdata, *rp;
-#ifdef TARGET_MINGW
-  unsigned long opt;
-#else
+#ifndef TARGET_MINGW
   struct timeval timeout;
-  int flags;
 #endif
 
   if(matrixflags.networking==0) {
@@ -273,10 +342,8 @@ int brandynet_connect(char *dest, char type, int reporterrors) {
     return(-1);
   }
 
-  for (n=0; n<MAXNETSOCKETS; n++) {
-    if (!netsockets[n]) break;
-  }
-  if (MAXNETSOCKETS == n) {
+  n = find_netslot();
+  if (n == -1) {
     if (reporterrors) error(ERR_NET_MAXSOCKETS);
     return(-1);
   }
@@ -336,23 +403,163 @@ int brandynet_connect(char *dest, char type, int reporterrors) {
     return(-1);
   }
 
-#ifdef TARGET_MINGW
-  opt=1;
-  ioctlsocket(mysocket, FIONBIO, &opt);
+  set_nonblocking(mysocket);
+  add_netconn(n, mysocket);
+  DEBUGFUNCMSGOUT;
+  return(n);
+#endif /* not RISCOS */
+}
+
+/*
+** 'brandynet_listen' opens a socket that waits for connections to the
+** address and port given by 'dest', which is of the form "host:port".
+** If the host is empty or '*', connections to any of the machine's
+** addresses are accepted. 'type' gives the protocol as for
+** 'brandynet_connect'. It returns the handle for the socket or -1 if it
+** could not be opened and 'reporterrors' is zero
+*/
+int brandynet_listen(char *dest, char type, int reporterrors) {
+  char *host, *port;
+  int n, mysocket = -1, one = 1;
+#if defined(TARGET_RISCOS) | defined(MINIX_OLDNET)
+  struct sockaddr_in netaddr;
 #else
-  flags = fcntl(mysocket, F_GETFL, 0);
-  fcntl(mysocket, F_SETFL, flags | O_NONBLOCK);
+  int ret, sockres = -1;
+  struct addrinfo hints, *addrdata, *rp;
 #endif
-  netsockets[n] = mysocket;
+
+  DEBUGFUNCMSGIN;
+  if(matrixflags.networking==0) {
+    if (reporterrors) error(ERR_NET_NOTSUPP);
+    return(-1);
+  }
+
+  n = find_netslot();
+  if (n == -1) {
+    if (reporterrors) error(ERR_NET_MAXSOCKETS);
+    return(-1);
+  }
+
+  host=strdup(dest);
+  if (host == NULL) {
+    error(ERR_NOROOM);
+    return(-1);
+  }
+  port=strchr(host,':');
+  if (port == NULL) {
+    free(host);
+    if (reporterrors) error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+  port[0]='\0';
+  port++;
+
+#if defined(TARGET_RISCOS) | defined(MINIX_OLDNET)
+  memset(&netaddr, 0, sizeof(netaddr));
+  netaddr.sin_family = AF_INET;
+  netaddr.sin_port = htons(atoi(port));
+  if (host[0] == '\0' || strcmp(host, "*") == 0)
+    netaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+  else if (inet_aton(host, &netaddr.sin_addr) == 0) {
+    free(host);
+    if (reporterrors) error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+  free(host);
+  mysocket = socket(AF_INET, SOCK_STREAM, 0);
+  if (mysocket == -1) {
+    if (reporterrors) error(ERR_NET_NOTSUPP);
+    return(-1);
+  }
+  setsockopt(mysocket, SOL_SOCKET, SO_REUSEADDR, (char *)&one, sizeof(one));
+  if (bind(mysocket, (struct sockaddr *)&netaddr, sizeof(struct sockaddr_in)) || listen(mysocket, NETBACKLOG)) {
+    close(mysocket);
+    if (reporterrors) error(ERR_NET_ADDRINUSE);
+    return(-1);
+  }
+#else
+  memset(&hints, 0, sizeof(hints));
+  if (type == '0') hints.ai_family=AF_UNSPEC;
+  else if (type == '4') hints.ai_family=AF_INET;
+  else if (type == '6') hints.ai_family=AF_INET6;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  hints.ai_protocol = IPPROTO_TCP;
+
+  ret=getaddrinfo(host[0] == '\0' || strcmp(host, "*") == 0 ? NULL : host, port, &hints, &addrdata);
+  free(host);
+  if(ret) {
+    if (reporterrors) error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+
+  for(rp = addrdata; rp != NULL; rp = rp->ai_next) {
+    mysocket = socket(rp->ai_family, SOCK_STREAM, 0);
+    if (mysocket == -1) continue;
+    setsockopt(mysocket, SOL_SOCKET, SO_REUSEADDR, (char *)&one, sizeof(one));
+#ifdef SO_REUSEPORT
+    setsockopt(mysocket, SOL_SOCKET, SO_REUSEPORT, (char *)&one, sizeof(one));      /* Let other programs share the port */
+#endif
+    sockres=bind(mysocket, rp->ai_addr, rp->ai_addrlen);
+    if (!sockres) sockres=listen(mysocket, NETBACKLOG);
+    if (!sockres)
+      break; /* success! */
+    close(mysocket);
+  }
+
+  freeaddrinfo(addrdata);
+
+  if (sockres) {
+    if (reporterrors) error(ERR_NET_ADDRINUSE);
+    return(-1);
+  }
+#endif
+  set_nonblocking(mysocket);
+  add_netconn(n, mysocket);
+  netconns[n].listening = 1;
+  DEBUGFUNCMSGOUT;
+  return(n);
+}
+
+/*
+** 'brandynet_accept' accepts the next connection waiting on the
+** listening socket 'handle', returning the handle for the new
+** connection or -1 if there are none waiting. It does not wait for
+** a connection to arrive
+*/
+int brandynet_accept(int handle) {
+  int n, mysocket;
+
+  DEBUGFUNCMSGIN;
+  n = find_netslot();
+  if (n == -1) error(ERR_NET_MAXSOCKETS);
+  mysocket = accept(netconns[handle].socket, NULL, NULL);
+  if (mysocket == -1) return(-1);
+  set_nonblocking(mysocket);
+  add_netconn(n, mysocket);
   DEBUGFUNCMSGOUT;
   return(n);
-#endif /* not RISCOS */
+}
+
+/*
+** 'net_listening' returns 1 if 'handle' is a socket that waits
+** for connections
+*/
+int net_listening(int handle) {
+  return(netconns[handle].listening);
 }
 
 int brandynet_close(int handle) {
   DEBUGFUNCMSGIN;
-  close(netsockets[handle]);
-  netsockets[handle] = neteof[handle] = 0;
+#ifdef TARGET_MINGW
+  closesocket(netconns[handle].socket);
+#else
+  close(netconns[handle].socket);       /* This also removes it from the epoll set */
+#endif
+  netconns[handle].socket = -1;
+  netconns[handle].eof = 0;
+  free(netconns[handle].buffer);
+  netconns[handle].buffer = NULL;
   DEBUGFUNCMSGOUT;
   return(0);
 }
@@ -363,40 +570,109 @@ int brandynet_close(int handle) {
 #endif
 
 static int net_get_something(int handle) {
+  netconn *cp = &netconns[handle];
   int retval = 0;
 
   DEBUGFUNCMSGIN;
-  bufendptr[handle] = recv(netsockets[handle], netbuffer[handle], MAXNETRCVLEN, MSG_DONTWAIT);
-  if (bufendptr[handle] == 0) {
+  if (cp->buffer == NULL) {
+    cp->buffer = malloc(MAXNETRCVLEN);
+    if (cp->buffer == NULL) error(ERR_NOROOM);
+  }
+  cp->bufendptr = recv(cp->socket, cp->buffer, MAXNETRCVLEN, MSG_DONTWAIT);
+  if (cp->bufendptr == 0) {
     retval=1; /* EOF - connection closed */
-    neteof[handle] = 1;
+    cp->eof = 1;
   }
-  if (bufendptr[handle] == -1) bufendptr[handle] = 0;
-  bufptr[handle] = 0;
+  if (cp->bufendptr == -1) cp->bufendptr = 0;
+  cp->bufptr = 0;
   DEBUGFUNCMSGOUT;
   return(retval);
 }
 
 int32 net_bget(int handle) {
+  netconn *cp = &netconns[handle];
   int value;
 
   DEBUGFUNCMSGIN;
-  if (neteof[handle]) return(-2);
-  if (bufptr[handle] >= bufendptr[handle]) {
+  if (cp->eof) return(-2);
+  if (cp->bufptr >= cp->bufendptr) {
     int retval=net_get_something(handle);
     if (retval) return(-2);                             /* EOF */
   }
-  if (bufptr[handle] >= bufendptr[handle]) return(-1);  /* No data available. EOF NOT set */
-  value=netbuffer[handle][(bufptr[handle])];
-  bufptr[handle]++;
+  if (cp->bufptr >= cp->bufendptr) return(-1);  /* No data available. EOF NOT set */
+  value=cp->buffer[cp->bufptr];
+  cp->bufptr++;
   DEBUGFUNCMSGOUT;
   return(value & 0xFF);
 }
 
+/*
+** 'net_getbulk' copies up to 'length' bytes that have arrived over
+** connection 'handle' into 'buffer', stopping after the character
+** 'delimiter' if it is not -1. The delimiter is not stored. It does not
+** wait for more data to arrive. The function returns the number of
+** bytes stored
+*/
+int32 net_getbulk(int handle, char *buffer, int32 length, int32 delimiter) {
+  netconn *cp = &netconns[handle];
+  int32 count = 0, size;
+  char *p;
+
+  DEBUGFUNCMSGIN;
+  while (count < length && !cp->eof) {
+    if (cp->bufptr >= cp->bufendptr) {
+      net_get_something(handle);
+      if (cp->bufptr >= cp->bufendptr) break;   /* Nothing more has arrived */
+    }
+    size = cp->bufendptr - cp->bufptr;
+    if (size > length - count) size = length - count;
+    p = delimiter >= 0 ? memchr(cp->buffer + cp->bufptr, delimiter, size) : NULL;
+    if (p != NULL) size = p - (cp->buffer + cp->bufptr);
+    memcpy(buffer + count, cp->buffer + cp->bufptr, size);
+    count += size;
+    cp->bufptr += size;
+    if (p != NULL) {
+      cp->bufptr++;     /* Skip the delimiter */
+      break;
+    }
+  }
+  DEBUGFUNCMSGOUT;
+  return(count);
+}
+
 boolean net_eof(int handle) {
   DEBUGFUNCMSGIN;
   DEBUGFUNCMSGOUT;
-  return(neteof[handle]);
+  return(netconns[handle].eof);
+}
+
+/*
+** 'net_send' sends 'length' bytes at 'data' over connection 'handle'.
+** The sockets are non-blocking, so if the data will not all fit in the
+** socket's buffer it waits until there is room for the rest. It returns
+** 1 if the data could not be sent and 0 if all went well
+*/
+static int net_send(int handle, const char *data, int32 length) {
+  int retval;
+  int32 events;
+
+  while (length > 0) {
+    retval=send(netconns[handle].socket, data, length, 0);
+    if (retval == -1) {
+#ifdef TARGET_MINGW
+      if (WSAGetLastError() != WSAEWOULDBLOCK) return(1);
+#else
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return(1);
+#endif
+      if (basicvars.escape) return(0);  /* Escape will be reported at the end of the statement */
+      events = NET_WRITABLE;
+      if (net_wait(&handle, &events, 1, -1) < 0) return(1);
+      continue;
+    }
+    data+=retval;
+    length-=retval;
+  }
+  return(0);
 }
 
 int net_bput(int handle, int32 value) {
@@ -406,13 +682,9 @@ int net_bput(int handle, int32 value) {
   DEBUGFUNCMSGIN;
   minibuf[0]=(value & 0xFFu);
   minibuf[1]=0;
-  retval=send(netsockets[handle], (const char *)&minibuf, 1, 0);
-  if (retval == -1) {
-    DEBUGFUNCMSGOUT;
-    return(1);
-  }
+  retval=net_send(handle, minibuf, 1);
   DEBUGFUNCMSGOUT;
-  return(0);
+  return(retval);
 }
 
 int net_bputstr(int handle, char *string, int32 length) {
@@ -420,14 +692,184 @@ int net_bputstr(int handle, char *string, int32 length) {
 
   DEBUGFUNCMSGIN;
   if (length == -1) length=strlen(string);
-  retval=send(netsockets[handle], string, length, 0);
-  if (retval == -1) {
-    DEBUGFUNCMSGOUT;
-    return(1);
+  retval=net_send(handle, string, length);
+  DEBUGFUNCMSGOUT;
+  return(retval);
+}
+
+/*
+** 'buffered_events' returns the events that can be reported for
+** connection 'handle' without waiting, that is, whether there is
+** data left in its buffer or the other end has closed the connection
+*/
+static int32 buffered_events(int handle, int32 wanted) {
+  netconn *cp = &netconns[handle];
+  if (!(wanted & NET_READABLE)) return(0);
+  if (cp->eof) return(NET_READABLE | NET_CLOSED);
+  return(cp->bufptr < cp->bufendptr ? NET_READABLE : 0);
+}
+
+/*
+** 'net_wait' waits until at least one of the 'count' connections in the
+** list 'handles' is ready. On entry the corresponding entry in 'events'
+** says what to wait for, 'NET_READABLE' and/or 'NET_WRITABLE', and on
+** exit it says which of those are ready, plus 'NET_CLOSED' if the
+** connection has been closed or has failed. 'timeout' is the longest
+** time to wait in centiseconds, or -1 to wait until something happens.
+** The function returns the number of connections that are ready, zero
+** if the time ran out first or Escape was pressed, or -1 if there was
+** an error.
+**
+** Under Linux all the connections that have been waited for are kept
+** in an epoll set, so that the cost of waiting does not go up with the
+** number of open connections. Connections not in the current list that
+** turn up are removed from the set again.
+*/
+#ifdef USE_EPOLL
+int net_wait(int *handles, int32 *events, int count, int32 timeout) {
+  struct epoll_event ev, ready[NETWAITEVENTS];
+  struct timespec now;
+  int n, got, found = 0, before, waitms;
+  int64 deadline = 0;
+  netconn *cp;
+
+  DEBUGFUNCMSGIN;
+  if (epollfd == -1) {
+    epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd == -1) return(-1);
   }
+  waitgen++;
+  for (n=0; n<count; n++) {
+    uint32 wanted;
+    cp = &netconns[handles[n]];
+    wanted = (events[n] & NET_READABLE ? EPOLLIN | EPOLLRDHUP : 0) | (events[n] & NET_WRITABLE ? EPOLLOUT : 0);
+    cp->waitgen = waitgen;
+    cp->waitslot = n;
+    if (wanted != cp->events && wanted != 0) {  /* Add the socket to the set or change what it is waiting for */
+      ev.events = wanted;
+      ev.data.u32 = handles[n];
+      if (epoll_ctl(epollfd, cp->events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, cp->socket, &ev) == -1) return(-1);
+      cp->events = wanted;
+    }
+    events[n] = buffered_events(handles[n], events[n]) | (events[n] << NETWANTSHIFT);
+    if (events[n] & NETREADYMASK) found++;
+  }
+  if (timeout >= 0) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    deadline = (int64)now.tv_sec*1000 + now.tv_nsec/1000000 + (int64)timeout*10;
+  }
+  do {
+    if (found > 0 || timeout == 0)
+      waitms = 0;
+    else if (timeout < 0)
+      waitms = NETWAITSLICE;
+    else {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      waitms = deadline - ((int64)now.tv_sec*1000 + now.tv_nsec/1000000);
+      if (waitms < 0) waitms = 0;
+      if (waitms > NETWAITSLICE) waitms = NETWAITSLICE;
+    }
+    before = found;
+    got = epoll_wait(epollfd, ready, NETWAITEVENTS, waitms);
+    if (got == -1 && errno != EINTR) return(-1);
+    for (n=0; n<got; n++) {
+      int32 *ep, result = 0;
+      cp = &netconns[ready[n].data.u32];
+      if (cp->socket == -1 || cp->waitgen != waitgen) {   /* Not being waited for - Take it out of the set */
+        if (cp->socket != -1) epoll_ctl(epollfd, EPOLL_CTL_DEL, cp->socket, &ev);
+        cp->events = 0;
+        continue;
+      }
+      ep = &events[cp->waitslot];
+      if (ready[n].events & EPOLLIN) result |= NET_READABLE;
+      if (ready[n].events & EPOLLOUT) result |= NET_WRITABLE;
+      if (ready[n].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) result |= NET_CLOSED | NET_READABLE | NET_WRITABLE;
+      result &= (*ep >> NETWANTSHIFT) | NET_CLOSED;
+      if (result != 0 && (*ep & NETREADYMASK) == 0) found++;
+      *ep |= result;
+    }
+    if (got == NETWAITEVENTS && found > before) continue;       /* There may be more events to collect */
+    if (found > 0 || basicvars.escape || waitms == 0) break;
+  } while (TRUE);
+  for (n=0; n<count; n++) events[n] &= NETREADYMASK;
   DEBUGFUNCMSGOUT;
-  return(0);
+  return(found);
 }
+#else
+int net_wait(int *handles, int32 *events, int count, int32 timeout) {
+  int n, got, found = 0, waitms;
+#ifdef USE_POLL
+  static struct pollfd *fds;
+  static int fdsize;
+#else
+  fd_set readset, writeset, errorset;
+  struct timeval tv;
+  int maxfd = 0;
+#endif
+
+  DEBUGFUNCMSGIN;
+#ifdef USE_POLL
+  if (count > fdsize) {
+    struct pollfd *newfds = realloc(fds, count*sizeof(struct pollfd));
+    if (newfds == NULL) return(-1);
+    fds = newfds;
+    fdsize = count;
+  }
+#endif
+  for (n=0; n<count; n++) {
+    int32 ready = buffered_events(handles[n], events[n]);
+    if (ready) found++;
+    events[n] = ready | (events[n] << NETWANTSHIFT);
+  }
+  do {
+    waitms = found > 0 ? 0 : timeout < 0 || timeout*10 > NETWAITSLICE ? NETWAITSLICE : timeout*10;
+    if (timeout > 0) timeout = timeout*10 > NETWAITSLICE ? timeout-NETWAITSLICE/10 : 0;
+#ifdef USE_POLL
+    for (n=0; n<count; n++) {
+      fds[n].fd = netconns[handles[n]].socket;
+      fds[n].events = (events[n] & (NET_READABLE << NETWANTSHIFT) ? POLLIN : 0) | (events[n] & (NET_WRITABLE << NETWANTSHIFT) ? POLLOUT : 0);
+      fds[n].revents = 0;
+    }
+    got = poll(fds, count, waitms);
+#else
+    FD_ZERO(&readset);
+    FD_ZERO(&writeset);
+    FD_ZERO(&errorset);
+    for (n=0; n<count; n++) {
+      int sock = netconns[handles[n]].socket;
+      if (events[n] & (NET_READABLE << NETWANTSHIFT)) FD_SET(sock, &readset);
+      if (events[n] & (NET_WRITABLE << NETWANTSHIFT)) FD_SET(sock, &writeset);
+      FD_SET(sock, &errorset);
+      if (sock > maxfd) maxfd = sock;
+    }
+    tv.tv_sec = waitms/1000;
+    tv.tv_usec = (waitms%1000)*1000;
+    got = select(maxfd+1, &readset, &writeset, &errorset, &tv);
+#endif
+    if (got == -1 && errno != EINTR) return(-1);
+    for (n=0; got > 0 && n<count; n++) {
+      int32 result = 0;
+#ifdef USE_POLL
+      if (fds[n].revents & POLLIN) result |= NET_READABLE;
+      if (fds[n].revents & POLLOUT) result |= NET_WRITABLE;
+      if (fds[n].revents & (POLLHUP | POLLERR)) result |= NET_CLOSED | NET_READABLE | NET_WRITABLE;
+#else
+      int sock = netconns[handles[n]].socket;
+      if (FD_ISSET(sock, &readset)) result |= NET_READABLE;
+      if (FD_ISSET(sock, &writeset)) result |= NET_WRITABLE;
+      if (FD_ISSET(sock, &errorset)) result |= NET_CLOSED | NET_READABLE | NET_WRITABLE;
+#endif
+      result &= (events[n] >> NETWANTSHIFT) | NET_CLOSED;
+      if (result != 0 && (events[n] & NETREADYMASK) == 0) found++;
+      events[n] |= result;
+    }
+    if (found > 0 || basicvars.escape || waitms == 0) break;
+  } while (TRUE);
+  for (n=0; n<count; n++) events[n] &= NETREADYMASK;
+  DEBUGFUNCMSGOUT;
+  return(found);
+}
+#endif
 
 #ifndef BRANDY_NOVERCHECK
 /* This function queries the Matrix Brandy web server to check for a newer
@@ -19,15 +19,27 @@
 */
 #ifndef BRANDY_NET_H
 #define BRANDY_NET_H
+
+/* Events used by 'net_wait' and 'fileio_wait' */
+#define NET_READABLE 1          /* Data can be read */
+#define NET_WRITABLE 2          /* Data can be written */
+#define NET_CLOSED 4            /* Connection has been closed or has failed */
+
 #ifndef NONET
 #include "common.h"
+
 extern void brandynet_init();
 extern int brandynet_connect(char *dest, char type, int reporterrors);
+extern int brandynet_listen(char *dest, char type, int reporterrors);
+extern int brandynet_accept(int handle);
+extern int net_listening(int handle);
 extern int brandynet_close(int handle);
 extern int32 net_bget(int handle);
+extern int32 net_getbulk(int handle, char *buffer, int32 length, int32 delimiter);
 extern boolean net_eof(int handle);
 extern int net_bput(int handle, int32 value);
 extern int net_bputstr(int handle, char *string, int32 length);
+extern int net_wait(int *handles, int32 *events, int count, int32 timeout);
 #ifndef BRANDY_NOVERCHECK
 extern int checkfornewer(void);
 #endif
@@ -204,6 +204,7 @@ extern void    emulate_moverect(int32, int32, int32, int32, int32, int32, boolea
 extern void    emulate_origin(int32, int32);
 extern void    emulate_wait(void);
 extern void    find_cursor(void);
+extern void    flush_screen(void);
 extern boolean init_screen(void);
 extern void    end_screen(void);
 extern void    set_wintitle(char *title);
@@ -35,6 +35,9 @@
 #include <ctype.h>
 #include "common.h"
 #include "target.h"
+#ifdef TARGET_UNIX
+#include <unistd.h>
+#endif
 #include "errors.h"
 #include "basicdefs.h"
 #include "scrcommon.h"
@@ -60,6 +63,8 @@
 **  SWI OS_WriteC.
 */
 
+static boolean ttyoutput;               /* TRUE if output is going to a terminal */
+
 static unsigned int vduflag(unsigned int flags) {
   return (vduflags & flags) ? 1 : 0;
 }
@@ -75,6 +80,13 @@ static void write_vduflag(unsigned int flags, int yesno) {
 void find_cursor(void) {
 }
 
+/*
+** 'flush_screen' makes sure that all output has been written
+*/
+void flush_screen(void) {
+  fflush(stdout);
+}
+
 /*
 ** 'set_cursor' sets the type of the text cursor
 */
@@ -82,11 +94,13 @@ void set_cursor(boolean underline) {
 }
 
 /*
-** 'echo_on' turns on the immediate echo of characters to the screen
+** 'echo_on' turns on the immediate echo of characters to the screen.
+** Output that is not going to a terminal is left in the stdout buffer
+** until the buffer fills or the interpreter waits for something
 */
 void echo_on(void) {
   write_vduflag(VDU_FLAG_ECHO,1);
-  fflush(stdout);
+  if (ttyoutput) fflush(stdout);
 }
 
 /*
@@ -128,11 +142,11 @@ void emulate_vdu(int32 charvalue) {
     if (charvalue>=' ') {               /* Most common case - print something */
       if (charvalue==DEL) charvalue = ' ';
       putchar(charvalue);
-      if (vduflag(VDU_FLAG_ECHO)) fflush(stdout);
+      if (vduflag(VDU_FLAG_ECHO) && ttyoutput) fflush(stdout);
       return;
     }
     else {      /* Control character - Found start of new VDU command */
-      if (!vduflag(VDU_FLAG_ECHO)) fflush(stdout);
+      if (!vduflag(VDU_FLAG_ECHO) && ttyoutput) fflush(stdout);
       vducmd = charvalue;
       vduneeded = vdubytes[charvalue];
       vdunext = 0;
@@ -202,13 +216,28 @@ void emulate_vdu(int32 charvalue) {
 }
 
 /*
-** 'emulate_vdustr' is called to print a string via the 'VDU driver'
+** 'emulate_vdustr' is called to print a string via the 'VDU driver'.
+** Runs of printable characters are written in one go when no VDU
+** command is in progress. Anything else goes through 'emulate_vdu'
 */
 void emulate_vdustr(char string[], int32 length) {
-  int32 n;
+  int32 n, start;
   if (length==0) length = strlen(string);
   echo_off();
-  for (n=0; n<length; n++) emulate_vdu(string[n]);      /* Send the string to the VDU driver */
+  n = 0;
+  while (n<length) {
+    if (vduneeded==0 && !vduflag(VDU_FLAG_DISABLE) && matrixflags.printer==NIL) {
+      start = n;
+      while (n<length && CAST(string[n], byte)>=' ' && string[n]!=DEL) n++;
+      if (n>start) {
+        fwrite(string+start, 1, n-start, stdout);
+        if (matrixflags.dospool) fwrite(string+start, 1, n-start, matrixflags.dospool);
+        continue;
+      }
+    }
+    emulate_vdu(string[n]);     /* Send the character to the VDU driver */
+    n++;
+  }
   echo_on();
 }
 
@@ -479,6 +508,15 @@ void emulate_origin(int32 x, int32 y) {
 ** interpreter to run)
 */
 boolean init_screen(void) {
+#ifdef TARGET_UNIX
+  ttyoutput = isatty(STDOUT_FILENO);
+#else
+  ttyoutput = TRUE;
+#endif
+  if (!ttyoutput && matrixflags.outbufsize>0) {     /* Give stdout a buffer of the size asked for */
+    char *outbuffer = malloc(matrixflags.outbufsize);
+    if (outbuffer!=NIL) setvbuf(stdout, outbuffer, _IOFBF, matrixflags.outbufsize);
+  }
   screenmode = USERMODE;
   vdunext = 0;
   vduneeded = 0;
@@ -490,6 +528,7 @@ boolean init_screen(void) {
 ** of the run
 */
 void end_screen(void) {
+  fflush(stdout);
 }
 
 int32 get_character_at_pos(int32 cx, int32 cy) {
@@ -325,7 +325,7 @@ void init_sound(){
     return;
   }
 
-  snd_inited = (unsigned int)basicvars.centiseconds;
+  snd_inited = (unsigned int)mos_centiseconds();
 
   for(i=0; i<8; i++){
     /* init all voices as 'synth wave' */
@@ -462,7 +462,7 @@ void sdl_sound(int32 channel, int32 amplitude, int32 pitch, int32 duration, int3
 
   if(delay)while(((snd_rd[cm1]-snd_wr[cm1]-2)&(SNDTABWIDTH-1)) <= 2) usleep(50000);
 
-  tnow = ((unsigned int)basicvars.centiseconds - snd_inited )/5; /* divide by 5 to covert centiseconds to 20ths */
+  tnow = ((unsigned int)mos_centiseconds() - snd_inited )/5; /* divide by 5 to covert centiseconds to 20ths */
 
   if(sndtime[cm1] < tnow )
      sndtime[cm1] = tnow;
@@ -554,7 +554,7 @@ void sdl_wrbeat(int32 beats){
   if( beats < 0) beats = 0;
 
   snd_beats = beats;
-  snd_tempo_basetime = ((unsigned int)basicvars.centiseconds - snd_inited );
+  snd_tempo_basetime = ((unsigned int)mos_centiseconds() - snd_inited );
 }
 
 int32 sdl_rdbeat(){
@@ -565,7 +565,7 @@ int32 sdl_rdbeat(){
   if( snd_beats <= 1 || snd_tempo <= 0)
     return 0;
 
-  beat = ((  ((unsigned int)basicvars.centiseconds - snd_inited ) - snd_tempo_basetime ) * snd_tempo ) >> 12;
+  beat = ((  ((unsigned int)mos_centiseconds() - snd_inited ) - snd_tempo_basetime ) * snd_tempo ) >> 12;
  
   if( beat <= 0 ) return 0;
 
@@ -586,7 +586,7 @@ void sdl_wrtempo(int32 tempo) {
   if(tempo < 0) tempo = 0;
 
   snd_tempo = tempo;
-  snd_tempo_basetime =((unsigned int)basicvars.centiseconds - snd_inited );
+  snd_tempo_basetime =((unsigned int)mos_centiseconds() - snd_inited );
 }
 
 int32 sdl_rdtempo() {
@@ -153,6 +153,17 @@ void dump(byte *sp) {
 
 #endif
 
+/*
+** 'note_stackuse' records the most memory seen in use on the Basic stack
+** for '*STATS'. It is called when PROC, FN and GOSUB return blocks,
+** operator stacks and local arrays are added as those are what make the
+** stack grow the most
+*/
+static void note_stackuse(void) {
+  size_t used = basicvars.himem-basicvars.stacktop.bytesp;
+  if (used>basicvars.stats.stackmax) basicvars.stats.stackmax = used;
+}
+
 /*
 ** 'make_opstack' is called to create a new operator stack. It also
 ** checks that there is enough room on the Basic stack to hold
@@ -169,6 +180,7 @@ size_t *make_opstack(void) {
     return NULL;
   }
   basicvars.stacktop.opstacksp->itemtype = STACK_OPSTACK;
+  note_stackuse();
 #ifdef DEBUG
   if (basicvars.debug_flags.stack) fprintf(stderr, "Create operator stack at %p\n", basicvars.stacktop.bytesp);
 #endif
@@ -372,6 +384,8 @@ fnprocinfo *push_proc(char *name, int32 count) {
   basicvars.stacktop.procsp->fnprocblock.parmcount = count;
   basicvars.stacktop.procsp->fnprocblock.fnprocname = name;
   basicvars.procstack = &basicvars.stacktop.procsp->fnprocblock;
+  basicvars.stats.proccalls+=1;
+  note_stackuse();
 #ifdef DEBUG
   if (basicvars.debug_flags.stack) fprintf(stderr, "Saving PROC return block at %p\n", basicvars.stacktop.procsp);
 #endif
@@ -396,6 +410,8 @@ void push_fn(char *name, int32 count) {
   basicvars.stacktop.fnsp->fnprocblock.parmcount = count;
   basicvars.stacktop.fnsp->fnprocblock.fnprocname = name;
   basicvars.procstack = &basicvars.stacktop.fnsp->fnprocblock;
+  basicvars.stats.fncalls+=1;
+  note_stackuse();
 #ifdef DEBUG
   if (basicvars.debug_flags.stack) fprintf(stderr, "Saving FN return block at %p\n", basicvars.stacktop.fnsp);
 #endif
@@ -414,6 +430,7 @@ void push_gosub(void) {
   basicvars.stacktop.gosubsp->gosublock.lastcall = basicvars.gosubstack;
   basicvars.stacktop.gosubsp->gosublock.retaddr = basicvars.current;
   basicvars.gosubstack = &basicvars.stacktop.gosubsp->gosublock;
+  note_stackuse();
 #ifdef DEBUG
   if (basicvars.debug_flags.stack) fprintf(stderr, "Saving GOSUB return block at %p\n", basicvars.stacktop.gosubsp);
 #endif
@@ -437,6 +454,7 @@ void *alloc_stackmem(size_t size) {
   basicvars.stacktop.bytesp = p;        /* Reset the stack pointer */
   basicvars.stacktop.locarraysp->itemtype = STACK_LOCARRAY;
   basicvars.stacktop.locarraysp->arraysize = size;
+  note_stackuse();
 #ifdef DEBUG
   if (basicvars.debug_flags.stack) fprintf(stderr, "Allocate memory on stack at %p, size=%lld\n", p, (int64)size);
 #endif
@@ -134,6 +134,13 @@ extern void debug_show_stackitemtype(int32);
 
 #define TOPITEMISFOR ((basicvars.stacktop.intsp->itemtype == STACK_INTFOR) || (basicvars.stacktop.intsp->itemtype == STACK_INT64FOR) || (basicvars.stacktop.intsp->itemtype == STACK_FLOATFOR))
 
+#define PUSH_INT(x) do { basicvars.stacktop.bytesp-=ALIGNSIZE(stack_int); \
+                         basicvars.stacktop.intsp->itemtype = STACK_INT; \
+                         basicvars.stacktop.intsp->intvalue = (x); } while (0)
+#define PUSH_FLOAT(x) do { basicvars.stacktop.bytesp-=ALIGNSIZE(stack_float); \
+                           basicvars.stacktop.floatsp->itemtype = STACK_FLOAT; \
+                           basicvars.stacktop.floatsp->floatvalue = (x); } while (0)
+
 #define INCR_INT(x) basicvars.stacktop.intsp->intvalue+=(x)
 #define INCR_FLOAT(x) basicvars.stacktop.floatsp->floatvalue+=(x)
 #define DECR_INT(x) basicvars.stacktop.intsp->intvalue-=(x)
@@ -50,6 +50,10 @@
 #include "assign.h"
 #include "statement.h"
 #include "keyboard.h"
+#ifdef TARGET_UNIX
+#include <signal.h>
+#include <sys/time.h>
+#endif
 #ifdef USE_SDL
 #include "graphsdl.h"
 extern threadmsg tmsg;
@@ -185,6 +189,392 @@ void trace_branch(byte *from, byte *to) {
   DEBUGFUNCMSGOUT;
 }
 
+/*
+** Sampling profiler
+** -----------------
+** '*PROFILE ON' starts an interval timer that counts the CPU time used
+** by the interpreter and raises SIGPROF every time the sampling period
+** has passed. The signal handler notes which line is being executed
+** and which PROCs and FNs are active and adds one to the count for
+** that combination in 'profsamples'. The handler cannot allocate memory
+** or call anything that might report an error so the table is allocated
+** when profiling starts and only pointers are stored in it. The lines
+** and names these point at only stay put until the variables are
+** cleared or the program is edited, so 'profile_collect' turns the
+** samples into text (the collapsed stack format used by flame graph
+** tools, for example "PROCmain;FNsum;line 120") whenever that is about
+** to happen and whenever control returns to the command line.
+*/
+#ifdef TARGET_UNIX
+#define PROFRATE 1000           /* Default number of samples per second */
+#define PROFDEPTH 16            /* Most PROC and FN calls noted in one sample */
+#define PROFSLOTS 16384         /* Size of the sample table. Must be a power of 2 */
+#define PROFSCAN 4096           /* Most tokens to skip when looking for the end of a line */
+#define PROFTEXTSIZE (PROFDEPTH*(MAXNAMELEN+5)+MAXNAMELEN+FNAMESIZE+32)
+
+typedef struct {
+  byte *where;                  /* End of line sampled or NIL if entry is unused */
+  int32 depth;                  /* Number of PROCs and FNs in 'calls' */
+  boolean truncated;            /* TRUE if there were more calls than PROFDEPTH */
+  char *calls[PROFDEPTH];       /* Names of active PROCs and FNs, innermost first */
+  uint32 count;                 /* Number of times this was seen */
+} profsample;
+
+typedef struct {
+  char *stack;                  /* Collapsed stack or NIL if entry is unused */
+  uint32 count;
+} profstack;
+
+static profsample *profsamples;         /* Samples not yet turned into text */
+static int32 profused;                  /* Number of entries in use in 'profsamples' */
+static profstack *profstacks;           /* Stacks seen so far */
+static int32 profstacksize;             /* Size of 'profstacks' */
+static int32 profstackcount;            /* Number of entries in use in 'profstacks' */
+static uint32 proftotal;                /* Samples taken */
+static uint32 proflost;                 /* Samples that would not fit in the table */
+static int profbusy;                    /* Set while the sample table is being used */
+static volatile boolean proflive;       /* TRUE while Basic code is being run */
+static boolean profiling;               /* TRUE if the timer is running */
+static char *proffile;                  /* File to write the stacks to at the end of the run */
+static byte profcmdline;                /* Stands in for the line when at the command line */
+static char proftext[PROFTEXTSIZE];
+
+/*
+** 'profile_sample' is the SIGPROF handler. It can be called on any
+** thread that is using CPU time on behalf of the interpreter, which
+** is why the table is guarded by 'profbusy'
+*/
+static void profile_sample(int signo) {
+  byte *where;
+  fnprocinfo *fp;
+  char *calls[PROFDEPTH];
+  int32 depth, n;
+  uint32 hash;
+  profsample *sp;
+
+  if (!proflive || profsamples == NIL || __sync_lock_test_and_set(&profbusy, 1)) return;
+  where = basicvars.current;
+  if (where == NIL || ((where < basicvars.page || where >= basicvars.top) && find_library(where) == NIL))
+    where = &profcmdline;
+  else {
+    byte *lineend = skip_toeol(where, PROFSCAN);
+    if (lineend != NIL) where = lineend;
+  }
+  hash = CAST((size_t)where >> 2, uint32);
+  fp = basicvars.procstack;
+  for (depth = 0; depth < PROFDEPTH && fp != NIL; depth++) {
+    if (CAST(fp, byte *) < basicvars.workspace || CAST(fp, byte *) >= basicvars.end) break;
+    calls[depth] = fp->fnprocname;
+    hash = hash*31+CAST((size_t)calls[depth] >> 3, uint32);
+    fp = fp->lastcall;
+  }
+  proftotal++;
+  n = hash & (PROFSLOTS-1);
+  while (TRUE) {
+    sp = &profsamples[n];
+    if (sp->where == NIL) {     /* New combination of line and calls */
+      if (profused >= PROFSLOTS/4*3) {
+        proflost++;
+        break;
+      }
+      sp->where = where;
+      sp->depth = depth;
+      sp->truncated = fp != NIL;
+      memcpy(sp->calls, calls, depth*sizeof(char *));
+      sp->count = 1;
+      profused++;
+      break;
+    }
+    if (sp->where == where && sp->depth == depth && !memcmp(sp->calls, calls, depth*sizeof(char *))) {
+      sp->count++;
+      break;
+    }
+    n = (n+1) & (PROFSLOTS-1);
+  }
+  __sync_lock_release(&profbusy);
+}
+
+/*
+** 'add_profstack' adds 'count' to the total for the collapsed stack
+** 'stack', adding it to the table if it has not been seen before
+*/
+static void add_profstack(char *stack, uint32 count) {
+  uint32 hash = 0;
+  int32 n;
+  char *cp;
+
+  if (profstackcount*2 >= profstacksize) {      /* Table is getting full - Make it bigger */
+    profstack *old = profstacks;
+    int32 oldsize = profstacksize;
+    profstacksize = oldsize == 0 ? 1024 : oldsize*2;
+    profstacks = calloc(profstacksize, sizeof(profstack));
+    if (profstacks == NIL) {
+      profstacks = old;
+      profstacksize = oldsize;
+      if (profstackcount*10 >= profstacksize*9) return; /* Too full to use */
+    } else {
+      profstackcount = 0;
+      for (n = 0; n < oldsize; n++) {
+        if (old[n].stack != NIL) {
+          add_profstack(old[n].stack, old[n].count);
+          free(old[n].stack);
+        }
+      }
+      free(old);
+    }
+  }
+  for (cp = stack; *cp != asc_NUL; cp++) hash = hash*31+CAST(*cp, byte);
+  n = hash & (profstacksize-1);
+  while (profstacks[n].stack != NIL) {
+    if (!strcmp(profstacks[n].stack, stack)) {
+      profstacks[n].count+=count;
+      return;
+    }
+    n = (n+1) & (profstacksize-1);
+  }
+  profstacks[n].stack = strdup(stack);
+  if (profstacks[n].stack == NIL) return;
+  profstacks[n].count = count;
+  profstackcount++;
+}
+
+/*
+** 'profile_collect' turns the samples in 'profsamples' into collapsed
+** stacks and empties the table
+*/
+void profile_collect(void) {
+  int32 n, k, len;
+  profsample *sp;
+  byte *lp;
+  library *libp;
+  char *name;
+
+  if (profsamples == NIL || profused == 0) return;
+  while (__sync_lock_test_and_set(&profbusy, 1));  /* Wait if a sample is being taken on another thread */
+  for (n = 0; n < PROFSLOTS; n++) {
+    sp = &profsamples[n];
+    if (sp->where == NIL) continue;
+    len = 0;
+    if (sp->truncated) len = snprintf(proftext, PROFTEXTSIZE, "...;");
+    for (k = sp->depth-1; k >= 0; k--) {        /* Outermost call comes first */
+      name = sp->calls[k];
+      len += snprintf(proftext+len, PROFTEXTSIZE-len, "%s%.*s;", *CAST(name, byte *) == BASTOKEN_PROC ? "PROC" : "FN",
+       MAXNAMELEN, name+1);
+      if (proftext[len-2] == '(') {     /* Drop the '(' of a PROC or FN with parameters */
+        proftext[len-2] = ';';
+        proftext[len-1] = asc_NUL;
+        len--;
+      }
+    }
+    lp = sp->where == &profcmdline ? NIL : find_linestart(sp->where);
+    if (lp == NIL)
+      snprintf(proftext+len, PROFTEXTSIZE-len, "command line");
+    else {
+      libp = find_library(sp->where);
+      if (libp == NIL)
+        snprintf(proftext+len, PROFTEXTSIZE-len, "line %d", GET_LINENO(lp));
+      else {
+        snprintf(proftext+len, PROFTEXTSIZE-len, "line %d in %s", GET_LINENO(lp), libp->libname);
+      }
+    }
+    add_profstack(proftext, sp->count);
+  }
+  memset(profsamples, 0, PROFSLOTS*sizeof(profsample));
+  profused = 0;
+  __sync_lock_release(&profbusy);
+}
+
+/*
+** 'profile_start' starts taking 'rate' samples a second, or
+** PROFRATE a second if 'rate' is zero
+*/
+void profile_start(int32 rate) {
+  struct sigaction action;
+  struct itimerval timer;
+
+  if (rate <= 0) rate = PROFRATE;
+  if (profsamples == NIL) {
+    profsamples = calloc(PROFSLOTS, sizeof(profsample));
+    if (profsamples == NIL) {
+      error(ERR_NOMEMORY);
+      return;
+    }
+  }
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = profile_sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NIL);
+  timer.it_interval.tv_sec = rate == 1 ? 1 : 0;
+  timer.it_interval.tv_usec = rate == 1 ? 0 : 1000000/rate;
+  if (timer.it_interval.tv_usec == 0 && timer.it_interval.tv_sec == 0) timer.it_interval.tv_usec = 1;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, NIL);
+  profiling = TRUE;
+}
+
+/*
+** 'profile_stop' stops the timer. The samples taken so far are kept
+*/
+void profile_stop(void) {
+  struct itimerval timer;
+
+  if (!profiling) return;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NIL);
+  profiling = FALSE;
+  profile_collect();
+}
+
+/*
+** 'profile_clear' discards all of the samples taken so far
+*/
+void profile_clear(void) {
+  int32 n;
+
+  profile_collect();
+  for (n = 0; n < profstacksize; n++) free(profstacks[n].stack);
+  free(profstacks);
+  profstacks = NIL;
+  profstacksize = profstackcount = 0;
+  proftotal = proflost = 0;
+}
+
+/*
+** 'profile_running' is called with 'running' set to TRUE when the
+** interpreter starts to run a program or a command typed at the
+** command line and with FALSE when control returns to the command
+** line. Samples are only taken while Basic code is running
+*/
+void profile_running(boolean running) {
+  proflive = running;
+  if (!running) profile_collect();
+}
+
+/*
+** 'write_profstacks' writes the collapsed stacks to file 'name' in
+** the form expected by flame graph tools such as 'flamegraph.pl', that
+** is, one line per stack giving the calls separated by ';' and then
+** the number of samples. It returns FALSE if the file cannot be opened
+*/
+static boolean write_profstacks(char *name) {
+  FILE *savefile;
+  int32 n;
+
+  profile_collect();
+  savefile = fopen(name, "w");
+  if (savefile == NIL) return FALSE;
+  for (n = 0; n < profstacksize; n++) {
+    if (profstacks[n].stack != NIL) fprintf(savefile, "%s %u\n", profstacks[n].stack, profstacks[n].count);
+  }
+  fclose(savefile);
+  return TRUE;
+}
+
+/*
+** 'profile_save' handles '*PROFILE SAVE'
+*/
+void profile_save(char *name) {
+  if (!write_profstacks(name)) error(ERR_CANTWRITE);
+}
+
+/*
+** 'compare_leaves' and 'compare_counts' are the qsort() comparison
+** functions used to add up the samples for each line and then to put
+** the busiest lines first
+*/
+static int compare_leaves(const void *first, const void *second) {
+  return strcmp(CAST(first, const profstack *)->stack, CAST(second, const profstack *)->stack);
+}
+
+static int compare_counts(const void *first, const void *second) {
+  const profstack *a = first, *b = second;
+  if (a->count != b->count) return a->count < b->count ? 1 : -1;
+  return strcmp(a->stack, b->stack);
+}
+
+/*
+** 'profile_lines' lists the number of samples taken in each line,
+** busiest line first, either on the screen or in file 'name' if
+** that is not NIL
+*/
+void profile_lines(char *name) {
+  FILE *listfile = NIL;
+  profstack *lines;
+  int32 n, count, entries;
+  char *leaf;
+
+  profile_collect();
+  lines = malloc((profstackcount+1)*sizeof(profstack));
+  if (lines == NIL) {
+    error(ERR_NOMEMORY);
+    return;
+  }
+/* The line is the last item in each stack. Add up the samples for each one */
+  count = 0;
+  for (n = 0; n < profstacksize; n++) {
+    if (profstacks[n].stack == NIL) continue;
+    leaf = strrchr(profstacks[n].stack, ';');
+    lines[count].stack = leaf == NIL ? profstacks[n].stack : leaf+1;
+    lines[count].count = profstacks[n].count;
+    count++;
+  }
+  entries = count;
+  qsort(lines, entries, sizeof(profstack), compare_leaves);
+  count = 0;
+  for (n = 0; n < entries; n++) {
+    if (count > 0 && !strcmp(lines[n].stack, lines[count-1].stack))
+      lines[count-1].count+=lines[n].count;
+    else {
+      lines[count++] = lines[n];
+    }
+  }
+  qsort(lines, count, sizeof(profstack), compare_counts);
+  if (name != NIL) {
+    listfile = fopen(name, "w");
+    if (listfile == NIL) {
+      free(lines);
+      error(ERR_CANTWRITE);
+      return;
+    }
+    fprintf(listfile, "%u samples", proftotal);
+    if (proflost > 0) fprintf(listfile, ", %u lost", proflost);
+    fprintf(listfile, "\n");
+    for (n = 0; n < count; n++)
+      fprintf(listfile, "%10u %5.1f%%  %s\n", lines[n].count, 100.0*lines[n].count/proftotal, lines[n].stack);
+    fclose(listfile);
+  } else {
+    emulate_printf("%u samples", proftotal);
+    if (proflost > 0) emulate_printf(", %u lost", proflost);
+    emulate_printf("\r\n");
+    for (n = 0; n < count; n++)
+      emulate_printf("%10u %5.1f%%  %s\r\n", lines[n].count, 100.0*lines[n].count/proftotal, lines[n].stack);
+  }
+  free(lines);
+}
+
+/*
+** 'profile_atexit' starts the profiler and arranges for the stacks
+** to be written to file 'name' when the interpreter finishes. It is
+** used for the '-profile' command line option
+*/
+void profile_atexit(char *name) {
+  proffile = name;
+  profile_start(0);
+}
+
+/*
+** 'profile_final' is called when the interpreter finishes to write
+** the stacks to the file given with '-profile'
+*/
+void profile_final(void) {
+  if (proffile == NIL) return;
+  profile_stop();
+  if (!write_profstacks(proffile)) fprintf(stderr, "Unable to write profile to '%s'\n", proffile);
+  proffile = NIL;
+}
+#endif /* TARGET_UNIX */
+
 /*
 ** 'bad_token' is called when an invalid token is found. This generally
 ** means that the Basic program is corrupt although it might also mean
@@ -439,6 +829,184 @@ static void (*statements[256])(void) = {
   exec_command,    flag_badline,    bad_syntax,       assign_pseudovar  /* FC..FF */
 };
 
+/*
+** Line counts
+** -----------
+** '*COVERAGE ON' replaces every statement in the dispatch table with
+** 'count_statement', which counts the statement against the line it
+** is in and then calls the real function. Nothing is added to the
+** statement loops, so there is no cost when the counts are not being
+** kept. 'linecounts' is indexed by line number. 'entries' is the number
+** of times control has arrived at the line from another line and
+** 'statements' the number of statements run in it. Only the program in
+** memory is counted, not libraries or commands typed at the command line
+*/
+typedef struct {
+  uint64 entries;                       /* Times control moved to the line */
+  uint64 statements;                    /* Statements run in the line */
+} linecount;
+
+static linecount *linecounts;           /* Counts indexed by line number */
+static linecount nocount;               /* Counts for code that is not in the program */
+static linecount *thiscount;            /* Counts for the line being run */
+static byte *countstart, *countend;     /* Start and end of the line being run */
+static void (*realstatements[256])(void);       /* Dispatch table when not counting */
+static boolean counting;                /* TRUE if 'statements' holds 'count_statement' */
+
+/*
+** Loops jump between the same few lines over and over again so
+** the lines found recently are kept in a small cache indexed by the
+** address of the statement to save searching for them every time
+*/
+#define COUNTCACHESIZE 64
+
+static struct {
+  byte *start, *end;                    /* Start and end of line */
+  linecount *counts;                    /* Counts for the line */
+} countcache[COUNTCACHESIZE];
+
+/*
+** 'reset_countcache' empties the cache of lines. It is called before
+** a program is run as it might have been edited
+*/
+static void reset_countcache(void) {
+  countstart = countend = NIL;
+  memset(countcache, 0, sizeof(countcache));
+}
+
+/*
+** 'count_statement' is called in place of the function that runs each
+** statement when the counts are being kept
+*/
+static void count_statement(void) {
+  byte *p = basicvars.current;
+
+  if (p < countstart || p >= countend) {        /* Have moved to another line */
+    if (p >= basicvars.start && p < basicvars.top) {
+      int n = (CAST(p, size_t) >> 2) & (COUNTCACHESIZE-1);
+      if (p < countcache[n].start || p >= countcache[n].end) {
+        byte *lp = find_linestart(p);
+        countcache[n].start = lp;
+        countcache[n].end = lp+GET_LINELEN(lp);
+        countcache[n].counts = &linecounts[GET_LINENO(lp)];
+      }
+      countstart = countcache[n].start;
+      countend = countcache[n].end;
+      thiscount = countcache[n].counts;
+      thiscount->entries++;
+    } else {
+      countstart = countend = NIL;
+      thiscount = &nocount;
+    }
+  }
+  thiscount->statements++;
+  (*realstatements[*p])();
+}
+
+/*
+** 'count_start' starts counting the statements run in each line. The
+** counts carry on from where they were if they have not been cleared
+*/
+void count_start(void) {
+  int n;
+
+  DEBUGFUNCMSGIN;
+  if (linecounts == NIL) {
+    linecounts = calloc(MAXLINENO+1, sizeof(linecount));
+    if (linecounts == NIL) {
+      DEBUGFUNCMSGOUT;
+      error(ERR_NOMEMORY);
+      return;
+    }
+  }
+  if (!counting) {
+    memcpy(realstatements, statements, sizeof(statements));
+    for (n = 0; n < 256; n++) {
+      if (statements[n] != next_line && statements[n] != skip_colon) statements[n] = count_statement;
+    }
+    reset_countcache();
+    counting = TRUE;
+  }
+  DEBUGFUNCMSGOUT;
+}
+
+/*
+** 'count_stop' puts the normal dispatch table back. The counts are kept
+*/
+void count_stop(void) {
+  DEBUGFUNCMSGIN;
+  if (counting) {
+    memcpy(statements, realstatements, sizeof(statements));
+    counting = FALSE;
+  }
+  DEBUGFUNCMSGOUT;
+}
+
+/*
+** 'count_clear' sets all of the counts back to zero
+*/
+void count_clear(void) {
+  DEBUGFUNCMSGIN;
+  if (linecounts != NIL) memset(linecounts, 0, (MAXLINENO+1)*sizeof(linecount));
+  DEBUGFUNCMSGOUT;
+}
+
+/*
+** 'count_list' lists the program with the number of times control
+** reached each line and the number of statements run in it, either on
+** the screen or in file 'name' if that is not NIL. Lines that contain
+** code that has never been run are marked with '#####' and lines with
+** nothing to run, for example, those that are empty or only have a
+** REM, DATA or DEF on them, with '-'
+*/
+void count_list(char *name) {
+  FILE *listfile = NIL;
+  byte *p, *tp;
+  linecount *lcp;
+  int32 codelines = 0, runlines = 0;
+  char counts[48];
+
+  DEBUGFUNCMSGIN;
+  if (name != NIL) {
+    listfile = fopen(name, "w");
+    if (listfile == NIL) {
+      DEBUGFUNCMSGOUT;
+      error(ERR_CANTWRITE);
+      return;
+    }
+  }
+  reset_indent();
+  for (p = basicvars.start; !AT_PROGEND(p); p+=GET_LINELEN(p)) {
+    lcp = linecounts == NIL ? &nocount : &linecounts[GET_LINENO(p)];
+    tp = FIND_EXEC(p);
+    while (*tp == ' ' || *tp == ':') tp++;
+    if (*tp == asc_NUL || *tp == BASTOKEN_REM || *tp == BASTOKEN_DATA || *tp == BASTOKEN_DEF)
+      snprintf(counts, sizeof(counts), "%10s %10s", "-", "-");
+    else {
+      codelines++;
+      if (lcp->statements == 0)
+        snprintf(counts, sizeof(counts), "%10s %10s", "#####", "#####");
+      else {
+        runlines++;
+        snprintf(counts, sizeof(counts), "%10llu %10llu", (unsigned long long)lcp->entries, (unsigned long long)lcp->statements);
+      }
+    }
+    expand(p, basicvars.stringwork);
+    if (listfile != NIL)
+      fprintf(listfile, "%s %s\n", counts, basicvars.stringwork);
+    else {
+      emulate_printf("%s %s\r\n", counts, basicvars.stringwork);
+    }
+  }
+  if (listfile != NIL) {
+    fprintf(listfile, "%d of %d lines run\n", runlines, codelines);
+    fclose(listfile);
+  } else {
+    emulate_printf("%d of %d lines run\r\n", runlines, codelines);
+  }
+  DEBUGFUNCMSGOUT;
+}
+
 /*
 ** 'exec_fnstatements' is called to run the statements in a function.
 ** On entry 'lp' points at the start of the tokens to be interpreted.
@@ -446,14 +1014,43 @@ static void (*statements[256])(void) = {
 ** return there once an '='<result> statement has been interpreted
 */
 void exec_fnstatements(byte *lp) {
+#ifndef USE_DIRECTDISPATCH
   byte token;
+#else
+  static void *statement_labels[256] = {
+    [0 ... 255] = &&statement_call,
+    [BASTOKEN_EOL] = &&statement_eol,
+    [' '] = &&statement_colon,
+    [':'] = &&statement_colon,
+    ['='] = &&statement_return
+  };
+#endif
 
   DEBUGFUNCMSGIN;
   basicvars.current = lp;
+#ifdef USE_DIRECTDISPATCH
+  goto *statement_labels[*basicvars.current];
+statement_eol:
+  lp = basicvars.current+1;             /* In-line version of 'next_line' */
+  if (AT_PROGEND(lp)) end_run();
+  if (basicvars.traces.lines) trace_line(GET_LINENO(lp));
+  basicvars.thisline = lp;
+  basicvars.current = FIND_EXEC(lp);
+  goto *statement_labels[*basicvars.current];
+statement_colon:
+  basicvars.current++;
+  goto *statement_labels[*basicvars.current];
+statement_call:
+  (*statements[*basicvars.current])();
+  goto *statement_labels[*basicvars.current];
+statement_return:
+  exec_fnreturn();
+#else
   do {  /* This is the main statement execution loop */
     token = *basicvars.current;
     (*statements[token])();     /* Dispatch a statement */
   } while (token != '=');
+#endif
   DEBUGFUNCMSGOUT;
 }
 
@@ -462,6 +1059,14 @@ void exec_fnstatements(byte *lp) {
 ** or the main program
 */
 static void exec_statements(byte *lp) {
+#ifdef USE_DIRECTDISPATCH
+  static void *statement_labels[256] = {
+    [0 ... 255] = &&statement_call,
+    [BASTOKEN_EOL] = &&statement_eol,
+    [' '] = &&statement_colon,
+    [':'] = &&statement_colon
+  };
+#endif
   basicvars.current = lp;
 
   DEBUGFUNCMSGIN;
@@ -478,6 +1083,20 @@ static void exec_statements(byte *lp) {
     }
 #ifdef DEBUG
     if (basicvars.debug_flags.tokens) fprintf(stderr, "Dispatching statement with token &%X at &%llX\n", *basicvars.current, (uint64)(size_t)basicvars.current);
+#endif
+#ifdef USE_DIRECTDISPATCH
+    goto *statement_labels[*basicvars.current];
+statement_eol:
+    lp = basicvars.current+1;           /* In-line version of 'next_line' */
+    if (AT_PROGEND(lp)) end_run();
+    if (basicvars.traces.lines) trace_line(GET_LINENO(lp));
+    basicvars.thisline = lp;
+    basicvars.current = FIND_EXEC(lp);
+    continue;
+statement_colon:
+    basicvars.current++;
+    continue;
+statement_call:
 #endif
     (*statements[*basicvars.current])();        /* Dispatch a statement */
   } while (TRUE);
@@ -527,6 +1146,10 @@ void run_program(byte *lp) {
   basicvars.datacur = NIL;
   basicvars.runflags.outofdata = FALSE;
   basicvars.runflags.running = TRUE;    /* Say that ' RUN' command has been issued */
+#ifdef TARGET_UNIX
+  profile_running(TRUE);
+#endif
+  reset_countcache();
   if (sigsetjmp(basicvars.error_restart, 1) == 0) {     /* Mark restart point */
     basicvars.local_restart = &basicvars.error_restart;
     exec_statements(FIND_EXEC(lp));     /* Start normal run at first token */
@@ -569,6 +1192,10 @@ void exec_thisline(void) {
   basicvars.runflags.outofdata = FALSE;
   clear_error();
   reset_opstack();
+#ifdef TARGET_UNIX
+  profile_running(TRUE);
+#endif
+  reset_countcache();
   exec_statements(FIND_EXEC(thisline));
   DEBUGFUNCMSGOUT;
 }
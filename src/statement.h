@@ -47,6 +47,21 @@ extern void bad_syntax(void);
 extern void next_line(void);
 extern void store_value(lvalue, int64, boolean);
 extern void end_run(void);
+extern void count_start(void);
+extern void count_stop(void);
+extern void count_clear(void);
+extern void count_list(char *);
+#ifdef TARGET_UNIX
+extern void profile_start(int32);
+extern void profile_stop(void);
+extern void profile_clear(void);
+extern void profile_collect(void);
+extern void profile_running(boolean);
+extern void profile_save(char *);
+extern void profile_lines(char *);
+extern void profile_atexit(char *);
+extern void profile_final(void);
+#endif
 
 #endif
 
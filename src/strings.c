@@ -39,47 +39,65 @@
 #endif
 
 /*
-** The string memory management is based around a series of 'bins' in which
-** are kept free strings of different lengths, a bin for each length. There
-** are bins for string lengths ranging from four to 64K bytes. The array
-** 'binsizes' gives the string lengths for each bin. The emphasis is on
-** dealing with short strings (up to 128 bytes) with about two thirds of
-** the bins being for short strings. There is no reason why the number of
-** bins could not be increased to improve memory usage nor why the maximum
-** length string could be set higher. (The only problem here is that the
-** interpreter uses a string workspace of the maximum string length and
-** increasing the maximum beyond, say, a megabyte, would probably be
-** impractical.
-** The allocation strategy is as follows:
-** 1)  Search the bin for a string of the required size
-** 2)  If the bin is empty acquire a block directly from the Basic heap.
-** 3)  If that fails then search the free string list and use the first
-**      one that fits. The unused potion of the block is returned to
-**      either one of the bins or the free string list, depending on its
-**      size.
-** 4)  If nothing can be found in step 3), try to merge free blocks
+** The string memory management uses two schemes, one for short strings
+** (up to 256 bytes) and one for longer ones.
+**
+** Short strings are kept in a series of 'bins' in which are kept free
+** strings of different lengths, a bin for every multiple of eight bytes.
+** The array 'binsizes' gives the string lengths for each bin. The
+** allocation strategy is as follows:
+** 1)  Take a string from the bin of the required size.
+** 2)  If the bin is empty acquire memory directly from the Basic heap.
+**      Strings are created a slab at a time, that is, several blocks are
+**      taken from the heap at once and the spare ones put in the bin.
+** 3)  If that fails then take a block from the first non-empty bin for a
+**      longer short string and split it, putting the unused portion in
+**      the bin of that size.
+** 4)  If that fails then search the free string list and use the first
+**      one that fits, splitting it in the same way.
+** 5)  If nothing can be found in step 4), try to merge free blocks
 **      and start again from step 1).
-** 5)  If there is still nothing available give up.
-**      (Actually it would be possible to check one more place to see
-**      if there is any memory left. The bins for longer string sizes
-**      could be checked but if steps 1) to 4) fail to produce anything
-**      it seems unlikely that this will.)
+** 6)  If there is still nothing available give up.
+** Freeing a short string is a matter of adding it to the front of its bin,
+** except that a string at the top of the heap is handed straight back to
+** the heap.
+**
+** Longer strings are held in 'arenas', runs of memory taken from the Basic
+** heap that hold nothing but long strings. Each block in an arena has a
+** small header giving its size and whether it and the block before it are
+** in use, and free blocks also have their size at the end. This means
+** that a block being freed can be merged with free blocks either side of
+** it straight away, so long strings do not fragment memory in the way the
+** bins do. Free blocks are kept on lists by size, the sizes being the
+** 'binsizes' for strings over 256 bytes, that is, four for each power of
+** two. A free block at the top of the heap is given back to the heap.
+** When a long string is extended, the block is grown in place if there is
+** a free block after it or it is at the top of the heap.
 **
 ** In this module, string lengths are referred to by the number of the bin
 ** that corresponds to that length.
 */
 
 #define SHORTLIMIT 256                  /* Largest 'short' string */
-#define MEDLIMIT 2048                   /* Largest 'medium' string */
-
 #define SHORTGRAIN 8                    /* Difference between each 'short' string length */
-#define MEDGRAIN 256                    /* Difference between each 'medium' string length */
-
 #define SHORTBINS ((SHORTLIMIT/SHORTGRAIN)+1)   /* Number of bins for short strings (+1 as range is 0..256) */
-#define MEDSTART SHORTBINS              /* Index of first 'medium' bin entry */
-#define MEDBINS ((MEDLIMIT/MEDGRAIN)-1) /* Number of bins for medium strings (-1 as range is 512..2048) */
-#define LONGSTART (SHORTBINS+MEDBINS)   /* Index of first 'long' bin entry */
-#define BINCOUNT 46                     /* Number of bins */
+#define LONGSTART SHORTBINS             /* Index of first size for strings over 256 bytes */
+#define LONGSTEPS 4                     /* Number of sizes for each power of two above 256 bytes */
+#define LONGLISTS 32                    /* Number of free lists for long strings */
+#define BINCOUNT (SHORTBINS+LONGLISTS)  /* Number of bins */
+
+#define SLABSIZE 1024                   /* Size of slab used to create short strings */
+#define SLABMAX 16                      /* Maximum number of strings created from one slab */
+
+#define LONGHDR 8                       /* Size of the header on a long string block */
+#define LONGMIN (LONGHDR+SHORTLIMIT+SHORTGRAIN) /* Size of smallest long string block */
+#define ARENAHDR 16                     /* Size of the header at the start of an arena */
+#define LONGSIZE(n) ((((n)+SHORTGRAIN-1) & -SHORTGRAIN)+LONGHDR)        /* Size of block for long string of length 'n' */
+
+#define LONG_INUSE 1                    /* Block is in use */
+#define LONG_PREVFREE 2                 /* Block before this one is free */
+#define LONG_FIRST 4                    /* Block is the first one in its arena */
+#define LONG_END 8                      /* Marker at the end of an arena */
 
 typedef struct heapblock {
   struct heapblock *blockflink;         /* Next block in list */
@@ -91,26 +109,53 @@ typedef struct {
   int32 freesize;                       /* Size of free string */
 } freeblock;
 
+typedef struct longblock {
+  int32 blocksize;                      /* Size of block including the header */
+  int32 blockflags;                     /* 'LONG_xxx' flags */
+  struct longblock *nextfree;           /* Next block on free list (free blocks only) */
+  struct longblock *prevfree;           /* Previous block on free list (free blocks only) */
+} longblock;
+
+typedef struct arena {
+  struct arena *arenaflink;             /* Next arena */
+} arena;
+
+#define LONGBLOCK(p) CAST(CAST(p, char *)-LONGHDR, longblock *)
+#define NEXTBLOCK(bp) CAST(CAST(bp, char *)+(bp)->blocksize, longblock *)
+#define FOOTER(bp) (*CAST(CAST(bp, char *)+(bp)->blocksize-LONGHDR, int32 *))
+#define PREVSIZE(bp) (*CAST(CAST(bp, char *)-LONGHDR, int32 *))
+
 #ifdef DEBUG
   static int32 allocated;               /* Number of bytes allocated */
   static int32 created[BINCOUNT];       /* Number of times string of this size has been created */
   static int32 reused[BINCOUNT];        /* Number of times strings in bins have been reused */
   static int32 allocations[BINCOUNT];   /* Number of times string of this size has been allocated */
-
+  static int32 requested;               /* Number of bytes asked for by callers */
+  static int32 granted;                 /* Number of bytes actually handed out */
+  static int32 slabs;                   /* Number of slabs taken from the heap */
+  static int32 splits;                  /* Number of larger blocks split to satisfy a request */
+  static int32 returned;                /* Number of blocks given back to the heap when freed */
+  static int32 merges;                  /* Number of long string blocks merged with a neighbour */
+  static int32 grown;                   /* Number of long strings extended in place */
 #endif
 
 static int32 freestrings;               /* Number of free strings in bins */
 static heapblock *binlists[BINCOUNT];   /* Free memory block bins */
 static heapblock *freelist;             /* List of free blocks not in bins */
+static longblock *longlists[LONGLISTS]; /* Free long string blocks */
+static uint32 longmask;                 /* Bit set for each non-empty entry in 'longlists' */
+static arena *arenalist;                /* Arenas holding long strings */
+static byte *arenaend;                  /* End of the arena that can be extended at the top of the heap */
 
 static int32 binsizes[BINCOUNT] = {     /* Bin number -> string size */
 /* short strings */
 0,   8,  16,  24,  32,  40,  48,  56,  64,  72,  80,  88,  96, 104, 112, 120, 128,
    136, 144, 152, 160, 168, 176, 184, 192, 200, 208, 216, 224, 232, 240, 248, 256,
-/* Now the medium strings */
-  512, 768, 1024, 1280, 1536, 1792, 2048,
-/* Finally the long strings */
-  3072, 4096, 8192, 16384, 32768, 65536
+/* Now the sizes used for long strings, four for each power of two */
+    320,   384,   448,   512,   640,   768,   896,  1024,
+   1280,  1536,  1792,  2048,  2560,  3072,  3584,  4096,
+   5120,  6144,  7168,  8192, 10240, 12288, 14336, 16384,
+  20480, 24576, 28672, 32768, 40960, 49152, 57344, 65536
 };
 
 char emptystring;       /* All requests for zero bytes point here */
@@ -120,66 +165,114 @@ static boolean collect(void);   /* Forward reference */
 /*
 ** 'find_bin' returns the bin number used to hold strings of length
 ** 'size'. There is no error checking here and so functions that call
-** this one must ensure that the string length is in range
+** this one must ensure that the string length is in range.
+** For strings longer than 256 bytes, the bin is found from the position
+** of the top bit of 'size-1' and the two bits below it
 */
 static int32 find_bin(int size) {
-  if (size<=SHORTLIMIT)         /* Size<=128 bytes (including zero) */
+  int32 top, n;
+  if (size<=SHORTLIMIT)         /* Size<=256 bytes (including zero) */
     return (size+SHORTGRAIN-1)/SHORTGRAIN;
-  else if (size<=MEDLIMIT)
-    return (size+MEDGRAIN-1)/MEDGRAIN+MEDSTART-2;       /* -2 as there are no 0 and 128 byte medium strings */
-  else {        /* Search through larger size string bins */
-    int n = LONGSTART;
-    do {
-      if (binsizes[n]>=size) return n;  /* Found wanted string bin size */
-      n+=1;
-    } while (n<BINCOUNT);
+  if (size>MAXSTRING) {
     error(ERR_BROKEN, __LINE__, "strings");             /* Sanity check - String size is too long */
+    return 0;
   }
-  return 0;     /* Should never be executed */
+  n = size-1;
+  top = 8;              /* 'size-1' is at least 256, that is, 1<<8 */
+  while ((n>>(top+1))!=0) top++;
+  return LONGSTART+(top-8)*LONGSTEPS+((n>>(top-2)) & (LONGSTEPS-1));
 }
 
 /*
-** 'alloc_string' is called to allocate memory for a string. The
-** function returns a pointer to the memory allocated. Note that
-** requests for zero bytes are allowed, and the address returned
-** will point to a valid memory location ('emptystring').
+** 'release_block' puts the spare end of a short string block that has
+** been split back into a bin if it is the right size or on the free
+** list if not
 */
-void *alloc_string(int32 size) {
-  int32 bin, unused;
+static void release_block(heapblock *p, int32 size) {
+  if (size<=0) return;
+  if (size<=SHORTLIMIT) {
+    int32 bin = find_bin(size);
+    p->blockflink = binlists[bin];
+    binlists[bin] = p;
+  }
+  else {
+    p->blockflink = freelist;
+    p->blocksize = size;
+    freelist = p;
+  }
+  freestrings+=1;
+}
+
+/*
+** 'alloc_short' allocates memory for a string of up to 256 bytes
+*/
+static void *alloc_short(int32 size) {
+  int32 bin, n, count;
   heapblock *p, *last;
   boolean reclaimed;
-  if (size==0) return &emptystring;
-  basicvars.runflags.has_variables = TRUE;
   bin = find_bin(size);
+#ifdef DEBUG
+  requested+=size;
+  granted+=binsizes[bin];
+  allocations[bin]+=1;
+#endif
   reclaimed = FALSE;
   do {
-    if (binlists[bin]!=NIL) {   /* Found something usable in a bin */
-      p = binlists[bin];
+    p = binlists[bin];
+    if (p!=NIL) {       /* Found something usable in a bin */
       binlists[bin] = p->blockflink;
       freestrings-=1;
 #ifdef DEBUG
       reused[bin]+=1;
-      allocations[bin]+=1;
-      if (basicvars.debug_flags.strings) fprintf(stderr, "Allocate string at %p, length %d bytes\n", p, binsizes[size]);
+      if (basicvars.debug_flags.strings) fprintf(stderr, "Allocate string at %p, length %d bytes\n", p, binsizes[bin]);
 #endif
       return p;
     }
 
-/* There was nothing in the bin. Try grabbing more memory from the heap */
-
+/*
+** There was nothing in the bin. Try grabbing more memory from the heap,
+** creating several strings at a time and putting the spare ones in the bin
+*/
     size = binsizes[bin];       /* Get string size for bin 'bin' */
-    p = allocmem(size, 0);
+    count = SLABSIZE/size;
+    if (count>SLABMAX) count = SLABMAX;
+    p = allocmem(count*size, 0);
+    if (p==NIL) {
+      count = 1;
+      p = allocmem(size, 0);
+    }
     if (p!=NIL) {               /* Allocated block from heap successfully */
+      for (n=1; n<count; n++) {
+        heapblock *sp = CAST(CAST(p, char *)+n*size, heapblock *);
+        sp->blockflink = binlists[bin];
+        binlists[bin] = sp;
+      }
+      freestrings+=count-1;
 #ifdef DEBUG
-      allocated+=size;
-      created[bin]+=1;
-      allocations[bin]+=1;
+      allocated+=count*size;
+      created[bin]+=count;
+      if (count>1) slabs+=1;
       if (basicvars.debug_flags.strings) fprintf(stderr, "strings.c: alloc_string(): Allocate string at %p, length %d bytes\n", p, size);
 #endif
       return p;
     }
 
-/* The heap is exhausted. Try the free block list */
+/* The heap is exhausted. Split a block from a bin for a longer string */
+
+    for (n=bin+1; n<SHORTBINS && binlists[n]==NIL; n++);
+    if (n<SHORTBINS) {
+      p = binlists[n];
+      binlists[n] = p->blockflink;
+      freestrings-=1;
+      release_block(CAST(CAST(p, char *)+size, heapblock *), binsizes[n]-size);
+#ifdef DEBUG
+      splits+=1;
+      if (basicvars.debug_flags.strings) fprintf(stderr, "strings.c: alloc_string(): Split %d byte string at %p for %d bytes\n", binsizes[n], p, size);
+#endif
+      return p;
+    }
+
+/* Nothing there either. Try the free block list */
 
     p = freelist;
     last = NIL;
@@ -188,34 +281,15 @@ void *alloc_string(int32 size) {
       p = p->blockflink;
     }
     if (p!=NIL) {       /* Found some memory that can be used */
-      unused = p->blocksize-size;       /* Find out how much of block will be left */
-      if (unused<=SHORTLIMIT) {         /* Remove entire block from the free list */
-        if (last==NIL)  /* Block was first in list */
-          freelist = p->blockflink;
-        else {
-          last->blockflink = p->blockflink;
-        }
-        freestrings-=1;
-        if (unused>0) { /* If anything is left from block, put it in a bin */
-          basicstring descriptor;
-          descriptor.stringaddr = CAST(p, char *)+size;
-          descriptor.stringlen = unused;
-          free_string(descriptor);
-        }
-      }
-      else {    /* Use part of block. Return unused portion to free list */
-        heapblock *up;
-        up = CAST(CAST(p, char *)+size, heapblock *);
-        up->blockflink = p->blockflink;
-        up->blocksize = unused;
-        if (last==NIL)
-          freelist = up;
-        else {
-          last->blockflink = up;
-        }
+      if (last==NIL)    /* Block was first in list */
+        freelist = p->blockflink;
+      else {
+        last->blockflink = p->blockflink;
       }
+      freestrings-=1;
+      release_block(CAST(CAST(p, char *)+size, heapblock *), p->blocksize-size);
 #ifdef DEBUG
-      allocations[bin]+=1;
+      splits+=1;
       if (basicvars.debug_flags.strings) fprintf(stderr, "strings.c: alloc_string(): Allocate string at %p, length %d bytes\n", p, size);
 #endif
       return p;
@@ -238,12 +312,267 @@ void *alloc_string(int32 size) {
   return NIL;           /* Will never be executed */
 }
 
+/*
+** 'long_list' returns the number of the free list on which a free long
+** string block of 'size' bytes is kept. This is the largest of the
+** long string sizes that will fit in the block
+*/
+static int32 long_list(int32 size) {
+  int32 bin;
+  size-=LONGHDR;
+  if (size>=MAXSTRING) return LONGLISTS-1;
+  bin = find_bin(size);
+  if (binsizes[bin]>size) bin--;
+  return bin<LONGSTART ? 0 : bin-LONGSTART;
+}
+
+/*
+** 'link_long' adds the long string block 'bp' to the right free list
+*/
+static void link_long(longblock *bp) {
+  int32 n = long_list(bp->blocksize);
+  bp->blockflags &= ~(LONG_INUSE | LONG_PREVFREE);
+  bp->prevfree = NIL;
+  bp->nextfree = longlists[n];
+  if (bp->nextfree!=NIL) bp->nextfree->prevfree = bp;
+  longlists[n] = bp;
+  longmask |= 1u<<n;
+  FOOTER(bp) = bp->blocksize;
+}
+
+/*
+** 'unlink_long' removes the long string block 'bp' from its free list
+*/
+static void unlink_long(longblock *bp) {
+  int32 n = long_list(bp->blocksize);
+  if (bp->prevfree!=NIL)
+    bp->prevfree->nextfree = bp->nextfree;
+  else {
+    longlists[n] = bp->nextfree;
+    if (longlists[n]==NIL) longmask &= ~(1u<<n);
+  }
+  if (bp->nextfree!=NIL) bp->nextfree->prevfree = bp->prevfree;
+}
+
+/*
+** 'trim_long' cuts the in-use long string block 'bp' down to 'size'
+** bytes if enough would be left over to be worth keeping as a free
+** block. 'bp' must not be followed by a free block
+*/
+static void trim_long(longblock *bp, int32 size) {
+  longblock *rest, *next;
+  if (bp->blocksize-size<LONGMIN) {
+    NEXTBLOCK(bp)->blockflags &= ~LONG_PREVFREE;
+    return;
+  }
+  rest = CAST(CAST(bp, char *)+size, longblock *);
+  rest->blocksize = bp->blocksize-size;
+  rest->blockflags = 0;
+  bp->blocksize = size;
+  next = NEXTBLOCK(rest);
+  next->blockflags |= LONG_PREVFREE;
+  link_long(rest);
+#ifdef DEBUG
+  splits+=1;
+#endif
+}
+
+/*
+** 'free_long' returns the long string block 'bp' to the free lists,
+** merging it with the blocks either side of it if they are free. If
+** the block ends up at the top of the Basic heap it is handed back to
+** the heap, along with its arena if that is now empty
+*/
+static void free_long(longblock *bp) {
+  longblock *next, *prev;
+  next = NEXTBLOCK(bp);
+  if ((next->blockflags & LONG_INUSE)==0) {     /* Merge with following block */
+    unlink_long(next);
+    bp->blocksize+=next->blocksize;
+    next = NEXTBLOCK(bp);
+#ifdef DEBUG
+    merges+=1;
+#endif
+  }
+  if (bp->blockflags & LONG_PREVFREE) {         /* Merge with preceding block */
+    prev = CAST(CAST(bp, char *)-PREVSIZE(bp), longblock *);
+    unlink_long(prev);
+    prev->blocksize+=bp->blocksize;
+    bp = prev;
+#ifdef DEBUG
+    merges+=1;
+#endif
+  }
+  if ((next->blockflags & LONG_END) && CAST(next, byte *)+LONGHDR==basicvars.vartop) {
+    if (bp->blockflags & LONG_FIRST) {  /* Arena is empty - Give it all back */
+      arena *ap = CAST(CAST(bp, char *)-ARENAHDR, arena *);
+      arena **app = &arenalist;
+      while (*app!=ap) app = &(*app)->arenaflink;
+      *app = ap->arenaflink;
+      freemem(ap, basicvars.vartop-CAST(ap, byte *));
+      arenaend = NIL;
+    }
+    else {      /* Block becomes the new end of the arena */
+      int32 size = bp->blocksize;
+      bp->blocksize = LONGHDR;
+      bp->blockflags = LONG_INUSE | LONG_END;
+      freemem(CAST(bp, char *)+LONGHDR, size);
+      arenaend = basicvars.vartop;
+    }
+#ifdef DEBUG
+    returned+=1;
+#endif
+    return;
+  }
+  next->blockflags |= LONG_PREVFREE;
+  link_long(bp);
+}
+
+/*
+** 'extend_arena' acquires a block of 'size' bytes for a long string
+** from the Basic heap. If the last arena used is at the top of the heap,
+** it is extended, otherwise a new arena is started. It returns a pointer
+** to the new block or NIL if the heap is exhausted
+*/
+static longblock *extend_arena(int32 size) {
+  longblock *bp, *endp;
+  byte *p;
+  if (arenaend!=NIL && arenaend==basicvars.vartop) {
+    p = allocmem(size, 0);
+    if (p==NIL) return NIL;
+    bp = CAST(p-LONGHDR, longblock *);  /* New block goes where the end marker was */
+    bp->blockflags = (bp->blockflags & LONG_PREVFREE) | LONG_INUSE;
+  }
+  else {
+    arena *ap = allocmem(ARENAHDR+size+LONGHDR, 0);
+    if (ap==NIL) return NIL;
+    ap->arenaflink = arenalist;
+    arenalist = ap;
+    bp = CAST(CAST(ap, char *)+ARENAHDR, longblock *);
+    bp->blockflags = LONG_INUSE | LONG_FIRST;
+  }
+  bp->blocksize = size;
+  endp = NEXTBLOCK(bp);
+  endp->blocksize = LONGHDR;
+  endp->blockflags = LONG_INUSE | LONG_END;
+  arenaend = CAST(endp, byte *)+LONGHDR;
+  return bp;
+}
+
+/*
+** 'convert_free' turns a block from the free string list that is big
+** enough to hold a long string of 'size' bytes into an arena. It is used
+** when the Basic heap is full
+*/
+static longblock *convert_free(int32 size) {
+  heapblock *p, *last;
+  longblock *bp, *endp;
+  arena *ap;
+  int32 blocksize;
+  p = freelist;
+  last = NIL;
+  while (p!=NIL && p->blocksize<ARENAHDR+size+LONGHDR) {
+    last = p;
+    p = p->blockflink;
+  }
+  if (p==NIL) return NIL;
+  if (last==NIL)
+    freelist = p->blockflink;
+  else {
+    last->blockflink = p->blockflink;
+  }
+  freestrings-=1;
+  blocksize = p->blocksize;
+#ifdef DEBUG
+  allocated-=blocksize;         /* Memory now belongs to the long strings */
+#endif
+  ap = CAST(p, arena *);
+  ap->arenaflink = arenalist;
+  arenalist = ap;
+  bp = CAST(CAST(ap, char *)+ARENAHDR, longblock *);
+  bp->blocksize = blocksize-ARENAHDR-LONGHDR;
+  bp->blockflags = LONG_INUSE | LONG_FIRST;
+  endp = NEXTBLOCK(bp);
+  endp->blocksize = LONGHDR;
+  endp->blockflags = LONG_INUSE | LONG_END;
+  trim_long(bp, size);
+  return bp;
+}
+
+/*
+** 'alloc_long' allocates memory for a string of more than 256 bytes.
+** It first looks on the free list of the size needed and then takes
+** the first block from the free list for the next size up that has
+** anything on it, as any block on that is big enough. If there is
+** nothing there, more memory is taken from the heap. If there is not
+** enough memory, either an error is reported or, if 'reporterror' is
+** 'FALSE', NIL is returned
+*/
+static void *alloc_long(int32 length, boolean reporterror) {
+  int32 size, n, tries;
+  longblock *bp;
+  size = LONGSIZE(length);
+#ifdef DEBUG
+  requested+=length;
+  granted+=size-LONGHDR;
+  allocations[find_bin(length)]+=1;
+#endif
+  n = find_bin(length)-LONGSTART;
+  bp = longlists[n];
+  for (tries=0; bp!=NIL && bp->blocksize<size && tries<8; tries++) bp = bp->nextfree;
+  if (bp==NIL || bp->blocksize<size) {
+    for (n++; n<LONGLISTS && (longmask & (1u<<n))==0; n++);
+    bp = n<LONGLISTS ? longlists[n] : NIL;
+  }
+  if (bp!=NIL) {
+    unlink_long(bp);
+    bp->blockflags |= LONG_INUSE;
+    trim_long(bp, size);
+#ifdef DEBUG
+    reused[find_bin(length)]+=1;
+#endif
+  }
+  else {
+    bp = extend_arena(size);
+    if (bp==NIL && collect()) bp = extend_arena(size);
+    if (bp==NIL) bp = convert_free(size);
+    if (bp==NIL) {
+      if (reporterror) error(ERR_NOROOM);
+      return NIL;
+    }
+#ifdef DEBUG
+    created[find_bin(length)]+=1;
+#endif
+  }
+#ifdef DEBUG
+  if (basicvars.debug_flags.strings) fprintf(stderr, "strings.c: alloc_string(): Allocate long string at %p, length %d bytes\n", bp, bp->blocksize);
+#endif
+  return CAST(bp, char *)+LONGHDR;
+}
+
+/*
+** 'alloc_string' is called to allocate memory for a string. The
+** function returns a pointer to the memory allocated. Note that
+** requests for zero bytes are allowed, and the address returned
+** will point to a valid memory location ('emptystring').
+*/
+void *alloc_string(int32 size) {
+  if (size==0) return &emptystring;
+  basicvars.runflags.has_variables = TRUE;
+  basicvars.stats.stringallocs+=1;
+  basicvars.stats.stringbytes+=size;
+  if (size>SHORTLIMIT) return alloc_long(size, TRUE);
+  return alloc_short(size);
+}
+
 /*
 ** 'free_string' returns the block at 'hp' to one of the string heap bins.
-** The free blocks are arranged in ascending order of address
+** The block goes on the front of the list for its bin unless it is at
+** the top of the Basic heap, in which case it is given back to the heap.
+** Long strings are handed to 'free_long'
 */
 void free_string(basicstring descriptor) {
-  heapblock *hp, *hp2;
+  heapblock *hp;
   int32 size, bin;
   size = descriptor.stringlen;
 #ifdef DEBUG
@@ -251,22 +580,23 @@ void free_string(basicstring descriptor) {
    descriptor.stringaddr, size);
 #endif
   if (size==0) return;  /* Null string - Nothing to return */
+  basicvars.stats.stringfrees+=1;
+  if (size>SHORTLIMIT) {
+    free_long(LONGBLOCK(descriptor.stringaddr));
+    return;
+  }
   hp = CAST(descriptor.stringaddr, heapblock *);
   bin = find_bin(size);
-  hp2 = binlists[bin];
-  if (hp2==NIL || hp<hp2) {     /* New first element in list */
-    hp->blockflink = hp2;
-    binlists[bin] = hp;
-  }
-  else {        /* Add block somewhere in the middle of the list */
-    heapblock *last;
-    do {
-      last = hp2;
-      hp2 = hp2->blockflink;
-    } while (hp2!=NIL && hp>hp2);
-    hp->blockflink = last->blockflink;
-    last->blockflink = hp;
+  if (returnable(hp, binsizes[bin])) {
+    freemem(hp, binsizes[bin]);
+#ifdef DEBUG
+    allocated-=binsizes[bin];
+    returned+=1;
+#endif
+    return;
   }
+  hp->blockflink = binlists[bin];
+  binlists[bin] = hp;
   freestrings+=1;       /* Bump up number of free strings */
 }
 
@@ -288,6 +618,70 @@ void discard_strings(byte *base, int32 size) {
   }
 }
 
+/*
+** 'resize_long' changes the length of the long string at 'cp' from
+** 'oldlen' to 'newlen' characters, where both are over 256 bytes. The
+** block is cut down or grown in place if possible, growing it using
+** either the free block that follows it or, if it is the last block at
+** the top of the heap, memory from the heap. When a string has to grow,
+** it is given half as much room again as it needs so that a string built
+** up by appending to it a piece at a time is only moved or extended
+** a few times. The spare room is kept until the string is shortened
+*/
+static char *resize_long(char *cp, int32 oldlen, int32 newlen) {
+  longblock *bp, *next;
+  char *newcp;
+  int32 size, spare, want;
+  bp = LONGBLOCK(cp);
+  size = LONGSIZE(newlen);
+  if (size<=bp->blocksize) {    /* String fits in the block it already has */
+    if (newlen<oldlen && bp->blocksize-size>=LONGMIN) { /* Give back the end of the block */
+      longblock *rest = CAST(CAST(bp, char *)+size, longblock *);
+      rest->blocksize = bp->blocksize-size;
+      rest->blockflags = LONG_INUSE;
+      bp->blocksize = size;
+      free_long(rest);
+    }
+    return cp;
+  }
+  spare = newlen+newlen/2;
+  if (spare>MAXSTRING) spare = MAXSTRING;
+  want = LONGSIZE(spare);
+  next = NEXTBLOCK(bp);
+  if ((next->blockflags & LONG_INUSE)==0 && bp->blocksize+next->blocksize>=size) {      /* Absorb following free block */
+    unlink_long(next);
+    bp->blocksize+=next->blocksize;
+    trim_long(bp, bp->blocksize>want ? want : bp->blocksize);
+#ifdef DEBUG
+    grown+=1;
+#endif
+    return cp;
+  }
+  if ((next->blockflags & LONG_END) && CAST(next, byte *)+LONGHDR==basicvars.vartop && arenaend==basicvars.vartop) {
+    if (allocmem(want-bp->blocksize, 0)!=NIL)   /* Extend into the heap */
+      size = want;
+    else if (allocmem(size-bp->blocksize, 0)==NIL) {
+      size = 0;
+    }
+    if (size!=0) {
+      bp->blocksize = size;
+      next = NEXTBLOCK(bp);
+      next->blocksize = LONGHDR;
+      next->blockflags = LONG_INUSE | LONG_END;
+      arenaend = basicvars.vartop;
+#ifdef DEBUG
+      grown+=1;
+#endif
+      return cp;
+    }
+  }
+  newcp = alloc_long(spare, FALSE);
+  if (newcp==NIL) newcp = alloc_long(newlen, TRUE);
+  memmove(newcp, cp, oldlen);
+  free_long(bp);
+  return newcp;
+}
+
 /*
 ** 'resize_string' is used to check if there is enough room following
 ** the string passed to it to increase its length to 'newlen' characters.
@@ -305,6 +699,7 @@ char *resize_string(char *cp, int32 oldlen, int32 newlen) {
   int32 oldbin, newbin;
   char *newcp;
   basicstring descriptor;
+  if (oldlen>SHORTLIMIT && newlen>SHORTLIMIT) return resize_long(cp, oldlen, newlen);
   oldbin = find_bin(oldlen);
   newbin = find_bin(newlen);
   if (newbin==oldbin) return cp;        /* Can use same string */
@@ -323,7 +718,6 @@ char *resize_string(char *cp, int32 oldlen, int32 newlen) {
     return newcp;
   }
   else {        /* New string length is shorter than old */
-    int32 sizediff;
     if (newlen==0) {    /* New string is the null string */
       descriptor.stringlen = oldlen;    /* Have to fake a descriptor for 'free_string' */
       descriptor.stringaddr = cp;
@@ -332,16 +726,12 @@ char *resize_string(char *cp, int32 oldlen, int32 newlen) {
     }
 /*
 ** At this point the new string length is shorter than the original and the
-** string has to be allocated from a bin for a shorter string size. There
-** are two possibilities here: allocate a new string and copy the old one
-** to it or chop the end off the old string. The only time a string can be
-** truncated is when there is a bin of the size of the bit to be released.
+** string has to be allocated from a bin for a shorter string size. A short
+** string can always be truncated as the bit to be released will fit in a
+** bin. A long string that becomes a short one has to be copied
 */
-    sizediff = binsizes[oldbin]-binsizes[newbin];
-    if (binsizes[find_bin(sizediff)]==sizediff) {       /* Bit to be chopped off will go in a bin */
-      descriptor.stringlen = sizediff;  /* Have to fake a descriptor for 'free_string' */
-      descriptor.stringaddr = cp+binsizes[newbin];
-      free_string(descriptor);
+    if (oldlen<=SHORTLIMIT) {
+      release_block(CAST(cp+binsizes[newbin], heapblock *), binsizes[oldbin]-binsizes[newbin]);
       return cp;
     }
     else {      /* Have to copy string */
@@ -376,11 +766,16 @@ int32 get_stringlen(size_t start) {
 void clear_strings(void) {
   int32 n;
   for (n=0; n<BINCOUNT; n++) binlists[n] = NIL;
+  for (n=0; n<LONGLISTS; n++) longlists[n] = NIL;
+  longmask = 0;
+  arenalist = NIL;
+  arenaend = NIL;
   freestrings = 0;
   freelist = NIL;
 #ifdef DEBUG
   allocated = 0;
   for (n=0; n<BINCOUNT; n++) allocations[n] = created[n] = reused[n] = 0;
+  requested = granted = slabs = splits = returned = merges = grown = 0;
 #endif
 }
 
@@ -402,6 +797,7 @@ static boolean collect(void) {
   int32 largest, count;
   fprintf(stderr, "strings.c: collect(): Trying to merge %d free strings\n", freestrings);
 #endif
+  basicvars.stats.collections+=1;
   if (freestrings==0) return FALSE;     /* Give up if there is no free memory */
 /*
 ** Start by creating an unsorted table of free blocks of memory held in
@@ -478,7 +874,7 @@ static boolean collect(void) {
   freelist = NIL;
   while (n>=0) {        /* Add blocks either to a bin or the free string list depending on size */
     if (base[n].freestart!=NIL) {       /* Want this entry */
-      if (base[n].freesize<=MAXSTRING)
+      if (base[n].freesize<=SHORTLIMIT)
         size = find_bin(base[n].freesize);
       else {
         size = 0;
@@ -500,43 +896,116 @@ static boolean collect(void) {
   return merged;
 }
 
+/*
+** 'walk_arenas' goes through the blocks in all the long string arenas and
+** returns the number of bytes in blocks that are in use and free
+*/
+static void walk_arenas(size_t *inuse, size_t *free, int32 *count) {
+  arena *ap;
+  longblock *bp;
+  *inuse = *free = *count = 0;
+  for (ap=arenalist; ap!=NIL; ap=ap->arenaflink) {
+    *count+=1;
+    bp = CAST(CAST(ap, char *)+ARENAHDR, longblock *);
+    while ((bp->blockflags & LONG_END)==0) {
+      if (bp->blockflags & LONG_INUSE)
+        *inuse+=bp->blocksize;
+      else {
+        *free+=bp->blocksize;
+      }
+      bp = NEXTBLOCK(bp);
+    }
+  }
+}
+
+/*
+** 'string_memory' returns the number of bytes of free short string
+** memory held in the bins and on the free list and the numbers of bytes
+** in use and free in the long string arenas. It is used by '*STATS'
+*/
+void string_memory(size_t *shortfree, size_t *longinuse, size_t *longfree) {
+  int32 n, arenas;
+  heapblock *p;
+  *shortfree = 0;
+  for (n=1; n<SHORTBINS; n++) {
+    for (p=binlists[n]; p!=NIL; p=p->blockflink) *shortfree+=binsizes[n];
+  }
+  for (p=freelist; p!=NIL; p=p->blockflink) *shortfree+=p->blocksize;
+  walk_arenas(longinuse, longfree, &arenas);
+}
+
 #ifdef DEBUG
 
 /*
-** 'show_stringstats' prints statistics on string bin usage
+** 'show_stringstats' prints statistics on string bin usage and on
+** how fragmented the string heap is
 */
 void show_stringstats(void) {
-  int32 n, free;
+  int32 n, free, binbytes, listbytes, listcount, largest, arenas;
+  size_t longinuse, longfree;
   heapblock *p;
+  longblock *bp;
   fprintf(stderr, "String statistics:\n");
+  binbytes = 0;
   for (n=1; n<BINCOUNT; n++) {
-    p = binlists[n];
     free = 0;
-    while (p!=NIL) {
-      free++;
-      p = p->blockflink;
+    if (n<SHORTBINS) {
+      for (p=binlists[n]; p!=NIL; p=p->blockflink) free++;
+      binbytes+=free*binsizes[n];
+    }
+    else {
+      for (bp=longlists[n-LONGSTART]; bp!=NIL; bp=bp->nextfree) free++;
     }
     fprintf(stderr, "Size = %5d  requests = %d  created = %d  reused = %d  free = %d\n",
      binsizes[n], allocations[n], created[n], reused[n], free);
   }
+  listbytes = listcount = largest = 0;
+  for (p=freelist; p!=NIL; p=p->blockflink) {
+    listcount++;
+    listbytes+=p->blocksize;
+  }
+  for (n=0; n<LONGLISTS; n++) {
+    for (bp=longlists[n]; bp!=NIL; bp=bp->nextfree) {
+      if (bp->blocksize>largest) largest = bp->blocksize;
+    }
+  }
+  walk_arenas(&longinuse, &longfree, &arenas);
+  fprintf(stderr, "Bytes requested = %d,  granted = %d (%d wasted by rounding)\n", requested, granted, granted-requested);
+  fprintf(stderr, "Short strings: free in bins = %d bytes,  free list = %d bytes in %d blocks,  slabs = %d\n",
+   binbytes, listbytes, listcount, slabs);
+  fprintf(stderr, "Long strings: %d arenas,  in use = %d bytes,  free = %d bytes,  largest free block = %d bytes\n",
+   arenas, (int32)longinuse, (int32)longfree, largest);
+  fprintf(stderr, "Splits = %d,  merges = %d,  grown in place = %d,  returned to heap = %d,  collections = %d\n",
+   splits, merges, grown, returned, (int32)basicvars.stats.collections);
   collect();
 }
 
+/*
+** 'string_used' returns the number of bytes of memory used by the string
+** 'sp'
+*/
+static int32 string_used(basicstring *sp) {
+  if (sp->stringlen>SHORTLIMIT) return LONGBLOCK(sp->stringaddr)->blocksize;
+  return binsizes[find_bin(sp->stringlen)];
+}
+
 /*
 ** 'check_alloc' is called to check for memory leaks. It counts the
 ** number of bytes held in the free lists and currently allocated and
 ** ensures that the total of these is equal to the number of bytes
 ** allocated from the Basic heap. If it is not, either memory is being
-** lost somewhere or being released more than once
+** lost somewhere or being released more than once. Long strings are
+** checked against what is found in the arenas
 */
 void check_alloc(void) {
-  int32 n, m, used, usedcount, free, freecount, elements;
+  int32 n, m, used, usedcount, free, freecount, elements, longused, arenas;
+  size_t longinuse, longfree;
   heapblock *p;
   variable *vp;
   basicstring *sp;
-  if (allocated==0) return;     /* No strings were allocated */
-  used = usedcount = free = freecount = 0;
-  for (n=1; n<BINCOUNT; n++) {  /* Find number of bytes in free lists */
+  if (allocated==0 && arenalist==NIL) return;   /* No strings were allocated */
+  used = usedcount = free = freecount = longused = 0;
+  for (n=1; n<SHORTBINS; n++) { /* Find number of bytes in free lists */
     p = binlists[n];
     m = 0;
     while (p!=NIL) {
@@ -547,18 +1016,30 @@ void check_alloc(void) {
     freecount+=m;
 /*    if (m!=0) fprintf(stderr, "Block size %5d: %d entries\n", binsizes[n], m); */
   }
+  for (p=freelist; p!=NIL; p=p->blockflink) {
+    free+=p->blocksize;
+    freecount++;
+  }
   for (n=0; n<VARLISTS; n++) {          /* Find number of bytes in use */
     vp = basicvars.varlists[n];
     while (vp!=NIL) {
       if (vp->varflags==VAR_STRINGDOL) {
-        used+=binsizes[find_bin(vp->varentry.varstring.stringlen)];
+        if (vp->varentry.varstring.stringlen>SHORTLIMIT)
+          longused+=string_used(&vp->varentry.varstring);
+        else {
+          used+=string_used(&vp->varentry.varstring);
+        }
         usedcount++;
       }
       else if (vp->varflags==VAR_STRARRAY && vp->varentry.vararray!=NIL) {
         sp = vp->varentry.vararray->arraystart.stringbase;
         elements = vp->varentry.vararray->arrsize;
         for (m=1; m<=elements; m++) {
-          used+=binsizes[find_bin(sp->stringlen)];
+          if (sp->stringlen>SHORTLIMIT)
+            longused+=string_used(sp);
+          else {
+            used+=string_used(sp);
+          }
           sp++;
         }
         usedcount+=elements;
@@ -576,6 +1057,13 @@ void check_alloc(void) {
   else {
     fprintf(stderr, " *** Memory leak (%d bytes) ***\n", n);
   }
+  walk_arenas(&longinuse, &longfree, &arenas);
+  fprintf(stderr, "Long string bytes in use = %d,  held by variables = %d", (int32)longinuse, longused);
+  if (longinuse==longused)
+    fprintf(stderr, " - Okay\n");
+  else {
+    fprintf(stderr, " *** Difference of %d bytes ***\n", (int32)longinuse-longused);
+  }
   fprintf(stderr, "Strings in use = %d,  free = %d\n", usedcount, freecount);
 }
 
@@ -37,6 +37,7 @@ extern void discard_strings(byte *, int32);
 extern char *resize_string(char *, int32, int32);
 extern void clear_strings(void);
 extern int32 get_stringlen(size_t);
+extern void string_memory(size_t *, size_t *, size_t *);
 extern void show_stringstats(void);
 extern void check_alloc(void);
 
@@ -72,6 +72,25 @@
 #endif /* BRANDY_MODE7ONLY */
 #endif /* BRANDY_STARTUP_MODE */
 
+/* Size of the buffer used for text output in kilobytes when it is
+** not going to a terminal. Can be changed at run time with the
+** '-outbuf' option. Add -DBRANDY_OUTBUF_SIZE=<size> to your
+** BRANDY_BUILD_FLAGS environment variable to override
+*/
+#ifndef BRANDY_OUTBUF_SIZE
+#define BRANDY_OUTBUF_SIZE 64
+#endif
+
+/* Smallest size in kilobytes of a file opened with OPENIN that is
+** mapped into memory for reading, on systems that can do this. Can
+** be changed at run time with the '-mmap' option. Add
+** -DBRANDY_MMAP_SIZE=<size> to your BRANDY_BUILD_FLAGS environment
+** variable to override. 0 means files are never mapped
+*/
+#ifndef BRANDY_MMAP_SIZE
+#define BRANDY_MMAP_SIZE 64
+#endif
+
 /*
 ** Define the operating system-specific types used for integer
 ** and floating point types in Basic. 32-bit integer (signed
@@ -503,4 +522,16 @@ typedef jmp_buf sigjmp_buf;
 #define MAXSYSPARMS 16          /* Maximum number of parameters allowed in a 'SYS' statement */
 #endif
 
+/*
+** Direct-threaded dispatch. Adding -DBRANDY_DIRECTDISPATCH to
+** BRANDY_BUILD_FLAGS makes the main statement loop and the expression
+** evaluator jump straight to the code for the commonest tokens using
+** gcc's 'labels as values' extension instead of calling through the
+** 'statements' and 'factor_table' tables. Compilers without the
+** extension always use the tables.
+*/
+#if defined(BRANDY_DIRECTDISPATCH) && defined(__GNUC__)
+#define USE_DIRECTDISPATCH
+#endif
+
 #endif
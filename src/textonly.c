@@ -55,6 +55,10 @@
 #include <conio.h>
 #endif
 
+#ifdef USE_ANSI
+#include <pthread.h>
+#endif
+
 #if defined(TARGET_UNIX) | defined(TARGET_DJGPP)
 #include <sys/ioctl.h>
 #include <sys/types.h>
@@ -206,13 +210,192 @@ static void write_vduflag(unsigned int flags, int yesno) {
   vduflags = yesno ? vduflags | flags : vduflags & ~flags;
 }
 
+static void start_raw(void);
+
 static void tekvdu(int chr) {
+  start_raw();
   putchar(chr);
   fflush(stdout);
   if (matrixflags.tekspeed > 0) usleep(9000000/matrixflags.tekspeed);
 }
 
 #ifdef USE_ANSI
+/*
+** Output to the terminal is buffered and the code keeps a shadow copy
+** of the screen. Characters are only sent if they differ from what is
+** already displayed at that position and cursor movements and colour
+** changes are held back until something is written, so that a run of
+** them turns into at most one control sequence. 'termx' and 'termy'
+** give the position of the terminal's cursor and 'wantx' and 'wanty'
+** where it would be if every movement had been sent. The contents of
+** the screen are only known after it has been cleared, so the shadow
+** copy is not used until then. Characters with the top bit set (which
+** the terminal could treat as part of a multi-byte character), raw
+** escape sequences sent with VDU 27 and the Tektronix graphics leave
+** the screen in an unknown state. After one of these everything is
+** sent as soon as it is written until the next CLS.
+** Output is flushed when the interpreter waits for input, at WAIT and
+** by a thread that runs FLUSHDELAY microseconds after something is
+** written
+*/
+#define CELL_UNKNOWN 0xFFFFFFFFu        /* Shadow cell value that never matches a character */
+#define FLUSHDELAY 20000                /* Delay before the flush thread writes pending output */
+#define TERMBUFSIZE 16384               /* Size of stdout buffer when writing to the terminal */
+#define COLOUR_DEFAULT -1               /* Colour value when it has not been set */
+#define COLOUR_UNKNOWN -2               /* Colour value when the terminal's colour is not known */
+
+static uint32 *shadow;                  /* Character and colours at each position on screen */
+static int32 shadowsize;                /* Number of cells in 'shadow' */
+static boolean shadowok;                /* TRUE if 'shadow' matches the screen */
+static boolean rawoutput;               /* TRUE if screen state is unknown and output is not held back */
+static boolean cursorknown;             /* TRUE if 'wantx' and 'wanty' are valid */
+static boolean termknown;               /* TRUE if 'termx' and 'termy' are valid */
+static int32 termx, termy, wantx, wanty;
+static int32 termfore = COLOUR_DEFAULT, termback = COLOUR_DEFAULT;     /* Colours last sent */
+static int32 wantfore = COLOUR_DEFAULT, wantback = COLOUR_DEFAULT;     /* Current text colours */
+static boolean forestale, backstale;    /* TRUE if raw output could have changed the colours */
+static int32 scrtop, scrbottom;         /* Terminal's scrolling region */
+static volatile boolean flushpending;   /* TRUE if the flush thread has been woken up */
+static boolean flushthread;             /* TRUE if the flush thread is running */
+static pthread_mutex_t flushlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flushcond = PTHREAD_COND_INITIALIZER;
+
+/*
+** 'flush_thread' writes out anything left in the stdout buffer a short
+** time after output has been produced. It sleeps until woken up by
+** 'output_written'
+*/
+static void *flush_thread(void *unused) {
+  while (TRUE) {
+    pthread_mutex_lock(&flushlock);
+    while (!flushpending) pthread_cond_wait(&flushcond, &flushlock);
+    pthread_mutex_unlock(&flushlock);
+    usleep(FLUSHDELAY);
+    flushpending = FALSE;
+    fflush(stdout);
+  }
+  return NIL;
+}
+
+/*
+** 'setup_outbuffer' gives stdout a buffer of its own. This has to be
+** done before anything is written. Output to the terminal is fully
+** buffered and sent by 'flush_thread' or when the interpreter waits.
+** The size of the buffer used when output is not going to a terminal
+** is set by the '-outbuf' option, where 0 leaves the C library's
+** buffering alone
+*/
+static void setup_outbuffer(void) {
+  static char *outbuffer;
+  size_t size = basicvars.runflags.outredir ? matrixflags.outbufsize : TERMBUFSIZE;
+  if (size==0) return;
+  outbuffer = malloc(size);
+  if (outbuffer!=NIL) setvbuf(stdout, outbuffer, _IOFBF, size);
+}
+
+/*
+** 'output_written' is called after something has been sent to stdout
+** to make sure that it will be flushed
+*/
+static void output_written(void) {
+  if (flushpending || !flushthread) return;
+  pthread_mutex_lock(&flushlock);
+  flushpending = TRUE;
+  pthread_cond_signal(&flushcond);
+  pthread_mutex_unlock(&flushlock);
+}
+
+/*
+** 'lose_track' is called when output has been sent whose effect on the
+** screen cannot be followed
+*/
+static void lose_track(void) {
+  rawoutput = TRUE;
+  shadowok = FALSE;
+  cursorknown = termknown = FALSE;
+}
+
+/*
+** 'forget_rows' marks rows 'first' to 'last' of the shadow screen
+** as unknown
+*/
+static void forget_rows(int32 first, int32 last) {
+  int32 n;
+  if (!shadowok) return;
+  for (n = first*textwidth; n<(last+1)*textwidth; n++) shadow[n] = CELL_UNKNOWN;
+}
+
+/*
+** 'sync_colours' sends any text colour changes that have not been
+** output yet
+*/
+static void sync_colours(void) {
+  if (wantfore!=termfore) {
+    printf("\033[%s%dm", wantfore & 8 ? "1;" : "11;", wantfore+ANSI_FOREGROUND);       /* Set foreground colour (bright or non-bright) */
+    termfore = wantfore;
+  }
+  if (wantback!=termback) {
+    printf("\033[%dm", wantback+ANSI_BACKGROUND);       /* Set background colour */
+    termback = wantback;
+  }
+}
+
+/*
+** 'sync_cursor' moves the terminal's cursor to where it should be if it
+** is not there already
+*/
+static void sync_cursor(void) {
+  if (!cursorknown || (termknown && termx==wantx && termy==wanty)) return;
+  if (termknown && termy==wanty)
+    printf("\033[%dG", wantx+1);        /* Only the column differs */
+  else {
+    printf("\033[%d;%dH", wanty+1, wantx+1);
+  }
+  termx = wantx;
+  termy = wanty;
+  termknown = TRUE;
+}
+
+/*
+** 'set_want' records where the cursor has been moved to on the screen,
+** clamping the position to the screen in the same way as the terminal
+*/
+static void set_want(int32 x, int32 y) {
+  if (x<0) x = 0;
+  if (x>=textwidth) x = textwidth-1;
+  if (y<0) y = 0;
+  if (textheight>0 && y>=textheight) y = textheight-1;
+  wantx = x;
+  wanty = y;
+  cursorknown = TRUE;
+}
+
+/*
+** 'ansi_linefeed' sends a linefeed followed by a move to column
+** 'column' and keeps track of the screen scrolling
+*/
+static void ansi_linefeed(int32 column) {
+  sync_colours();       /* Scrolling fills the new line with the background colour */
+  if (!termknown || termy!=wanty) sync_cursor();        /* Column is set after the linefeed */
+  printf("\n\033[%dG", column+1);
+  if (cursorknown) {
+    if (wanty==scrbottom) {     /* Scrolling region moves up */
+      if (shadowok) {
+        memmove(&shadow[scrtop*textwidth], &shadow[(scrtop+1)*textwidth], (scrbottom-scrtop)*textwidth*sizeof(uint32));
+        forget_rows(scrbottom, scrbottom);
+      }
+    }
+    else if (textheight==0 || wanty<textheight-1) {
+      wanty++;
+    }
+    set_want(column, wanty);
+    termx = wantx;
+    termy = wanty;
+    termknown = TRUE;
+  }
+  output_written();
+}
+
 /*
 ** 'find_cursor' reads the position of the cursor on the text
 ** screen. It can only do this if input is coming from the
@@ -225,6 +408,9 @@ void find_cursor(void) {
   column = row = 0;
   if (!basicvars.runflags.outredir && !basicvars.runflags.inredir) {
     int ch;
+    flush_screen();
+    cursorknown = termknown = FALSE;
+    shadowok = FALSE;   /* Cannot tell what is on the screen */
     printf("\033[6n");  /* ANSI/VTxxx sequence to find the position of the cursor */
     fflush(stdout);
     ch = kbd_inkey(50);    /* Sequence expected back is ' ESC[<no>;<no>R' */
@@ -245,6 +431,12 @@ void find_cursor(void) {
     if (ch!='R') return;
     xtext = column-1;   /* The programs wants RISC OS text coordinates, */
     ytext = row-1;      /* not ANSI ones */
+    if (!rawoutput && textwidth>0) {
+      set_want(xtext, ytext);
+      termx = wantx;
+      termy = wanty;
+      termknown = TRUE;
+    }
     if (xtext<twinleft) /* Ensure that the cursor lies within the text window */
       xtext = twinleft;
     else if (xtext>twinright)
@@ -257,13 +449,41 @@ void find_cursor(void) {
   }
 }
 
+/*
+** 'flush_screen' sends any cursor movement or colour change that has
+** been held back and flushes the output to the terminal. It is called
+** when the interpreter is going to wait
+** -- ANSI --
+*/
+void flush_screen(void) {
+  if (!basicvars.runflags.outredir) {
+    sync_colours();
+    sync_cursor();
+  }
+  fflush(stdout);
+}
+
+/*
+** 'set_scrollregion' sets the terminal's scrolling region to rows
+** 'top' to 'bottom'. This also sends the cursor to the top left-hand
+** corner of the screen
+*/
+static void set_scrollregion(int32 top, int32 bottom) {
+  printf("\033[%d;%dr", top+1, bottom+1);
+  scrtop = top;
+  scrbottom = bottom;
+  termx = termy = 0;
+  termknown = TRUE;
+  output_written();
+}
+
 /*
 ** 'reset_screen' is called to carry out anything needed to reset
 ** the screen to its default settings
 ** -- ANSI --
 */
 static void reset_screen(void) {
-  if (vduflag(VDU_FLAG_TEXTWIN)) printf("\033[%d;%dr", 1, textheight);    /* Set scrolling region to whole screen */
+  if (vduflag(VDU_FLAG_TEXTWIN)) set_scrollregion(0, textheight-1);     /* Set scrolling region to whole screen */
 }
 
 /*
@@ -279,7 +499,20 @@ static void reset_screen(void) {
 */
 static void putch(int32 ch) {
   putchar(ch);
-  if (vduflag(VDU_FLAG_ECHO)) fflush(stdout);
+  output_written();
+}
+
+/*
+** 'start_raw' is called before sending output whose effect on the
+** screen is unknown, for example, the start of an escape sequence
+** -- ANSI --
+*/
+static void start_raw(void) {
+  if (!rawoutput) {
+    sync_colours();
+    sync_cursor();
+    lose_track();
+  }
 }
 
 /*
@@ -290,8 +523,13 @@ static void putch(int32 ch) {
 ** -- ANSI --
 */
 static void gotoxy(int32 x, int32 y) {
-  printf("\033[%d;%dH", y, x);  /* VTxxx/ANSI sequence to move cursor */
-  fflush(stdout);
+  if (rawoutput) {
+    printf("\033[%d;%dH", y, x);        /* VTxxx/ANSI sequence to move cursor */
+    output_written();
+  }
+  else {
+    set_want(x-1, y-1);
+  }
 }
 
 /*
@@ -302,12 +540,21 @@ static void gotoxy(int32 x, int32 y) {
 */
 static void scroll_text(updown direction) {
   if (vduflag(VDU_FLAG_TEXTWIN)) return;
-  if (direction==SCROLL_UP)     /* Move screen up - Output a linefeed */
-    printf("\n\033[%d;%dH", ytext+1, xtext+1);  /* Move screen up and move cursor to correct place */
+  if (direction==SCROLL_UP) {   /* Move screen up - Output a linefeed */
+    ansi_linefeed(0);
+    gotoxy(xtext+1, ytext+1);   /* Move cursor to correct place */
+  }
   else {        /* Move screen down */
-    printf("\033[L");
+    sync_colours();
+    sync_cursor();
+    printf("\033[L");   /* Insert a line at the cursor */
+    if (cursorknown && wanty>=scrtop && wanty<=scrbottom && shadowok) {
+      memmove(&shadow[(wanty+1)*textwidth], &shadow[wanty*textwidth], (scrbottom-wanty)*textwidth*sizeof(uint32));
+      forget_rows(wanty, wanty);
+    }
+    termknown = FALSE;  /* Terminals differ over where this leaves the cursor */
+    output_written();
   }
-  fflush(stdout);
 }
 
 /*
@@ -315,10 +562,12 @@ static void scroll_text(updown direction) {
 ** -- ANSI --
 */
 static void textcolor(int32 colour) {
-  printf("\033[");
-  if (colour & 8) printf("1;");           /* bright     */
-  else            printf("11;");          /* non-bright */
-  printf("%dm", colour+ANSI_FOREGROUND);  /* VTxxx/ANSI sequence to set the foreground colour */
+  wantfore = colour;
+  if (rawoutput || forestale) {         /* Always send the colour */
+    termfore = COLOUR_UNKNOWN;
+    forestale = FALSE;
+  }
+  if (rawoutput) sync_colours();
 }
 
 /*
@@ -326,7 +575,12 @@ static void textcolor(int32 colour) {
 ** -- ANSI --
 */
 static void textbackground(int32 colour) {
-  printf("\033[%dm", colour+ANSI_BACKGROUND);   /* VTxxx/ANSI sequence to set the background colour */
+  wantback = colour;
+  if (rawoutput || backstale) {         /* Always send the colour */
+    termback = COLOUR_UNKNOWN;
+    backstale = FALSE;
+  }
+  if (rawoutput) sync_colours();
 }
 
 /*
@@ -335,8 +589,24 @@ static void textbackground(int32 colour) {
 ** -- ANSI --
 */
 static void clrscr(void) {
+  int32 n;
+  sync_colours();       /* The screen is cleared to the background colour */
   printf("\033[2J\033[H");      /* VTxxx/ANSI sequence for clearing the screen and to 'home' the cursor */
-  fflush(stdout);
+  output_written();
+  if (rawoutput) forestale = backstale = TRUE;
+  rawoutput = basicvars.runflags.outredir;      /* Output to a file is always sent as it is written */
+  termx = termy = wantx = wanty = 0;
+  termknown = cursorknown = !rawoutput && textwidth>0;
+  shadowok = FALSE;
+  if (basicvars.runflags.outredir || textwidth<=0 || textheight<=0) return;
+  n = textwidth*textheight;
+  if (n!=shadowsize) {
+    free(shadow);
+    shadow = malloc(n*sizeof(uint32));
+    shadowsize = shadow==NIL ? 0 : n;
+  }
+  shadowok = shadow!=NIL;
+  forget_rows(0, textheight-1);
 }
 
 /*
@@ -349,12 +619,12 @@ void set_cursor(boolean underline) {
 }
 
 /*
-** 'echo_on' turns on the immediate echo of characters to the screen
+** 'echo_on' turns on the immediate echo of characters to the screen.
+** Output is left for the flush thread to write out
 ** -- ANSI --
 */
 void echo_on(void) {
   write_vduflag(VDU_FLAG_ECHO,1);
-  fflush(stdout);
 }
 
 /*
@@ -572,6 +842,23 @@ void echo_on(void) {
 void echo_off(void) {
 }
 
+/*
+** 'flush_screen' makes sure that all output has been written
+** -- conio --
+*/
+void flush_screen(void) {
+  fflush(stdout);
+}
+
+/*
+** 'start_raw' is called before sending output whose effect on the
+** screen is unknown. conio does not hold back any output so there
+** is nothing to do
+** -- conio --
+*/
+static void start_raw(void) {
+}
+
 #endif
 
 /*
@@ -696,8 +983,8 @@ static void printer_char(void) {
   if (matrixflags.printer) {
     fputc(vduqueue[0], matrixflags.printer);
   } else {
-    putchar(vduqueue[0]);
-    if (vduflag(VDU_FLAG_ECHO)) fflush(stdout);
+    start_raw();
+    putch(vduqueue[0]);
   }
 }
 
@@ -707,20 +994,36 @@ static void printer_char(void) {
 */
 static void move_curback(void) {
   xtext--;
-  if (xtext>=twinleft)  /* Cursor is still within the text window */
-    printf("\033[D");   /* ANSI sequence to move the cursor back one char */
+  if (xtext>=twinleft) {        /* Cursor is still within the text window */
+    if (cursorknown)
+      set_want(wantx-1, wanty);
+    else {
+      printf("\033[D");         /* ANSI sequence to move the cursor back one char */
+      output_written();
+    }
+  }
   else {        /* Cursor is at left-hand edge of text window so move up a line */
     xtext = twinright;
     ytext--;
-    if (ytext>=twintop) /* Cursor is still within the confines of the text window */
-      printf("\033[A\033[%dG", xtext+1);        /* Move cursor up and to last column */
+    if (ytext>=twintop) {       /* Cursor is still within the confines of the text window */
+      if (cursorknown)
+        set_want(xtext, wanty!=scrtop ? wanty-1 : wanty);
+      else {
+        printf("\033[A\033[%dG", xtext+1);      /* Move cursor up and to last column */
+        output_written();
+      }
+    }
     else {      /* Cursor is now above the top of the window */
       ytext++;  /* Scroll window down a line */
       scroll_text(SCROLL_DOWN);
-      printf("\033[%dG", xtext+1);      /* Move cursor to last column */
+      if (cursorknown)
+        set_want(xtext, wanty);
+      else {
+        printf("\033[%dG", xtext+1);    /* Move cursor to last column */
+        output_written();
+      }
     }
   }
-  fflush(stdout);
 }
 
 /*
@@ -730,14 +1033,19 @@ static void move_curback(void) {
 */
 static void move_curforward(void) {
   xtext++;
-  if (xtext<=twinright) /* Cursor is still within the text window */
-    printf("\033[C");   /* ANSI sequence to move the cursor forwards one char */
+  if (xtext<=twinright) {       /* Cursor is still within the text window */
+    if (cursorknown)
+      set_want(wantx+1, wanty);
+    else {
+      printf("\033[C");         /* ANSI sequence to move the cursor forwards one char */
+      output_written();
+    }
+  }
   else {        /* Cursor is at right-hand edge of text window so move down a line */
     xtext = twinleft;
     ytext++;
-    printf("\n\033[%dG", xtext+1);      /* Move cursor down and to first column */
+    ansi_linefeed(xtext);       /* Move cursor down and to first column */
   }
-  fflush(stdout);
 }
 
 /*
@@ -747,8 +1055,7 @@ static void move_curforward(void) {
 */
 static void move_curdown(void) {
   ytext++;
-  printf("\n\033[%dG", xtext+1);
-  fflush(stdout);
+  ansi_linefeed(xtext);
 }
 
 /*
@@ -757,13 +1064,18 @@ static void move_curdown(void) {
 */
 static void move_curup(void) {
   ytext--;
-  if (ytext>=twintop)           /* Cursor is still within the window */
-    printf("\033[A");   /* ANSI sequence to move the cursor up one line */
+  if (ytext>=twintop) {         /* Cursor is still within the window */
+    if (cursorknown)
+      set_want(wantx, wanty!=scrtop ? wanty-1 : wanty);
+    else {
+      printf("\033[A");         /* ANSI sequence to move the cursor up one line */
+      output_written();
+    }
+  }
   else {                /* Cursor is above the top of the window */
     ytext++;            /* Scroll window down a line */
     scroll_text(SCROLL_DOWN);
   }
-  fflush(stdout);
 }
 
 /*
@@ -773,11 +1085,20 @@ static void move_curup(void) {
 */
 static void vdu_cleartext(void) {
   if (vduflag(VDU_FLAG_TEXTWIN)) {        /* Text window defined that does not occupy the whole screen */
-    int32 row;
+    int32 row, n;
+    sync_colours();
     for (row = twintop; row<=twinbottom; row++) {
       printf("\033[%d;%dH\033[%dX", row+1, twinleft+1, twinright-twinleft+1);   /* Clear the line */
+      if (shadowok && row<textheight) {
+        for (n = twinleft; n<=twinright && n<textwidth; n++) shadow[row*textwidth+n] = CELL_UNKNOWN;
+      }
+    }
+    output_written();
+    if (!rawoutput) {
+      termx = twinleft;
+      termy = twinbottom;
+      termknown = twinleft<textwidth && (textheight==0 || twinbottom<textheight);
     }
-    fflush(stdout);
     move_cursor(twinleft, twintop);     /* Send cursor to home position in window */
   }
   else {    /* No text window has been defined */
@@ -792,8 +1113,12 @@ static void vdu_cleartext(void) {
 ** -- ANSI --
 */
 static void vdu_return(void) {
-  printf("\033[%dG", twinleft+1);
-  fflush(stdout);
+  if (cursorknown)
+    set_want(twinleft, wanty);
+  else {
+    printf("\033[%dG", twinleft+1);
+    output_written();
+  }
   xtext = twinleft;
 }
 
@@ -830,7 +1155,7 @@ static void vdu_textwind(void) {
 ** using an ANSI control sequence so that the contents of the window
 ** can be scrolled up or down
 */
-  if (vduflag(VDU_FLAG_TEXTWIN) && left==0 && right==textwidth-1) printf("\033[%d;%dr", twintop+1, twinbottom+1);
+  if (vduflag(VDU_FLAG_TEXTWIN) && left==0 && right==textwidth-1) set_scrollregion(twintop, twinbottom);
   move_cursor(twinleft, twintop);       /* Move text cursor to home position in new window */
 }
 
@@ -1077,9 +1402,11 @@ static void vdu_hometext(void) {
 }
 
 static void tekinit(void) {
+  start_raw();
   if (!graphicurs) printf("%c%c%c%c%c%c", 27, 91, 63, 51, 56, 104);
 }
 static void tekexit(void) {
+  start_raw();
   if (!graphicurs) printf("%c%c", 27, 3);
 }
 
@@ -1137,17 +1464,41 @@ static void print_char(int32 charvalue) {
   if (charvalue==DEL) charvalue=' ';    /* Hack for DOS */
   if (!basicvars.runflags.outredir) {           /* Output is going to screen */
 /* ANSI control sequence code */
-    putchar(charvalue);
+    if (rawoutput)
+      putchar(charvalue);
+    else if (!cursorknown || wantx>=textwidth-(twinright>=textwidth) || charvalue>=128) {
+/* Cannot tell where this character ends up */
+      sync_colours();
+      sync_cursor();
+      putchar(charvalue);
+      lose_track();
+      rawoutput = FALSE;
+    }
+    else {
+      uint32 cell = charvalue | (wantfore+1)<<8 | (wantback+1)<<16;
+      uint32 *sp = shadowok ? &shadow[wanty*textwidth+wantx] : NIL;
+      if (sp==NIL || *sp!=cell) {       /* Character differs from what is on the screen */
+        sync_colours();
+        sync_cursor();
+        putchar(charvalue);
+        if (sp!=NIL) *sp = cell;
+        termx++;
+      }
+      wantx++;
+    }
     xtext++;
     if (xtext>twinright) {              /* Have reached edge of text window. Skip to next line  */
       xtext = twinleft;
       ytext++;
-      printf("\n\033[%dG", xtext+1);
+      ansi_linefeed(xtext);
+    }
+    else {
+      output_written();
     }
-    if (vduflag(VDU_FLAG_ECHO)) fflush(stdout);
   }
   else {        /* Output is going elsewhere, probably a file */
     putchar(charvalue);
+    output_written();
   }
 }
 
@@ -1213,7 +1564,9 @@ void emulate_vdu(int32 charvalue) {
       return;
     }
     else {      /* Control character - Found start of new VDU command */
+#ifndef USE_ANSI
       if (!vduflag(VDU_FLAG_ECHO)) fflush(stdout);
+#endif
       vducmd = charvalue;
       if (charvalue == DEL) vduneeded=0; else vduneeded = vdubytes[charvalue];
       vdunext = 0;
@@ -1324,6 +1677,7 @@ void emulate_vdu(int32 charvalue) {
     vdu_restwind();
     break;
   case VDU_ESCAPE:      /* 27 - Do nothing (but char is sent to screen anyway) */
+    start_raw();
     putch(vducmd);
     break;
   case VDU_DEFTEXT:     /* 28 - Define text window */
@@ -1341,14 +1695,36 @@ void emulate_vdu(int32 charvalue) {
 }
 
 /*
-** 'emulate_vdustr' is called to print a string via the 'VDU driver'
+** 'emulate_vdustr' is called to print a string via the 'VDU driver'.
+** When no VDU command is in progress and WIDTH is not in effect, runs
+** of printable characters skip 'emulate_vdu'. If the output has been
+** redirected they are written in one go
 */
 void emulate_vdustr(char string[], int32 length) {
-  int32 n;
+  int32 n, start;
   if (length==0) length = strlen(string);
   echo_off();
-  for (n=0; n<length; n++) {
+  n = 0;
+  while (n<length) {
+    if (vduneeded==0 && !vduflag(VDU_FLAG_DISABLE) && matrixflags.printer==NIL && basicvars.printwidth<=0) {
+      start = n;
+      while (n<length && CAST(string[n], byte)>=' ' && string[n]!=DEL) n++;
+      if (n>start) {
+        if (matrixflags.dospool) fwrite(string+start, 1, n-start, matrixflags.dospool);
+        if (basicvars.runflags.outredir) {
+          fwrite(string+start, 1, n-start, stdout);
+#ifdef USE_ANSI
+          output_written();
+#endif
+        }
+        else {
+          while (start<n) print_char(CAST(string[start++], byte));
+        }
+        continue;
+      }
+    }
     emulate_vdu(string[n]);      /* Send the string to the VDU driver */
+    n++;
     if (basicvars.printwidth > 0) {
       if (emulate_pos() == basicvars.printwidth) {
         emulate_vdu(asc_CR);
@@ -1998,9 +2374,11 @@ void emulate_pointto(int32 x, int32 y) {
 }
 
 /*
-** 'emulate_wait' deals with the Basic 'WAIT' statement
+** 'emulate_wait' deals with the Basic 'WAIT' statement. There is no
+** frame to wait for but the output so far is sent to the screen
 */
 void emulate_wait(void) {
+  flush_screen();
   if (basicvars.runflags.flag_cosmetic) error(ERR_UNSUPPORTED);
 }
 
@@ -2301,6 +2679,9 @@ static void find_screensize(void) {
 boolean init_screen(void) {
   int mode;
   check_stdout();
+#ifdef USE_ANSI
+  setup_outbuffer();
+#endif
   find_screensize();
   /* Set initial screen mode according to the screen size */
   if (realwidth>SCRWIDTH || realheight>SCRHEIGHT)       /* Larger screen mode */
@@ -2312,6 +2693,16 @@ boolean init_screen(void) {
   vduneeded = 0;
   write_vduflag(VDU_FLAG_ENAPRINT,0);
   setup_mode(mode);
+#ifdef USE_ANSI
+  scrtop = 0;
+  scrbottom = textheight-1;
+  if (basicvars.runflags.outredir) rawoutput = TRUE;
+  {
+    pthread_t flush_thread_id;
+    flushthread = pthread_create(&flush_thread_id, NULL, &flush_thread, NULL)==0;
+    if (flushthread) pthread_detach(flush_thread_id);
+  }
+#endif
   find_cursor();
 
   /* When running interactively change the console title bar too */
@@ -2331,6 +2722,7 @@ boolean init_screen(void) {
 */
 void end_screen(void) {
   if (vduflag(VDU_FLAG_TEXTWIN)) reset_screen();
+  flush_screen();
 }
 
 int32 get_character_at_pos(int32 cx, int32 cy) {
@@ -1566,6 +1566,22 @@ byte *skip_token(byte *p) {
   return NULL;
 }
 
+/*
+** 'skip_toeol' returns a pointer to the NUL at the end of the executable
+** tokens of the line that 'p' points into. It returns NIL if it finds an
+** illegal token or has not reached the end of the line after 'limit'
+** tokens. It does not report errors as it is called from the profiler's
+** signal handler
+*/
+byte *skip_toeol(byte *p, int32 limit) {
+  while (*p != asc_NUL && limit > 0) {
+    if (skiptable[*p] < 0) return NIL;
+    p+=1+skiptable[*p];
+    limit--;
+  }
+  return *p == asc_NUL ? p : NIL;
+}
+
 /*
 ** 'skip_name' returns a pointer to the byte after the variable name that
 ** starts at 'p'
@@ -360,6 +360,7 @@ extern byte thisline[];                 /* tokenised version of command line */
 extern void tokenize(char *, byte [], boolean, boolean);
 extern void expand(byte *, char *);
 extern byte *skip_token(byte *);
+extern byte *skip_toeol(byte *, int32);
 extern byte *skip_name(byte *);
 extern void set_dest(byte *, byte *);
 extern void set_address(byte *, void *);
@@ -42,6 +42,7 @@
 #include "screen.h"
 #include "lvalue.h"
 #include "statement.h"
+#include "functions.h"
 
 #define FIELDWIDTH 20           /* Width of field used to print each variable's value */
 #define PRINTWIDTH 80           /* Default maximum number of characters printed per line */
@@ -81,14 +82,18 @@ void clear_varlists(void) {
   library *lp;
 
   DEBUGFUNCMSGIN;
+#ifdef TARGET_UNIX
+  profile_collect();    /* Profiler samples refer to PROCs and FNs and to libraries */
+#endif
   for (n=0; n<VARLISTS; n++) basicvars.varlists[n] = NIL;
   basicvars.runflags.has_variables = FALSE;
   basicvars.lastsearch = basicvars.start;
   basicvars.liblist = NIL;
+  clear_evalcache();
 /* Now clear the PROC/FN lists and symbol tables for installed libraries */
   lp = basicvars.installist;
   while (lp!=NIL) {
-    lp->libfplist = NIL;
+    lp->libscanned = FALSE;
     for (n=0; n<VARLISTS; n++) lp->varlists[n] = NIL;
     lp = lp->libflink;
   }
@@ -109,6 +114,7 @@ static void remove_variable(variable *vptoremove, variable *newvp) {
     }
   }
   if(returnable(vptoremove, sizeof(variable))) freemem(vptoremove, sizeof(variable));
+  clear_evalcache();    /* Cached EVAL expressions might refer to the variable */
   DEBUGFUNCMSGOUT;
 }
 
@@ -499,6 +505,38 @@ void list_libraries() {
   }
 }
 
+/*
+** 'count_varlist' adds the numbers of variables and arrays in the
+** symbol table 'varlists' to 'vars' and 'arrays'
+*/
+static void count_varlist(variable *varlists[], int32 *vars, int32 *arrays) {
+  int n;
+  variable *vp;
+  for (n=0; n<VARLISTS; n++) {
+    for (vp = varlists[n]; vp!=NIL; vp = vp->varflink) {
+      if ((vp->varflags & (VAR_PROC | VAR_FUNCTION | VAR_MARKER))!=0) continue;
+      if ((vp->varflags & VAR_ARRAY)!=0)
+        *arrays+=1;
+      else {
+        *vars+=1;
+      }
+    }
+  }
+}
+
+/*
+** 'count_variables' returns the numbers of variables and arrays that
+** have been created, including those private to libraries. It is used
+** by '*STATS'
+*/
+void count_variables(int32 *vars, int32 *arrays) {
+  library *lp;
+  *vars = *arrays = 0;
+  count_varlist(basicvars.varlists, vars, arrays);
+  for (lp = basicvars.liblist; lp!=NIL; lp = lp->libflink) count_varlist(lp->varlists, vars, arrays);
+  for (lp = basicvars.installist; lp!=NIL; lp = lp->libflink) count_varlist(lp->varlists, vars, arrays);
+}
+
 /*
 ** 'define_array' is called to collect the dimensions of an array
 ** and to create the array. 'vp' points at the symbol table entry
@@ -948,69 +986,175 @@ static void add_libarray(byte *tp, library *lp) {
 }
 
 /*
-** 'add_procfn' creates an entry for a procedure or function
-** in a library and returns a pointer to its entry. 'tp' points
-** at the 'DEF' token when the function is called
+** PROC/FN definition indexes
+** --------------------------
+** The first call of a procedure or function has to find its 'DEF'. Rather
+** than searching the program and each library a line at a time for it,
+** a hash table of the definitions is used. The index of the program in
+** memory is built when it is first needed and discarded by 'clear_defindex'
+** whenever the program is edited. It is also rebuilt if the start or end
+** of the program has moved since it was made. It is malloc'ed so it is not
+** lost when the Basic heap is cleared by 'RUN' or 'CLEAR'. Libraries cannot
+** be edited so their indexes are built once by 'make_defindex' when they
+** are loaded. If there is no memory for an index, the program and
+** libraries are searched line by line instead.
 */
-static libfnproc *add_procfn(byte *bp, byte *tp) {
-  byte *ep, *base;
-  libfnproc *fpp;
-  int namelen;
-  char pfname[MAXNAMELEN];
+static defindex *progdefs;              /* PROC/FN index of program in memory */
+static byte *progdefs_start;            /* Values of 'start' and 'top' when index was made */
+static byte *progdefs_top;
+static boolean progdefs_valid;          /* TRUE if 'progdefs' reflects the current program */
 
-  DEBUGFUNCMSGIN;
-  base = GET_SRCADDR(tp+1);     /* Find address of PROC/FN name */
-  ep = skip_name(base); /* Find byte after name */
+/*
+** 'hash_name' returns the hash value of the 'namelen' character
+** PROC/FN name at 'np' used by the PROC/FN indexes
+*/
+static int32 hash_name(byte *np, int32 namelen) {
+  uint32 hashtotal = 2166136261u;
+
+  while (namelen>0) {
+    hashtotal = (hashtotal^*np)*16777619u;
+    np++;
+    namelen--;
+  }
+  return hashtotal;
+}
+
+/*
+** 'find_def' checks if the line at 'bp' starts with 'DEF PROC' or
+** 'DEF FN'. If it does, it returns a pointer to the 'XFNPROCALL' token
+** after the 'DEF' and sets 'np' and 'namelen' to the address and length
+** of the name in the source part of the line. The name starts with
+** the 'PROC' or 'FN' token. If not, it returns NIL
+*/
+static byte *find_def(byte *bp, byte **np, int32 *namelen) {
+  byte *tp, *base, *ep;
+
+  tp = FIND_EXEC(bp);
+  if (*tp!=BASTOKEN_DEF || *(tp+1)!=BASTOKEN_XFNPROCALL) return NIL;
+  base = GET_SRCADDR(tp+1);
+  ep = skip_name(base);
   if (*(ep-1)=='(') ep--;       /* '(' here is not part of the name but the start of the parameter list */
-  namelen = ep-base;
-  memmove(pfname, base, namelen);
-  pfname[namelen] = asc_NUL;
-  fpp = allocmem(sizeof(libfnproc), 1);
-  fpp->fpline = bp;
-  fpp->fpname = base;
-  fpp->fpmarker = tp+1; /* Need pointer to the XFNPROCALL token for scan_parmlist() */
-  fpp->fphash = hash(pfname);
-  fpp->fpflink = NIL;
+  *np = base;
+  *namelen = ep-base;
+  return tp+1;
+}
+
+/*
+** 'make_defindex' builds an index of the procedures and functions
+** defined in the program or library starting at 'base'. If 'onheap' is
+** TRUE the index is placed on the Basic heap otherwise it is malloc'ed.
+** Where a name is defined more than once, the first definition is the
+** one indexed as that is the one a search of the program would find.
+** It returns NIL if there is no memory for the index
+*/
+defindex *make_defindex(byte *base, boolean onheap) {
+  defindex *dp;
+  byte *bp, *np, *marker;
+  int32 count, size, namelen, hashvalue, n;
+
+  DEBUGFUNCMSGIN;
+  count = 0;
+  for (bp = base; !AT_PROGEND(bp); bp+=GET_LINELEN(bp)) {
+    if (find_def(bp, &np, &namelen)!=NIL) count++;
+  }
+  size = 16;    /* Keep the table no more than half full */
+  while (size<count*2) size = size*2;
+  if (onheap)
+    dp = allocmem(sizeof(defindex)+(size-1)*sizeof(defentry), FALSE);
+  else {
+    dp = malloc(sizeof(defindex)+(size-1)*sizeof(defentry));
+  }
+  if (dp==NIL) {
+    DEBUGFUNCMSGOUT;
+    return NIL;
+  }
+  dp->defmask = size-1;
+  for (n=0; n<size; n++) dp->defs[n].defmarker = NIL;
+  for (bp = base; !AT_PROGEND(bp); bp+=GET_LINELEN(bp)) {
+    marker = find_def(bp, &np, &namelen);
+    if (marker==NIL) continue;
+    hashvalue = hash_name(np, namelen);
+    n = hashvalue & dp->defmask;
+    while (dp->defs[n].defmarker!=NIL) {
+      defentry *ep = &dp->defs[n];
+      if (ep->defhash==hashvalue && ep->namelen==namelen && memcmp(GET_SRCADDR(ep->defmarker), np, namelen)==0) break;
+      n = (n+1) & dp->defmask;
+    }
+    if (dp->defs[n].defmarker!=NIL) continue;   /* Name has been defined already */
+    dp->defs[n].defhash = hashvalue;
+    dp->defs[n].namelen = namelen;
+    dp->defs[n].defmarker = marker;
+  }
   DEBUGFUNCMSGOUT;
-  return fpp;
+  return dp;
+}
+
+/*
+** 'clear_defindex' discards the PROC/FN index of the program in
+** memory. It has to be called whenever lines are added or deleted
+*/
+void clear_defindex(void) {
+  free(progdefs);
+  progdefs = NIL;
+  progdefs_valid = FALSE;
+}
+
+/*
+** 'get_progdefs' returns the PROC/FN index of the program in
+** memory, building it if necessary. It returns NIL if there is no
+** index available
+*/
+static defindex *get_progdefs(void) {
+  if (!progdefs_valid || progdefs_start!=basicvars.start || progdefs_top!=basicvars.top) {
+    clear_defindex();
+    progdefs = make_defindex(basicvars.start, FALSE);
+    progdefs_start = basicvars.start;
+    progdefs_top = basicvars.top;
+    progdefs_valid = TRUE;
+  }
+  return progdefs;
+}
+
+/*
+** 'search_defindex' looks for procedure or function 'name' in index
+** 'dp'. It returns a pointer to the 'XFNPROCALL' token after the 'DEF'
+** or NIL if the name is not in the index
+*/
+static byte *search_defindex(defindex *dp, char *name) {
+  int32 namelen, hashvalue, n;
+
+  namelen = strlen(name);
+  hashvalue = hash_name(CAST(name, byte *), namelen);
+  n = hashvalue & dp->defmask;
+  while (dp->defs[n].defmarker!=NIL) {
+    defentry *ep = &dp->defs[n];
+    if (ep->defhash==hashvalue && ep->namelen==namelen && memcmp(GET_SRCADDR(ep->defmarker), name, namelen)==0) return ep->defmarker;
+    n = (n+1) & dp->defmask;
+  }
+  return NIL;
 }
 
 /*
-** 'scan_library' is called to build a list of procedures and
-** functions in a library to speed up library searches. It also
-** looks for 'LIBRARY LOCAL' statements and adds any variables
-** listed on to the library's sumbol table. 'lp' points at the
+** 'scan_library' is called the first time a procedure or function
+** not in the Basic program is looked for in a library after the variable
+** lists have been cleared. It looks for 'LIBRARY LOCAL' statements and
+** 'DIM' statements ahead of the first procedure or function and adds any
+** variables listed on to the library's symbol table. 'lp' points at the
 ** library list entry of interest.
-** The function is called the first time a procedure or function
-** is called that is not in the Basic program. As each library
-** is searched for the first time, so this function is invoked.
-** Variables that will be private to the library are created at
-** this time.
 */
 static void scan_library(library *lp) {
-  byte *bp;
-  libfnproc *fpp, *fpplast;
-  boolean foundproc;
+  byte *bp, *np;
+  int32 namelen;
 
   DEBUGFUNCMSGIN;
+  lp->libscanned = TRUE;
   bp = lp->libstart;
-  fpplast = NIL;
-  foundproc = FALSE;
   while (!AT_PROGEND(bp)) {
     byte *tp = FIND_EXEC(bp);
-    if (*tp==BASTOKEN_DEF && *(tp+1)==BASTOKEN_XFNPROCALL) {      /* Found DEF PROC or DEF FN */
-      foundproc = TRUE;
-      fpp = add_procfn(bp, tp);
-      if (fpplast==NIL) /* First PROC or FN found in library */
-        lp->libfplist = fpp;
-      else {
-        fpplast->fpflink = fpp;
-      }
-      fpplast = fpp;
-    }
-    else if (!foundproc && *tp==BASTOKEN_LIBRARY && *(tp+1)==BASTOKEN_LOCAL)      /* LIBRARY LOCAL */
+    if (find_def(bp, &np, &namelen)!=NIL) break;      /* Found first DEF PROC or DEF FN */
+    if (*tp==BASTOKEN_LIBRARY && *(tp+1)==BASTOKEN_LOCAL)       /* LIBRARY LOCAL */
       add_libvars(tp, lp);
-    else if (!foundproc && *tp==BASTOKEN_DIM) {
+    else if (*tp==BASTOKEN_DIM) {
       add_libarray(tp, lp);
     }
     bp+=GET_LINELEN(bp);
@@ -1019,33 +1163,38 @@ static void scan_library(library *lp) {
 }
 
 /*
-** 'search_library' scans a library for procedure or function 'name'. If
-** it finds it, it creates a symbol table entry for the item and returns
+** 'search_library' looks for procedure or function 'name' in a library.
+** If it finds it, it creates a symbol table entry for the item and returns
 ** a pointer to that entry. If the procedure or function cannot be found
 ** in this library the function returns NIL.
 */
 static variable *search_library(library *lp, char *name) {
-  int32 hashvalue;
-  int namelen;
-  libfnproc *fpp;
+  int32 hashvalue, namelen, deflen;
+  byte *marker, *bp, *np;
   variable *vp;
 
   DEBUGFUNCMSGIN;
-  if (lp->libfplist==NIL) scan_library(lp);     /* Create list of PROCs and FNs in library */
-  hashvalue = hash(name);
+  if (!lp->libscanned) scan_library(lp);        /* Create library's private variables */
   namelen = strlen(name);
-  fpp = lp->libfplist;
-  if (fpp==NIL) return NIL;             /* Return if library does not contain anything */
-  do {
-    if (fpp->fphash==hashvalue && memcmp(fpp->fpname, name, namelen)==0) break; /* Found it */
-    fpp = fpp->fpflink;
-  } while (fpp!=NIL);
-  if (fpp==NIL) return NIL;             /* Entry not found in library */
+  if (lp->libdefs!=NIL)
+    marker = search_defindex(lp->libdefs, name);
+  else {        /* No index - Search library a line at a time */
+    marker = NIL;
+    for (bp = lp->libstart; !AT_PROGEND(bp) && marker==NIL; bp+=GET_LINELEN(bp)) {
+      marker = find_def(bp, &np, &deflen);
+      if (marker!=NIL && (deflen!=namelen || memcmp(np, name, namelen)!=0)) marker = NIL;
+    }
+  }
+  if (marker==NIL) {                    /* Entry not found in library */
+    DEBUGFUNCMSGOUT;
+    return NIL;
+  }
+  hashvalue = hash(name);
   vp = allocmem(sizeof(variable), 1);   /* Entry found. Create symbol table entry for it */
   vp->varname = allocmem(namelen+1, 1); /* +1 for NUL at end of name */
   STRLCPY(vp->varname, name, namelen+1);
   vp->varhash = hashvalue;
-  vp->varentry.varmarker = fpp->fpmarker;       /* Needed in 'scan_parmlist' */
+  vp->varentry.varmarker = marker;      /* Needed in 'scan_parmlist' */
   vp->varflink = basicvars.varlists[hashvalue & VARMASK];
   basicvars.varlists[hashvalue & VARMASK] = vp;
   basicvars.runflags.has_variables = TRUE;      /* Say program has some variables */
@@ -1100,36 +1249,45 @@ static variable *mark_procfn(byte *pp) {
 }
 
 /*
-** 'scan_fnproc' scans though the Basic program for the the procedure or
-** function 'name'. It creates symbol table entries for any procedures
-** of functions it finds (leaving them as 'marker' entries so that their
-** positions are known.) It returns a pointer to the symbol table definition
-** of the procedure or function
+** 'scan_fnproc' looks for the procedure or function 'name' in the Basic
+** program's PROC/FN index and then in the libraries. If there is no index
+** it scans though the program instead, creating symbol table entries for
+** any procedures or functions it finds (leaving them as 'marker' entries
+** so that their positions are known.) It returns a pointer to the symbol
+** table definition of the procedure or function
 */
 static variable *scan_fnproc(char *name) {
   byte *bp;
   int32 namehash;
   variable *vp;
   library *lp;
+  defindex *dp;
 
   DEBUGFUNCMSGIN;
-  namehash = hash(name);
-  bp = basicvars.lastsearch;    /* Start new search where last one ended */
   vp = NIL;
-  while (!AT_PROGEND(bp)) {
-    byte *tp = FIND_EXEC(bp);
-    bp+=GET_LINELEN(bp);        /* This is updated here so that 'lastsearch' is set correctly below */
-    if (*tp==BASTOKEN_DEF && *(tp+1)==BASTOKEN_XFNPROCALL) {      /* Found 'DEF PROC' or 'DEF FN' */
-      vp = mark_procfn(tp+1); /* Must be a previously unseen entry */
-      if (vp == NIL) {
-        error(ERR_BROKEN, __LINE__, "variables");
-        return((variable *)-1);
+  dp = get_progdefs();
+  if (dp!=NIL) {        /* Look up PROC/FN in the program's index */
+    byte *marker = search_defindex(dp, name);
+    if (marker!=NIL) vp = mark_procfn(marker);
+  }
+  else {        /* No index - Search program a line at a time */
+    namehash = hash(name);
+    bp = basicvars.lastsearch;  /* Start new search where last one ended */
+    while (!AT_PROGEND(bp)) {
+      byte *tp = FIND_EXEC(bp);
+      bp+=GET_LINELEN(bp);      /* This is updated here so that 'lastsearch' is set correctly below */
+      if (*tp==BASTOKEN_DEF && *(tp+1)==BASTOKEN_XFNPROCALL) {    /* Found 'DEF PROC' or 'DEF FN' */
+        vp = mark_procfn(tp+1); /* Must be a previously unseen entry */
+        if (vp == NIL) {
+          error(ERR_BROKEN, __LINE__, "variables");
+          return((variable *)-1);
+        }
+        if (vp->varhash==namehash && strncmp(name, vp->varname, strlen(name)+1)==0) break; /* Found it */
+        vp = NIL;       /* Reset 'vp' as this proc/fn is not the one needed */
       }
-      if (vp->varhash==namehash && strncmp(name, vp->varname, strlen(name)+1)==0) break; /* Found it */
-      vp = NIL; /* Reset 'vp' as this proc/fn is not the one needed */
     }
+    basicvars.lastsearch = bp;
   }
-  basicvars.lastsearch = bp;
   if (vp==NIL && basicvars.liblist!=NIL) {      /* Check the library list for the PROC/FN */
     lp = basicvars.liblist;
     do {
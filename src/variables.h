@@ -27,9 +27,12 @@
 #include "basicdefs.h"
 
 extern void clear_varlists(void);
+extern defindex *make_defindex(byte *, boolean);
+extern void clear_defindex(void);
 extern void list_variables(char);
 extern void list_libraries();
 extern void detail_library(library *);
+extern void count_variables(int32 *, int32 *);
 extern variable *find_variable(byte *, int);
 extern variable *find_fnproc(byte *, int);
 extern variable *create_variable(byte *, int32, library *);
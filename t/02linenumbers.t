@@ -0,0 +1,31 @@
+#!sbrandy
+5 REM Computed line number references: GOTO, GOSUB, ON GOSUB and RESTORE
+10 PRINT "1..6"
+20 N%=0
+30 FOR I%=1 TO 3
+40 ON I% GOSUB 1000,1010,1020
+50 NEXT
+60 IF N%=111 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+70 L%=1030
+80 GOTO L%
+90 PRINT "not ok 2"
+100 END
+1000 N%+=1:RETURN
+1010 N%+=10:RETURN
+1020 N%+=100:RETURN
+1030 PRINT "ok 2"
+1040 R%=1500:RESTORE R%
+1050 READ A$
+1060 IF A$="six" THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+1070 RESTORE 1510
+1080 READ A$
+1090 IF A$="seven" THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+1100 X%=0
+1110 GOSUB (1400+X%)
+1120 IF X%=5 THEN PRINT "ok 5" ELSE PRINT "not ok 5"
+1130 ON ERROR IF ERR=41 THEN PRINT "ok 6":END ELSE PRINT "not ok 6":END
+1140 G%=1145:GOTO G%
+1150 END
+1400 X%=5:RETURN
+1500 DATA six
+1510 DATA seven
@@ -0,0 +1,29 @@
+#!sbrandy
+5 REM ON ERROR LOCAL inside functions, including errors raised by signals
+10 PRINT "1..3"
+20 N%=0
+30 FOR I%=1 TO 5
+40 N%+=FNtrap(I%)
+50 NEXT
+60 IF N%=15 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+70 N%=0
+80 FOR I%=1 TO 3
+90 IF FNpeek<>0 THEN N%+=1
+100 NEXT
+110 IF N%=3 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+120 IF FNdepth(20)=20 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+130 END
+1000 DEF FNtrap(V%)
+1010 ON ERROR LOCAL =V%
+1020 ERROR 100, "Trapped"
+1030 =0
+1100 DEF FNpeek
+1110 LOCAL X%
+1120 ON ERROR LOCAL =ERR
+1130 X%=?0
+1140 =0
+1200 DEF FNdepth(D%)
+1210 ON ERROR LOCAL =FNdepth(D%-1)+1
+1220 IF D%=0 THEN =0
+1230 ERROR 101, "Recurse"
+1240 =-1
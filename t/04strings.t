@@ -0,0 +1,31 @@
+#!sbrandy
+5 REM String building, truncation and appending a string to itself
+10 PRINT "1..7"
+20 A$=""
+30 FOR I%=1 TO 5000
+40 A$+=STR$(I% MOD 10)
+50 K$=STRING$(300+I% MOD 7,"k")
+60 NEXT
+70 OK%=LEN(A$)=5000
+80 FOR I%=1 TO 5000 STEP 37
+90 IF MID$(A$,I%,1)<>STR$(I% MOD 10) THEN OK%=FALSE
+100 NEXT
+110 IF OK% THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+120 A$=LEFT$(A$,300):A$+=STRING$(700,"z")
+130 IF LEN(A$)=1000 AND LEFT$(A$,10)="1234567890" AND RIGHT$(A$,3)="zzz" THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+140 B$="abcdefghij":B$+=B$
+150 IF B$="abcdefghijabcdefghij" THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+160 C$=STRING$(400,"c")+"d":C$+=C$
+170 IF LEN(C$)=802 AND MID$(C$,400,4)="cdcc" AND RIGHT$(C$,2)="cd" THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+180 D$="":FOR I%=1 TO 2000:D$=D$+STR$(I% MOD 10)+",":NEXT
+190 IF LEN(D$)=4000 AND LEFT$(D$,6)="1,2,3," AND RIGHT$(D$,4)="9,0," THEN PRINT "ok 5" ELSE PRINT "not ok 5"
+200 E$="ab":E$=E$+"-"+E$:E$=E$+E$+FNchange
+210 IF E$="ab-abab-abZZ" THEN PRINT "ok 6" ELSE PRINT "not ok 6 ";E$
+220 F$="keep":E%=FNmismatch
+230 IF E%=6 AND F$="keep" THEN PRINT "ok 7" ELSE PRINT "not ok 7 ";E%;" ";F$
+240 END
+250 DEF FNchange:E$="ZZ":=E$
+260 DEF FNmismatch
+270 ON ERROR LOCAL =ERR
+280 F$=F$+"x"+1
+290 =0
@@ -0,0 +1,13 @@
+#!sbrandy
+5 REM Repeated EVAL of the same strings, including after CLEAR and recursively
+10 PRINT "1..4"
+20 A%=3:B%=4:T%=0
+30 FOR I%=1 TO 100:T%+=EVAL("A%*B%+I%"):NEXT
+40 IF T%=6250 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+50 A%=10:IF EVAL("A%*B%+I%")=141 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+55 Q%=1:Z%=EVAL("Q%")
+60 CLEAR
+70 Q%=9:IF EVAL("Q%")=9 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+80 IF EVAL("FNr(4)")=65 THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+90 END
+1000 DEF FNr(N%) IF N%=0 THEN =1 ELSE =N%*EVAL("FNr("+STR$(N%-1)+")")+EVAL("FNr(0)")
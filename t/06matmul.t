@@ -0,0 +1,20 @@
+#!sbrandy
+5 REM Array multiplication, large enough to use the blocked code
+10 PRINT "1..3"
+20 N%=40:M%=45:P%=50
+30 DIM A(N%-1,M%-1),B(M%-1,P%-1),C(N%-1,P%-1),V(M%-1),W(P%-1)
+40 DIM IA%(N%-1,M%-1),IB%(M%-1,P%-1),IC%(N%-1,P%-1)
+50 FOR I%=0 TO N%-1:FOR J%=0 TO M%-1:A(I%,J%)=(I%*7+J%*3) MOD 11-5:IA%(I%,J%)=A(I%,J%):NEXT:NEXT
+60 FOR I%=0 TO M%-1:V(I%)=I% MOD 5:FOR J%=0 TO P%-1:B(I%,J%)=(I%+J%*5) MOD 13-6:IB%(I%,J%)=B(I%,J%):NEXT:NEXT
+70 C()=A().B():IC%()=IA%().IB%():W()=V().B()
+80 F%=0:G%=0
+90 FOR I%=0 TO N%-1:FOR J%=0 TO P%-1
+100 S=0:FOR K%=0 TO M%-1:S+=A(I%,K%)*B(K%,J%):NEXT
+110 IF C(I%,J%)<>S THEN F%+=1
+120 IF IC%(I%,J%)<>S THEN G%+=1
+130 NEXT:NEXT
+140 IF F%=0 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+150 IF G%=0 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+160 F%=0:FOR J%=0 TO P%-1:S=0:FOR K%=0 TO M%-1:S+=V(K%)*B(K%,J%):NEXT:IF W(J%)<>S THEN F%+=1
+170 NEXT
+180 IF F%=0 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
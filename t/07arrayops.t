@@ -0,0 +1,33 @@
+#!sbrandy
+5 REM Checked array multiplication and division, spanning several chunks
+10 PRINT "1..5"
+20 N%=1300
+30 DIM A(N%),B(N%),C(N%),D(N%),I%(N%),J%(N%),K%(N%)
+40 FOR I%=0 TO N%:A(I%)=SIN(I%)*100:B(I%)=I%/7+0.5:I%(I%)=I%*31-20000:J%(I%)=I% MOD 17-8:NEXT
+50 C()=A()*B():D()=A()/B():K%()=I%()*J%()
+60 F%=0:FOR I%=0 TO N%:IF C(I%)<>A(I%)*B(I%) OR D(I%)<>A(I%)/B(I%) OR K%(I%)<>I%(I%)*J%(I%) THEN F%+=1
+70 NEXT
+80 IF F%=0 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+90 C()=A()*2.5:D()=3/B():F%=0
+100 FOR I%=0 TO N%:IF C(I%)<>A(I%)*2.5 OR D(I%)<>3/B(I%) THEN F%+=1
+110 NEXT
+120 IF F%=0 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+130 B(1100)=0
+140 IF FNdiv=18 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+150 I%(1000)=2000000000:J%(1000)=2
+160 IF FNimul=20 THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+170 A(900)=1E300
+180 IF FNfmul=20 THEN PRINT "ok 5" ELSE PRINT "not ok 5"
+190 END
+1000 DEF FNdiv
+1010 ON ERROR LOCAL =ERR
+1020 C()=A()/B()
+1030 =0
+1100 DEF FNimul
+1110 ON ERROR LOCAL =ERR
+1120 K%()=I%()*J%()
+1130 =0
+1200 DEF FNfmul
+1210 ON ERROR LOCAL =ERR
+1220 C()=A()*1E10
+1230 =0
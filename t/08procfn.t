@@ -0,0 +1,18 @@
+#!sbrandy
+5 REM Finding procedures and functions in the program and a library
+10 PRINT "1..5"
+20 LIBRARY "t/08procfn.lib"
+30 lv%=99:PROClibset(7)
+40 IF FNlibget=7 AND lv%=99 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+50 IF FNname="library" AND FNnamelonger="longer" THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+60 IF FNlast(3)=9 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+70 IF FNtwice=1 THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+80 IF FNmissing=1 THEN PRINT "ok 5" ELSE PRINT "not ok 5"
+90 END
+1000 DEF FNtwice=1
+1010 DEF FNmissing
+1020 ON ERROR LOCAL =1
+1030 PROCnot_defined
+1040 =0
+1050 DEF FNtwice=2
+1060 DEF FNlast(A%)=A%*A%
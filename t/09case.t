@@ -0,0 +1,40 @@
+#!sbrandy
+5 REM CASE statements whose WHEN values are all constants
+10 PRINT "1..5"
+20 R$="":FOR I%=-2 TO 5:R$+=FNint(I%):NEXT
+30 IF R$="nnzsssdo" THEN PRINT "ok 1" ELSE PRINT "not ok 1 ";R$
+40 IF FNint(&7FFFFFFF)="b" AND FNint(9999999999)="l" AND FNint(2.0)="s" AND FNint(2.5)="o" THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+50 R$="":RESTORE 1200:FOR I%=1 TO 5:READ A$:R$+=FNstr(A$):NEXT
+60 IF R$="eaaxo" THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";R$
+70 IF FNmismatch=6 THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+80 N%=0:FOR I%=1 TO 1000:CASE I% MOD 3 OF
+90 WHEN 0:N%+=1
+100 WHEN 1:N%+=10
+110 OTHERWISE:N%+=100
+120 ENDCASE:NEXT
+130 IF N%=36973 THEN PRINT "ok 5" ELSE PRINT "not ok 5 ";N%
+140 END
+1000 DEF FNint(V)
+1010 CASE V OF
+1020 WHEN 0:="z"
+1030 WHEN 1,2,3:="s"
+1040 WHEN -1,-2:="n"
+1050 WHEN 256,&7FFFFFFF:="b"
+1060 WHEN 2,4:="d"
+1070 WHEN 9999999999:="l"
+1080 ENDCASE
+1090 ="o"
+1100 DEF FNstr(A$)
+1110 CASE A$ OF
+1120 WHEN "":="e"
+1130 WHEN "ab","abc":="a"
+1140 WHEN "x","abc":="x"
+1150 ENDCASE
+1160 ="o"
+1200 DATA "","ab","abc","x","abcd"
+1300 DEF FNmismatch
+1310 ON ERROR LOCAL =ERR
+1320 CASE "s" OF
+1330 WHEN 1,2:=0
+1340 ENDCASE
+1350 =-1
@@ -0,0 +1,22 @@
+#!sbrandy
+5 REM READ and RESTORE with constant and expression DATA fields
+10 PRINT "1..5"
+20 READ A%,B%,C,D,E%,F
+30 IF A%=255 AND B%=-5 AND C=1500 AND D=-0.25 AND E%=-7 AND F=6 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+40 READ A%,B,C,D$,E
+50 IF A%=-1 AND B=1E10 AND C=-2147483648 AND D$="word" AND E=4 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+60 RESTORE 1000:READ A$:RESTORE +1:READ B$
+70 IF A$="third" AND B$="&FF" THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";A$;" ";B$
+80 S%=0:FOR R%=1 TO 3:RESTORE 1000:FOR I%=1 TO 4:READ A$:S%+=LEN A$:NEXT:NEXT
+90 IF S%=60 THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";S%
+100 ON ERROR LOCAL IF ERR=42 THEN PRINT "ok 5":END ELSE PRINT "not ok 5 ";REPORT$:END
+110 RESTORE 1040:READ A$,B$
+120 PRINT "not ok 5"
+130 END
+200 DATA &FF, -%101, 1.5E3, -.25 , - 7, 2*3
+210 DATA &FFFFFFFF, 9999999999+1, -2147483648, word, SQR(16)
+1000 DATA third
+1010 A%=0:DATA notme
+1020 REM gap
+1030 DATA fourth,fifth
+1040 DATA last
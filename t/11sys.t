@@ -0,0 +1,23 @@
+#!sbrandy
+5 REM SYS with constant and computed SWI names called repeatedly
+10 PRINT "1..5"
+20 E%=0:FOR I%=1 TO 3:SYS "Brandy_Platform" TO A%,B%,C%:SYS &140011 TO D%,F%,G%:IF A%<>D% OR B%<>F% OR C%<>G% THEN E%+=1
+30 NEXT
+40 IF E%=0 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+50 E%=0:FOR I%=1 TO 3:SYS "OS_SWINumberFromString",,"XOS_Byte" TO N%:IF N%<>&20006 THEN E%+=1
+60 NEXT
+70 IF E%=0 THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";~N%
+80 E%=0:FOR I%=1 TO 3:SYS "OS_"+"SWINumberFromString",,"OS_Write0" TO N%:IF N%<>2 THEN E%+=1
+90 NEXT
+100 IF E%=0 THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";N%
+110 E%=0:FOR I%=1 TO 3:PROCbad:NEXT
+120 IF E%=3 THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";E%
+130 ON ERROR LOCAL PRINT "ok 5 # skip no dlcall":END
+140 E%=0:FOR I%=1 TO 3:SYS "Brandy_dlcall","strlen","hello" TO N%:IF N%<>5 THEN E%+=1
+150 NEXT
+160 IF E%=0 THEN PRINT "ok 5" ELSE PRINT "not ok 5"
+170 END
+200 DEF PROCbad
+210 ON ERROR LOCAL E%+=1:ENDPROC
+220 SYS "Brandy_NoSuchCall"
+230 ENDPROC
@@ -0,0 +1,24 @@
+#!sbrandy
+5 REM Sampling profiler started and stopped with *PROFILE
+10 PRINT "1..4"
+20 OSCLI "PROFILE CLEAR":OSCLI "PROFILE ON 500"
+30 T%=TIME:REPEAT:PROCwork:UNTIL TIME-T%>=30
+40 OSCLI "PROFILE OFF"
+50 F$="profile"+STR$(RND(1E6))+".tmp"
+60 OSCLI "PROFILE SAVE "+F$
+70 H%=OPENIN(F$):N%=0:S%=0
+80 WHILE NOT EOF#H%:L$=GET$#H%:N%+=1:IF LEFT$(L$,9)="PROCwork;" THEN S%+=VAL(MID$(L$,INSTR(L$," ")+1))
+90 ENDWHILE:CLOSE#H%
+100 IF N%>0 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+110 IF S%>0 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+120 OSCLI "PROFILE CLEAR":OSCLI "PROFILE LINES "+F$
+130 H%=OPENIN(F$):L$=GET$#H%:CLOSE#H%:OSCLI "rm "+F$
+140 IF L$="0 samples" THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";L$
+150 ON ERROR LOCAL IF ERR=220 THEN PRINT "ok 4":END ELSE PRINT "not ok 4 ";REPORT$:END
+160 OSCLI "PROFILE SAVE"
+170 PRINT "not ok 4"
+180 END
+200 DEF PROCwork
+210 LOCAL I%,A
+220 FOR I%=1 TO 1000:A+=SQR(I%):NEXT
+230 ENDPROC
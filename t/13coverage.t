@@ -0,0 +1,24 @@
+#!sbrandy
+5 REM Statement counts kept with *COVERAGE
+10 PRINT "1..4"
+20 OSCLI "COVERAGE CLEAR":OSCLI "COVERAGE ON"
+30 FOR I%=1 TO 3:PROCsum(I%):NEXT
+40 IF FALSE THEN PRINT "never"
+50 OSCLI "COVERAGE OFF":PROCsum(5)
+60 F$="coverage"+STR$(RND(1E6))+".tmp":OSCLI "COVERAGE LIST "+F$
+70 H%=OPENIN(F$):E%=0
+80 WHILE NOT EOF#H%:L$=GET$#H%
+90 N%=VAL(MID$(L$,23))
+100 IF N%=30 AND (VAL(LEFT$(L$,10))<>4 OR VAL(MID$(L$,12,10))<>7) THEN E%+=1
+110 IF N%=210 AND (VAL(LEFT$(L$,10))<>3 OR VAL(MID$(L$,12,10))<>18) THEN E%+=2
+120 IF N%=200 AND LEFT$(L$,10)<>STRING$(9," ")+"-" THEN E%+=4
+130 IF N%=170 AND LEFT$(L$,10)<>STRING$(5," ")+"#####" THEN E%+=8
+140 ENDWHILE:CLOSE#H%:OSCLI "rm "+F$
+150 IF E%=0 THEN PRINT "ok 1" ELSE PRINT "not ok 1 ";E%
+160 IF L$="5 of 21 lines run" THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";L$
+170 IF S%=25 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+180 ON ERROR LOCAL IF ERR=220 THEN PRINT "ok 4":END ELSE PRINT "not ok 4 ";REPORT$:END
+190 OSCLI "COVERAGE ONWARDS":PRINT "not ok 4":END
+200 DEF PROCsum(X%)
+210 LOCAL J%:FOR J%=1 TO X%:S%+=J%:NEXT
+220 ENDPROC
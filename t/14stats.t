@@ -0,0 +1,26 @@
+#!sbrandy
+5 REM Counters read with SYS "Brandy_Stats"
+10 PRINT "1..5"
+20 SYS "Brandy_Stats",-1
+30 FOR I%=1 TO 10:PROCa(I%):NEXT
+40 X=EVAL("FNb(3)")+EVAL("FNb(4)")
+50 F$="stats"+STR$(RND(1E6))+".tmp":H%=OPENOUT(F$):BPUT#H%,"abcd":CLOSE#H%
+60 H%=OPENIN(F$):L$=GET$#H%:C%=BGET#H%:CLOSE#H%:OSCLI "rm "+F$
+70 N%=0:E%=0
+80 REPEAT:SYS "Brandy_Stats",N% TO V%%,N$
+90 IF N$="PROC calls" AND V%%<>10 THEN E%+=1
+100 IF N$="FN calls" AND V%%<>2 THEN E%+=2
+110 IF N$="EVAL calls" AND V%%<>2 THEN E%+=4
+120 IF N$="File bytes written" AND V%%<>5 THEN E%+=8
+130 IF N$="String allocations" AND V%%<10 THEN E%+=16
+140 IF N$="Stack high-water mark" THEN S%%=V%%
+150 N%+=1:UNTIL N$=""
+160 IF E%=0 THEN PRINT "ok 1" ELSE PRINT "not ok 1 ";E%
+170 IF N%=19 THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";N%
+180 IF S%%>0 THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+190 SYS "Brandy_Stats",0 TO A%%:SYS "Brandy_Stats",-1:SYS "Brandy_Stats",0 TO B%%
+200 IF A%%>0 AND B%%=0 THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";A%%;" ";B%%
+210 ON ERROR LOCAL IF ERR=220 THEN PRINT "ok 5":END ELSE PRINT "not ok 5 ";REPORT$:END
+220 OSCLI "STATS NOW":PRINT "not ok 5":END
+230 DEF PROCa(x%):LOCAL s$:s$=STRING$(x%,"x"):ENDPROC
+240 DEF FNb(y)=y*2
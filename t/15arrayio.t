@@ -0,0 +1,51 @@
+#!sbrandy
+5 REM Whole arrays written and read with PRINT#/INPUT# and BPUT#/BGET#
+10 PRINT "1..8"
+20 DIM A%(999),B(999),C$(99),D%%(99),E&(99)
+30 DIM A2%(999),B2(999),C2$(99),D2%%(99),E2&(99)
+40 FOR I%=0 TO 999:A%(I%)=I%*7-3000:B(I%)=I%/7:NEXT
+50 FOR I%=0 TO 99:C$(I%)=STRING$(I%*4,CHR$(65+I% MOD 26)):D%%(I%)=I%*&100000001:E&(I%)=I%*2:NEXT
+60 C$(50)=STRING$(300,"x")
+70 F$="arrayio"+STR$(RND(1E6))+".tmp"
+80 H%=OPENOUT(F$):PRINT#H%,A%(),B(),C$(),D%%(),E&(),42:CLOSE#H%
+90 H%=OPENIN(F$):INPUT#H%,A2%(),B2(),C2$(),D2%%(),E2&(),X%:Z%=EOF#H%:CLOSE#H%
+100 IF FNcompare AND X%=42 AND Z% THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+110 H%=OPENIN(F$):INPUT#H%,P%,Q:CLOSE#H%
+120 IF P%=-3000 AND Q=-2993 THEN PRINT "ok 2" ELSE PRINT "not ok 2"
+130 PROCclear
+140 H%=OPENOUT(F$):BPUT#H%,A%(),B(),C$(),D%%(),E&():CLOSE#H%
+150 H%=OPENIN(F$):BGET#H%,A2%(),B2(),C2$(),D2%%(),E2&():Z%=EOF#H%:CLOSE#H%
+160 IF FNcompare AND Z% THEN PRINT "ok 3" ELSE PRINT "not ok 3"
+170 H%=OPENOUT(F$):PRINT#H%,B():CLOSE#H%
+180 H%=OPENIN(F$):INPUT#H%,A2%():CLOSE#H%
+190 IF A2%(999)=142 THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";A2%(999)
+200 E%=FNerror(FALSE):IF E%=6 THEN PRINT "ok 5" ELSE PRINT "not ok 5 ";E%
+210 E%=FNerror(TRUE):IF E%=223 THEN PRINT "ok 6" ELSE PRINT "not ok 6 ";E%
+220 DIM L(19999),L2(19999),M%%(19999),M2%%(19999):FOR I%=0 TO 19999:L(I%)=I%/3:M%%(I%)=I%*&100000003:NEXT
+230 H%=OPENOUT(F$):PRINT#H%,L(),M%%():CLOSE#H%
+240 H%=OPENIN(F$):INPUT#H%,L2(),M2%%():Z%=EOF#H%:CLOSE#H%:E%=0
+250 FOR I%=0 TO 19999:IF L(I%)<>L2(I%) OR M%%(I%)<>M2%%(I%) THEN E%+=1
+255 NEXT:IF E%=0 AND Z% THEN PRINT "ok 7" ELSE PRINT "not ok 7 ";E%
+256 DIM S$(4),S2$(4),S3$(4):S$(0)="one"+CHR$10+"two":S$(1)="cr"+CHR$13:S$(2)="":S$(3)=STRING$(60000,"y"):S$(4)=CHR$10
+257 H%=OPENOUT(F$):BPUT#H%,S$(),S$():CLOSE#H%
+258 H%=OPENIN(F$):BGET#H%,S2$(),S3$():Z%=EOF#H%:CLOSE#H%:E%=0
+259 FOR I%=0 TO 4:IF S$(I%)<>S2$(I%) OR S$(I%)<>S3$(I%) THEN E%+=1
+260 NEXT:IF E%=0 AND Z% THEN PRINT "ok 8" ELSE PRINT "not ok 8 ";E%
+265 OSCLI "rm "+F$
+270 END
+280 DEF FNcompare
+290 LOCAL I%,E%
+300 FOR I%=0 TO 999:IF A%(I%)<>A2%(I%) OR B(I%)<>B2(I%) THEN E%+=1
+310 NEXT
+320 FOR I%=0 TO 99:IF C$(I%)<>C2$(I%) OR D%%(I%)<>D2%%(I%) OR E&(I%)<>E2&(I%) THEN E%+=1
+330 NEXT
+340 =E%=0
+350 DEF PROCclear
+360 A2%()=0:B2()=0:C2$()="":D2%%()=0:E2&()=0
+370 ENDPROC
+380 DEF FNerror(raw%)
+390 ON ERROR LOCAL CLOSE#H%:=ERR
+400 H%=OPENIN(F$)
+410 IF raw% THEN BGET#H%,B2(),B2() ELSE INPUT#H%,C2$()
+420 CLOSE#H%
+430 =0
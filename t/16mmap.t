@@ -0,0 +1,32 @@
+#!sbrandy
+5 REM Reading files big enough to be mapped into memory by OPENIN
+10 PRINT "1..7"
+20 F$="mmap"+STR$(RND(1E6))+".tmp"
+30 DIM A(9999),B(9999)
+40 FOR I%=0 TO 9999:A(I%)=I%/3:NEXT
+50 H%=OPENOUT(F$):PRINT#H%,A(),"end":FOR I%=1 TO 5000:BPUT#H%,"line "+STR$I%:NEXT:BPUT#H%,"last";:CLOSE#H%
+60 H%=OPENIN(F$):INPUT#H%,X,Y:PTR#H%=0:INPUT#H%,B(),E$
+70 E%=0:FOR I%=0 TO 9999:IF A(I%)<>B(I%) THEN E%+=1
+80 NEXT
+90 IF E%=0 AND E$="end" AND Y=A(1) THEN PRINT "ok 1" ELSE PRINT "not ok 1 ";E%;" ";E$
+100 P%=PTR#H%:N%=0:REPEAT L$=GET$#H%:N%+=1:UNTIL EOF#H%
+110 IF N%=5001 AND L$="last" AND PTR#H%=EXT#H% THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";N%;" ";L$
+120 PTR#H%=P%:S%=0:REPEAT S%+=BGET#H%:UNTIL EOF#H%
+130 PTR#H%=P%:L$="":FOR I%=1 TO 6:L$+=CHR$BGET#H%:NEXT
+140 IF L$="line 1" AND S%>0 THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";L$
+150 PTR#H%=EXT#H%:C%=BGET#H%:IF EOF#H% THEN PRINT "ok 4" ELSE PRINT "not ok 4"
+160 PTR#H%=EXT#H%:U%=OPENUP(F$):PTR#U%=EXT#U%:BPUT#U%,"more":CLOSE#U%
+170 IF NOT EOF#H% AND GET$#H%="more" AND EOF#H% THEN PRINT "ok 5" ELSE PRINT "not ok 5"
+180 ON ERROR LOCAL IF ERR=223 THEN PRINT "ok 6" ELSE PRINT "not ok 6 ";REPORT$
+190 IF ERR=0 THEN C%=BGET#H%:C%=BGET#H%:PRINT "not ok 6"
+200 RESTORE ERROR
+210 CLOSE#H%:OSCLI "rm "+F$
+220 G$=F$+"g":H%=OPENOUT(G$):FOR I%=1 TO 2000:BPUT#H%,STRING$(99,"x"):NEXT:CLOSE#H%
+230 H%=OPENIN(G$):L$=GET$#H%:OSCLI "truncate -s 1000 "+G$
+240 N%=0:REPEAT L$=FNline(H%):N%+=1:UNTIL EOF#H% OR N%>3000
+250 IF N%<100 AND EXT#H%=1000 THEN PRINT "ok 7" ELSE PRINT "not ok 7 ";N%;" ";EXT#H%
+260 CLOSE#H%:OSCLI "rm "+G$
+270 END
+280 DEF FNline(H%)
+290 ON ERROR LOCAL =""
+300 =GET$#H%
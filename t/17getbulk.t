@@ -0,0 +1,35 @@
+#!sbrandy
+5 REM GET$# with BY and TO, and BPUT# with lists of bytes
+10 PRINT "1..8"
+20 F$="getbulk"+STR$(RND(1E6))+".tmp"
+30 H%=OPENOUT(F$):BPUT#H%,"alpha,beta,gamma";:BPUT#H%,0,65,66,10:BPUT#H%,"end";:CLOSE#H%
+40 H%=OPENIN(F$)
+50 A$=GET$#H% TO ASC(","):B$=GET$#H% BY 4:C$=GET$#H% TO 44 BY 100
+60 IF A$="alpha" AND B$="beta" AND C$="" THEN PRINT "ok 1" ELSE PRINT "not ok 1 ";A$;" ";B$;" ";C$
+70 A$=GET$#H% TO 0:B$=GET$#H% BY 2:C$=GET$#H%
+80 IF A$="gamma" AND B$="AB" AND C$="" THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";A$;" ";B$;" ";C$
+90 A$=GET$#H% BY 10:IF A$="end" AND EOF#H% THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";A$
+100 PTR#H%=0:A$=GET$#H% BY 65536:IF LEN A$=EXT#H% THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";LEN A$
+110 ON ERROR LOCAL IF ERR=223 THEN PRINT "ok 5" ELSE PRINT "not ok 5 ";REPORT$
+120 IF ERR=0 THEN A$=GET$#H% TO 10:PRINT "not ok 5"
+130 RESTORE ERROR
+140 CLOSE#H%
+150 H%=OPENOUT(F$):E%=FNbputerror(TRUE):E2%=FNbputerror(FALSE):CLOSE#H%
+160 H%=OPENIN(F$):A$=GET$#H% BY 10:CLOSE#H%
+170 IF A$="ABCD" AND E%=18 AND E2%=16 THEN PRINT "ok 6" ELSE PRINT "not ok 6 ";A$;" ";E%;" ";E2%
+180 H%=OPENOUT(F$):FOR I%=1 TO 3:BPUT#H%,STRING$(30000,"x")+"|";:NEXT:CLOSE#H%
+190 H%=OPENIN(F$):A$=GET$#H% TO ASC"|":B$=GET$#H% BY 40000:C$=GET$#H% TO ASC"|":Z%=EOF#H%:CLOSE#H%
+200 IF LEN A$=30000 AND LEN B$=40000 AND MID$(B$,30001,1)="|" AND LEN C$=20001 AND Z% THEN PRINT "ok 7" ELSE PRINT "not ok 7 ";LEN A$;" ";LEN B$;" ";LEN C$
+202 X=1E10:E%=0:H%=OPENOUT(F$):FOR I%=1 TO 3:E%+=FNbputrange:NEXT:CLOSE#H%
+204 H%=OPENIN(F$):A$=GET$#H% BY 10:CLOSE#H%
+206 IF A$="ABABAB" AND E%=60 THEN PRINT "ok 8" ELSE PRINT "not ok 8 ";A$;" ";E%
+210 OSCLI "rm "+F$
+220 END
+230 DEF FNbputerror(divide%)
+240 ON ERROR LOCAL =ERR
+250 IF divide% THEN BPUT#H%,65,66,1/0 ELSE BPUT#H%,67,68 69
+260 =0
+270 DEF FNbputrange
+280 ON ERROR LOCAL =ERR
+290 BPUT#H%,65,66,X
+300 =0
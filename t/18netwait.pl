@@ -0,0 +1,33 @@
+#!/usr/bin/perl
+# Echo server for t/18netwait.t. Listens on a free loopback port, writes
+# the port number to the file named on the command line, and echoes
+# everything it receives until all of its clients have gone.
+use strict;
+use warnings;
+use IO::Socket::INET;
+use IO::Select;
+
+my $listener = IO::Socket::INET->new(LocalAddr => '127.0.0.1', LocalPort => 0,
+                                     Listen => 32, ReuseAddr => 1) or die "listen: $!";
+my $select = IO::Select->new($listener);
+alarm 60;
+open(my $portfile, '>', "$ARGV[0].tmp") or die "$ARGV[0]: $!";
+print $portfile $listener->sockport, "\n";
+close($portfile);
+rename("$ARGV[0].tmp", $ARGV[0]);
+while (1) {
+  foreach my $handle ($select->can_read) {
+    if ($handle == $listener) {
+      $select->add($listener->accept);
+    } else {
+      my $buffer;
+      if (sysread($handle, $buffer, 65536)) {
+        syswrite($handle, $buffer);
+      } else {
+        $select->remove($handle);
+        close($handle);
+        exit 0 if $select->count == 1;
+      }
+    }
+  }
+}
@@ -0,0 +1,29 @@
+#!sbrandy
+5 REM Many client connections, Brandy_NetWait and GET$# over loopback
+10 PRINT "1..5"
+20 F$="netwait"+STR$(RND(1E6))+".tmp":N%=8:DIM C%(N%),W% 8*N%
+30 OSCLI "perl t/18netwait.pl "+F$+" &"
+40 T%=TIME:REPEAT H%=OPENIN(F$):UNTIL H%>0 OR TIME>T%+1000
+50 P$=GET$#H%:CLOSE#H%:OSCLI "rm "+F$
+60 FOR I%=1 TO N%:C%(I%)=OPENUP("ip4:127.0.0.1:"+P$):NEXT
+70 G%=0:FOR I%=1 TO N%:IF C%(I%)>0 THEN G%+=1
+80 NEXT:IF G%=N% THEN PRINT "ok 1" ELSE PRINT "not ok 1 ";G%
+90 FOR I%=1 TO N%:W%!(8*I%-8)=C%(I%):W%!(8*I%-4)=2:NEXT
+100 SYS "Brandy_NetWait",W%,N%,500 TO R%
+110 IF R%=N% AND W%!4=2 THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";R%
+120 FOR I%=1 TO N%:BPUT#C%(I%),"line"+STR$I%:NEXT
+130 T%=TIME:G%=0:REPEAT
+140 FOR I%=1 TO N%:W%!(8*I%-8)=C%(I%):W%!(8*I%-4)=1:NEXT
+150 SYS "Brandy_NetWait",W%,N%,100 TO R%
+160 FOR I%=1 TO N%:IF W%!(8*I%-4)=1 THEN IF GET$#C%(I%)="line"+STR$I% THEN G%+=1
+170 NEXT
+180 UNTIL G%>=N% OR TIME>T%+500
+190 IF G%=N% THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";G%
+200 W%!0=C%(1):W%!4=1:SYS "Brandy_NetWait",W%,1,0 TO R%
+210 IF R%=0 AND W%!4=0 THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";R%;" ";W%!4
+220 A$=STRING$(60000,"z"):BPUT#C%(2),A$;:B$="":T%=TIME
+230 REPEAT W%!0=C%(2):W%!4=1:SYS "Brandy_NetWait",W%,1,100 TO R%
+240 IF R% THEN B$+=GET$#C%(2) BY (60000-LEN B$)
+250 UNTIL LEN B$>=60000 OR TIME>T%+500
+260 IF B$=A$ THEN PRINT "ok 5" ELSE PRINT "not ok 5 ";LEN B$
+270 FOR I%=1 TO N%:CLOSE#C%(I%):NEXT
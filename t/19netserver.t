@@ -0,0 +1,45 @@
+#!sbrandy
+5 REM Listening sockets, accepting connections and Brandy_NetWait over loopback
+10 PRINT "1..7"
+20 P%=40000+RND(20000):DIM B% 16
+30 L%=OPENUP("listen4:127.0.0.1:"+STR$P%)
+40 IF L%>0 AND BGET#L%=-1 THEN PRINT "ok 1" ELSE PRINT "not ok 1"
+50 C%=OPENUP("ip4:127.0.0.1:"+STR$P%)
+60 B%!0=L%:B%!4=1:SYS "Brandy_NetWait",B%,1,500 TO R%
+70 S%=BGET#L%:IF R%=1 AND S%>0 THEN PRINT "ok 2" ELSE PRINT "not ok 2 ";R%;" ";S%
+80 BPUT#C%,"hello"
+90 B%!0=S%:B%!4=1:SYS "Brandy_NetWait",B%,1,500 TO R%
+100 A$=GET$#S%:IF R%=1 AND A$="hello" THEN PRINT "ok 3" ELSE PRINT "not ok 3 ";A$
+110 B%!0=C%:B%!4=1:B%!8=S%:B%!12=3:SYS "Brandy_NetWait",B%,2,0 TO R%
+120 IF R%=1 AND B%!4=0 AND B%!12=2 THEN PRINT "ok 4" ELSE PRINT "not ok 4 ";R%;" ";B%!4;" ";B%!12
+130 CLOSE#C%:B%!0=S%:B%!4=1:SYS "Brandy_NetWait",B%,1,500 TO R%
+140 IF R%=1 AND BGET#S%=-2 THEN PRINT "ok 5" ELSE PRINT "not ok 5 ";R%
+150 CLOSE#S%
+160 N%=100:DIM C%(N%),S%(N%),W% 8*N%
+170 FOR I%=1 TO N%:C%(I%)=OPENUP("ip4:127.0.0.1:"+STR$P%):T%=TIME
+180 REPEAT S%(I%)=BGET#L%:UNTIL S%(I%)<>-1 OR TIME>T%+500
+190 BPUT#C%(I%),"c"+STR$I%:NEXT
+200 T%=TIME:G%=0:REPEAT
+210 FOR I%=1 TO N%:W%!(8*I%-8)=S%(I%):W%!(8*I%-4)=1:NEXT
+220 SYS "Brandy_NetWait",W%,N%,100 TO R%
+230 FOR I%=1 TO N%:IF W%!(8*I%-4)=1 THEN IF GET$#S%(I%)="c"+STR$I% THEN G%+=1
+240 NEXT
+250 UNTIL G%>=N% OR TIME>T%+500
+260 IF G%=N% THEN PRINT "ok 6" ELSE PRINT "not ok 6 ";G%
+270 E%=FNfill:IF E%=192 THEN PRINT "ok 7" ELSE PRINT "not ok 7 ";E%
+280 FOR I%=1 TO N%:CLOSE#C%(I%):CLOSE#S%(I%):NEXT:CLOSE#L%
+290 END
+300 REM Open connections until the file handles run out
+310 DEF FNfill
+320 LOCAL M%:DIM H%(300)
+330 ON ERROR LOCAL PROCcloseall(M%):=ERR
+340 REPEAT M%+=1:H%(M%)=OPENUP("ip4:127.0.0.1:"+STR$P%):T%=TIME
+350 REPEAT A%=BGET#L%:UNTIL A%<>-1 OR TIME>T%+500
+360 IF A%>0 THEN M%+=1:H%(M%)=A%
+370 UNTIL M%>=300
+380 =0
+390 DEF PROCcloseall(M%)
+400 LOCAL X%
+410 FOR X%=1 TO M%:IF H%(X%) THEN CLOSE#H%(X%)
+420 NEXT
+430 ENDPROC